@@ -8,6 +8,33 @@
     #define S64_UPVEC {0.0f, 0.0f, 1.0f}
     #define S64_FORWARDVEC {0.0f, -1.0f, 0.0f}
 
+    // How many frames worth of matrices each model helper keeps (Libultra only)
+    // Should match the number of framebuffers, so the RSP never reads a matrix that is being overwritten
+    #ifndef S64_MATRIXBUFFERS
+        #define S64_MATRIXBUFFERS 2
+    #endif
+    
+    // How many times a model helper can be drawn in the same frame with different matrices (Libultra only)
+    // Raise this if a helper is drawn more than once per frame with a different modelview, like for reflections or split screen
+    // Draws past this limit fail an assert, or are skipped if asserts are disabled
+    #ifndef S64_MATRIXDRAWS
+        #define S64_MATRIXDRAWS 1
+    #endif
+    
+    // How much of the screen's height a mesh must cover before it switches to its first LOD (Libultra only)
+    // Each extra LOD kicks in when the mesh is half as big as the previous one
+    #ifndef S64_LODSIZE
+        #define S64_LODSIZE 0.25f
+    #endif
+    
+    // Uncomment to make the library count the time spent in its hot paths, the display list commands it makes, and the heap it holds
+    // Read the counters with sausage64_get_stats. Leave it commented out for release builds, as it reads the clock for every mesh
+    //#define S64_PROFILE
+    
+    // The clock that profiling reads, which must return an increasing u32 count. Defaults to osGetCount (Libultra) or TICKS_READ (Libdragon)
+    // Define it before including this header to profile somewhere else, such as with a monotonic clock when building for a PC
+    //#define S64_PROFILE_CLOCK() osGetCount()
+
 
     /*********************************
       Libultra types (for libdragon)
@@ -15,6 +42,7 @@
 
     #ifdef LIBDRAGON
         #include <stdint.h>
+        #include <stdio.h>
         #ifndef __GL_H__
             #include <GL/gl.h>
         #endif
@@ -88,7 +116,14 @@
         } s64Material;
 
         typedef struct {
-            f32 (*verts)[11];
+            s16 pos[3];
+            s16 tex[2];
+            s8  normal[3];
+            u8  color[3];
+        } s64PackedVert;
+
+        typedef struct {
+            f32 (*verts)[11]; // Points to s64PackedVert data instead if the s64Gfx is packed
             u16 vertcount;
             u16 facecount;
             u16 (*faces)[3];
@@ -97,10 +132,11 @@
 
         typedef struct {
             u32 blockcount;
-            GLuint guid_mdl;
+            GLuint guid_mdl; // The first of blockcount display lists, one per render block
             GLuint guid_verts;
             GLuint guid_faces;
             s64RenderBlock* renders;
+            u8 packed;
         } s64Gfx;
     #endif
     
@@ -110,20 +146,29 @@
         f32 scale[3];
     } s64Transform;
 
+    typedef struct {
+        s16 pos[3];
+        u16 rot[3];
+        s16 scale[3];
+    } s64QTransform;
+
     typedef struct {
         s64Transform data;
-        u32 rendercount;
     } s64FrameTransform;
 
     typedef struct {
         const u32 framenumber;
         const s64Transform* framedata;
+        const s64QTransform* qframedata;
     } s64KeyFrame;
 
     typedef struct {
         const char* name;
         const u32 keyframecount;
         const s64KeyFrame* keyframes;
+        const u16* kflookup;
+        const f32 bounds[4];
+        const u32 baked;
     } s64Animation;
 
     typedef struct {
@@ -131,8 +176,49 @@
         const u32 is_billboard;
         const s64Gfx* dl;
         const s32 parent;
+        const f32 bounds[4];
+        const u32 lodcount;
+        const s64Gfx* const* lods;
     } s64Mesh;
 
+    typedef struct {
+        u16  slotcount;
+        u32  slotsize;
+        u32  kfsize;
+        u32  usecount;
+        u8*  pool;
+        u16* slotanim;
+        u32* slotused;
+        u16* animslot;
+        u32* kfoffsets;
+        #ifndef LIBDRAGON
+            u32 romstart;
+        #else
+            char* filepath;
+        #endif
+    } s64AnimStream;
+
+    typedef struct {
+        const s64Animation* anim;
+        f32 tick;
+        u8  interpolate;
+        u32 id;
+        u32 lastused;
+        s64FrameTransform* transforms;
+        #ifndef LIBDRAGON
+            Mtx* matrix;
+            u8*  mtxvalid;
+        #endif
+    } s64PoseEntry;
+
+    typedef struct {
+        u16 count;
+        f32 step;
+        u32 usecount;
+        u32 size;
+        s64PoseEntry* entries;
+    } s64PoseCache;
+
     typedef struct {
         const u16 meshcount;
         const u16 animcount;
@@ -144,6 +230,17 @@
             u32 _matscount;
             s64Material* _matscleanup;
         #endif
+        f32 _qposscale;
+        void* _filedata;
+        s64AnimStream* _animstream;
+        #ifndef LIBDRAGON
+            Gfx* _instancedls;
+            Gfx* _matdls;
+            u32 _matdlslots;
+        #endif
+        u32 _memsize;
+        s64PoseCache* _posecache;
+        u16* _meshorder;
     } s64ModelData;
     
     typedef struct {
@@ -152,29 +249,128 @@
         u32 curkeyframe;
     } s64AnimPlay;
 
+    typedef struct {
+        s64AnimPlay play;
+        f32 weight;
+        const f32* mask;
+        f32 _lerp;
+    } s64AnimLayer;
+
     typedef struct {
         u8    interpolate;
         u8    loop;
         u32   rendercount;
+        u32   poserendercount;
         #ifndef LIBDRAGON
-            Mtx* matrix;
+            Mtx*  matrix;
+            u8    matrixframe;
         #endif
         u8    (*predraw)(u16);
         void  (*postdraw)(u16);
         void  (*animcallback)(u16);
         const s64ModelData* mdldata;
         s64FrameTransform* transforms; 
+        u16*  meshorder;
+        u16   (*subtrees)[2];
         s64AnimPlay curanim;
         s64AnimPlay blendanim;
         f32 blendticks;
         f32 blendticks_left;
+        #ifndef LIBDRAGON
+            u8  cull;
+            u8  visible;
+            f32 frustum[6][4];
+            f32 lodsize;
+            f32 lodw[4];
+            f32 lodscale;
+            u8  absolute;
+            f32 modelview[4][4];
+        #endif
+        s64AnimLayer* layers;
+        u8 layercount;
+        u16 _poseentry;
+        u32 _poseid;
+        #ifndef LIBDRAGON
+            u8  matrixdraw;
+            u32 matrixtick;
+        #endif
     } s64ModelHelper;
 
+    typedef struct {
+        u8* data;
+        u32 size;
+        u32 loaded;
+        #ifndef LIBDRAGON
+            u32 romstart;
+            u32 pending;
+            u32** textures;
+            OSMesgQueue msgq;
+            OSMesg dmamsg;
+            OSIoMesg iomsg;
+        #else
+            FILE* fp;
+            char* filepath;
+            u8 failed;
+            sprite_t** textures;
+        #endif
+        s64ModelData* model;
+        struct s64ParseState* _parse;
+    } s64LoadState;
+
+    #ifndef LIBDRAGON
+        typedef struct {
+            u32 models_drawn;
+            u32 models_culled;
+            u32 meshes_drawn;
+            u32 meshes_culled;
+        } s64CullStats;
+    #endif
+    
+    typedef struct {
+        u32 calcanim_cycles;
+        u32 calcanim_calls;
+        u32 drawpart_cycles;
+        u32 drawpart_calls;
+        u32 lookat_cycles;
+        u32 lookat_calls;
+        u32 gendlist_cycles;
+        u32 gendlist_calls;
+        u32 gfxcommands;
+        u32 model_bytes;
+        u32 helper_bytes;
+    } s64Stats;
+
 
     /*********************************
               Asset Loading
     *********************************/
     
+    /*==============================
+        sausage64_set_allocator
+        Sets the functions used to allocate and free the memory
+        of binary models, model helpers and the draw queue (Libdragon)
+        @param The allocation function, or NULL to use malloc.
+               It must return memory aligned to 16 bytes
+        @param The free function, or NULL to use free
+    ==============================*/
+    
+    extern void sausage64_set_allocator(void* (*allocfunc)(u32), void (*freefunc)(void*));
+    
+    
+    /*==============================
+        sausage64_set_animstreaming
+        Makes binary models loaded after this call keep their
+        animations in ROM, and only load them when they are
+        played. Older animations are evicted when the pool of
+        animation slots fills up. A helper needs a slot for its
+        animation, one for the blend and one per layer
+        @param The number of animations to keep in memory per
+               model (at least 2), or 0 to load every animation
+    ==============================*/
+    
+    extern void sausage64_set_animstreaming(u16 slots);
+    
+    
     /*==============================
         sausage64_load_binarymodel
         Load a binary model from ROM
@@ -193,6 +389,57 @@
     #endif
 
 
+    /*==============================
+        sausage64_load_binarymodel_begin
+        Starts loading a binary model in the background.
+        Call sausage64_load_binarymodel_poll every frame
+        until it returns TRUE
+        @param  (Libultra) The starting address in ROM
+        @param  (Libdragon) The dfs file path of the asset.
+                            It is copied, so it doesn't need
+                            to outlive this call
+        @param  (Libultra) The size of the model
+        @param  (Libultra) The list of textures to use
+        @param  (Libdragon) The list of texture sprites
+        @return The loading state, or NULL if it failed
+    ==============================*/
+
+    #ifndef LIBDRAGON
+        extern s64LoadState* sausage64_load_binarymodel_begin(u32 romstart, u32 size, u32** textures);
+    #else
+        extern s64LoadState* sausage64_load_binarymodel_begin(char* filepath, sprite_t** textures);
+    #endif
+
+
+    /*==============================
+        sausage64_load_binarymodel_poll
+        Continues loading a binary model for, at most,
+        the given amount of time. Reading each table entry,
+        and building each material, mesh and animation, are
+        separate steps, and each one starts as soon as the
+        part of the file it needs has been read. A frame is
+        never held up by more than one of them past the budget
+        @param  The loading state
+        @param  The maximum number of microseconds to spend
+        @return Whether the model is ready to be finished
+    ==============================*/
+    
+    extern u8 sausage64_load_binarymodel_poll(s64LoadState* state, u32 budget);
+
+
+    /*==============================
+        sausage64_load_binarymodel_finish
+        Finishes loading a binary model, doing whatever
+        steps are left without a time limit.
+        The loading state is freed
+        @param  The loading state
+        @return The newly allocated model, or NULL if
+                it failed
+    ==============================*/
+    
+    extern s64ModelData* sausage64_load_binarymodel_finish(s64LoadState* state);
+
+
     /*==============================
         sausage64_unload_binarymodel
         Free the memory used by a dynamically loaded binary model
@@ -200,6 +447,47 @@
     ==============================*/
     
     extern void sausage64_unload_binarymodel(s64ModelData* mdl);
+
+    
+    /*==============================
+        sausage64_get_animsavings
+        Get how many bytes of RAM were saved by loading
+        quantized animations instead of float ones
+        @param  The model to check
+        @return The number of bytes saved
+    ==============================*/
+    
+    extern u32 sausage64_get_animsavings(const s64ModelData* mdl);
+    
+    
+    /*==============================
+        sausage64_get_modelmemory
+        Get how many bytes of heap a binary model is holding,
+        including the file data it uses in place and the
+        instancing display lists (Libultra). OpenGL objects
+        are not counted (Libdragon)
+        @param  The model to check
+        @return The number of bytes used
+    ==============================*/
+    
+    extern u32 sausage64_get_modelmemory(const s64ModelData* mdl);
+    
+    
+    /*==============================
+        sausage64_set_posecache
+        Gives a model a cache of animation poses, so that helpers
+        playing the same animation at the same tick calculate it
+        only once. Only helpers which aren't blending or playing
+        layers use the cache
+        @param  The model to give the cache to
+        @param  The number of poses to remember, or 0 to remove
+                the cache
+        @param  The tick step to snap to before looking up a pose,
+                or 0 to only share exactly matching ticks
+        @return 1 if successful, 0 if the cache couldn't be allocated
+    ==============================*/
+    
+    extern u8 sausage64_set_posecache(s64ModelData* mdl, u16 count, f32 step);
     
 
     #ifdef LIBDRAGON
@@ -271,6 +559,16 @@
 
     extern void sausage64_freehelper(s64ModelHelper* helper);
     
+    
+    /*==============================
+        sausage64_get_helpermemory
+        Get how many bytes of heap a model helper is holding
+        @param  The model helper pointer
+        @return The number of bytes used
+    ==============================*/
+    
+    extern u32 sausage64_get_helpermemory(const s64ModelHelper* helper);
+    
 
     #ifdef LIBDRAGON
          /*==============================
@@ -280,6 +578,17 @@
         ==============================*/
     
         extern void sausage64_loadmaterial(s64Material* mat);
+
+
+        /*==============================
+            sausage64_reset_glstate
+            Forgets the OpenGL state that the last loaded
+            material set, so that the next material is loaded
+            in full. Call this at the start of every frame, and
+            whenever you change the OpenGL state yourself
+        ==============================*/
+    
+        extern void sausage64_reset_glstate();
     #endif
 
 
@@ -297,6 +606,94 @@
         extern void sausage64_set_camera(f32 campos[3]);
     #endif
 
+
+    #ifndef LIBDRAGON
+        /*==============================
+            sausage64_set_cullmatrix
+            Sets the matrix that the model will be drawn with, so
+            that the parts of it which are outside of the camera's
+            view can be skipped. Call it after sausage64_set_camera,
+            every time the camera or the model moves
+            @param The model helper pointer
+            @param The model matrix, or NULL to disable culling
+        ==============================*/
+        
+        extern void sausage64_set_cullmatrix(s64ModelHelper* mdl, Mtx* model);
+        
+        
+        /*==============================
+            sausage64_set_lodsize
+            Sets how much of the screen's height a mesh must
+            cover before it gets drawn with its first LOD. Each
+            extra LOD is used once the mesh is half as big as
+            the previous one. LODs are only picked while a cull
+            matrix is set
+            @param The model helper pointer
+            @param The fraction of the screen height, or 0 to
+                   always draw the full detail meshes
+        ==============================*/
+        
+        extern void sausage64_set_lodsize(s64ModelHelper* mdl, f32 size);
+        
+        
+        /*==============================
+            sausage64_set_modelview
+            Makes the model get drawn with matrices that already
+            contain the given model to view matrix. Each mesh then
+            loads its matrix instead of pushing, multiplying, and
+            popping the matrix stack. The modelview matrix will hold
+            the last drawn mesh's matrix afterwards, so reload your
+            own before drawing anything else. Call it every time the
+            camera or the model moves
+            @param The model helper pointer
+            @param The model to view matrix, or NULL to go back to
+                   multiplying with the matrix stack
+        ==============================*/
+        
+        extern void sausage64_set_modelview(s64ModelHelper* mdl, Mtx* modelview);
+        
+        
+        /*==============================
+            sausage64_get_cullstats
+            Gets how many models and meshes were drawn and culled
+            since the last time the statistics were reset
+            @param The struct to fill with the statistics
+        ==============================*/
+        
+        extern void sausage64_get_cullstats(s64CullStats* stats);
+        
+        
+        /*==============================
+            sausage64_reset_cullstats
+            Resets the culling statistics back to zero
+        ==============================*/
+        
+        extern void sausage64_reset_cullstats();
+        
+        
+        /*==============================
+            sausage64_reset_rdpstate
+            Forgets the render state that the material display
+            lists left behind, so that the next material is set
+            up in full. Only matters for models exported with material
+            display lists. Call this at the start of every frame,
+            and whenever you change the render state yourself
+            between models
+        ==============================*/
+        
+        extern void sausage64_reset_rdpstate();
+        
+        
+        /*==============================
+            sausage64_next_frame
+            Moves every model helper onto the next set of
+            matrices. Call this once at the start of every
+            frame, before drawing any models
+        ==============================*/
+        
+        extern void sausage64_next_frame();
+    #endif
+
     
     /*==============================
         sausage64_set_anim
@@ -321,6 +718,77 @@
     extern void sausage64_set_anim_blend(s64ModelHelper* mdl, u16 anim, f32 ticks);
     
     
+    /*==============================
+        sausage64_set_layercount
+        Sets how many animation layers the model has. Layers
+        are blended on top of the main animation, in order,
+        when the pose is calculated. New layers start with no
+        animation and a weight of zero
+        @param  The model helper pointer
+        @param  The number of layers, or 0 to remove them all
+        @return Whether the layers could be allocated. Fails if
+                the model streams its animations and has fewer
+                than count+2 slots
+    ==============================*/
+    
+    extern u8 sausage64_set_layercount(s64ModelHelper* mdl, u8 count);
+    
+    
+    /*==============================
+        sausage64_set_layeranim
+        Sets the animation that an animation layer plays.
+        Does not perform error checking if an invalid layer
+        or animation is given.
+        @param The model helper pointer
+        @param The layer to change
+        @param The ANIMATION_* macro to set
+    ==============================*/
+    
+    extern void sausage64_set_layeranim(s64ModelHelper* mdl, u8 layer, u16 anim);
+    
+    
+    /*==============================
+        sausage64_set_layerweight
+        Sets how much an animation layer overrides the
+        layers below it
+        @param The model helper pointer
+        @param The layer to change
+        @param The weight, from 0.0 (ignored) to 1.0 (replaces
+               the pose below it)
+    ==============================*/
+    
+    extern void sausage64_set_layerweight(s64ModelHelper* mdl, u8 layer, f32 weight);
+    
+    
+    /*==============================
+        sausage64_set_layermask
+        Sets how much each mesh is affected by an animation
+        layer. The mask is not copied, so it must stay valid
+        while the layer uses it
+        @param The model helper pointer
+        @param The layer to change
+        @param An array with a weight for every mesh, which is
+               multiplied with the layer's weight, or NULL to
+               affect every mesh fully
+    ==============================*/
+    
+    extern void sausage64_set_layermask(s64ModelHelper* mdl, u8 layer, const f32* mask);
+    
+    
+    /*==============================
+        sausage64_fill_layermask
+        Sets the weight of a mesh and every mesh below it in
+        the hierarchy in a layer mask. Useful for making a
+        layer only affect a character's upper body, for instance
+        @param The model helper pointer
+        @param The mask to fill, with a weight for every mesh
+        @param The mesh at the top of the hierarchy to fill
+        @param The weight to set
+    ==============================*/
+    
+    extern void sausage64_fill_layermask(s64ModelHelper* mdl, f32* mask, u16 mesh, f32 weight);
+    
+    
     /*==============================
         sausage64_set_animcallback
         Set a function that gets called when an animation finishes
@@ -361,10 +829,35 @@
     extern void sausage64_advance_anim(s64ModelHelper* mdl, f32 tickamount);
     
     
+    /*==============================
+        sausage64_advance_anim_batch
+        Advances the animation tick of multiple model helpers
+        by the same amount
+        @param The list of model helper pointers
+        @param The number of model helpers in the list
+        @param The amount to increase the animation tick by
+    ==============================*/
+    
+    extern void sausage64_advance_anim_batch(s64ModelHelper** mdls, u32 count, f32 tickamount);
+    
+    
+    /*==============================
+        sausage64_evaluate_pose
+        Calculates the transforms of every mesh for the current
+        frame. Drawing, lookat and transform queries will reuse
+        them until the model is drawn again
+        @param The model helper pointer
+    ==============================*/
+    
+    extern void sausage64_evaluate_pose(s64ModelHelper* mdl);
+    
+    
     /*==============================
         sausage64_get_meshtransform
         Get the current transform of the mesh,
-        local to the object
+        local to the object. The helper stops sharing
+        matrices with the pose cache for the rest of
+        the frame, since the transform can be modified
         @param  The model helper pointer
         @param  The mesh to check
         @return The mesh's local transform
@@ -373,6 +866,19 @@
     extern s64Transform* sausage64_get_meshtransform(s64ModelHelper* mdl, const u16 mesh);
     
     
+    /*==============================
+        sausage64_calctransforms_batch
+        Calculates the transforms of every mesh for multiple
+        model helpers, so that drawing them later doesn't
+        need to. Helpers with streamed animations are grouped
+        by animation, so each one is read from ROM only once
+        @param The list of model helper pointers
+        @param The number of model helpers in the list
+    ==============================*/
+    
+    extern void sausage64_calctransforms_batch(s64ModelHelper** mdls, u32 count);
+    
+    
     /*==============================
         sausage64_lookat
         Make a mesh look at another
@@ -380,7 +886,7 @@
         @param The mesh to force the lookat
         @param The normalized direction vector
         @param A value from 1.0 to 0.0 stating how much to look at the object
-        @param Whether the lookat should propagate to the children meshes (up to one level)
+        @param Whether the lookat should propagate to the children meshes (and their children, all the way down)
     ==============================*/
     
     extern void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amount, u8 affectchildren);
@@ -400,4 +906,80 @@
         extern void sausage64_drawmodel(s64ModelHelper* mdl);
     #endif
 
+
+    /*==============================
+        sausage64_drawinstances
+        Renders many instances of the same Sausage64 model,
+        going mesh by mesh so that the render state of each
+        mesh is only set up once for all the instances
+        @param (Libultra) A pointer to a display list pointer
+        @param The list of model helpers, which must all use
+               the same model data
+        @param The number of model helpers
+    ==============================*/
+    
+    #ifndef LIBDRAGON
+        extern void sausage64_drawinstances(Gfx** glistp, s64ModelHelper** helpers, u32 count);
+    #else
+        extern void sausage64_drawinstances(s64ModelHelper** helpers, u32 count);
+    #endif
+
+
+    #ifdef LIBDRAGON
+        /*==============================
+            sausage64_queue_model
+            Adds a Sausage64 model to the draw queue, using the
+            current modelview matrix. Nothing is drawn until
+            sausage64_draw_queue is called. The predraw function
+            is called right away and can still skip meshes or
+            load a material, but the postdraw function is not
+            called for queued models
+            @param  The model helper data
+            @return Whether the model could be queued
+        ==============================*/
+        
+        extern u8 sausage64_queue_model(s64ModelHelper* mdl);
+        
+        
+        /*==============================
+            sausage64_draw_queue
+            Draws everything in the draw queue, sorted by
+            material, and then empties it
+        ==============================*/
+        
+        extern void sausage64_draw_queue();
+        
+        
+        /*==============================
+            sausage64_free_queue
+            Frees the memory used up by the draw queue
+        ==============================*/
+        
+        extern void sausage64_free_queue();
+    #endif
+
+
+    /*==============================
+        sausage64_get_stats
+        Gets the profiling counters collected since the last
+        time they were reset, along with how much heap the
+        loaded binary models and the model helpers are holding.
+        The counters stay at zero unless S64_PROFILE is defined.
+        Cycles are in S64_PROFILE_CLOCK ticks, and wrap around,
+        so reset them often (every frame, for example)
+        @param The struct to fill with the statistics
+    ==============================*/
+    
+    extern void sausage64_get_stats(s64Stats* stats);
+    
+    
+    /*==============================
+        sausage64_reset_stats
+        Resets the profiling cycle, call, and display list
+        command counters back to zero. The heap usage is
+        left alone
+    ==============================*/
+    
+    extern void sausage64_reset_stats();
+
 #endif
\ No newline at end of file
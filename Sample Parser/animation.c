@@ -7,6 +7,7 @@ Handles the parsing and creation of animations
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "main.h"
 #include "material.h"
 #include "mesh.h"
@@ -71,4 +72,152 @@ s64Transform* add_framedata(s64Keyframe* frame)
         terminate("Error: Unable to allocate memory for animation framedata\n");
     list_append(&(frame->framedata), fdata);
     return fdata;
-}
\ No newline at end of file
+}
+
+
+/*==============================
+    find_framedata
+    Finds the transform of a mesh in a keyframe
+    @param A pointer to the keyframe
+    @param A pointer to the mesh
+    @returns A pointer to the mesh's framedata, or NULL
+==============================*/
+
+static s64Transform* find_framedata(s64Keyframe* keyf, s64Mesh* mesh)
+{
+    listNode* fdatanode;
+    for (fdatanode = keyf->framedata.head; fdatanode != NULL; fdatanode = fdatanode->next)
+        if (((s64Transform*)fdatanode->data)->mesh == mesh)
+            return (s64Transform*)fdatanode->data;
+    return NULL;
+}
+
+
+/*==============================
+    bake_animation
+    Resamples an animation so that it has a keyframe on every
+    tick. The ticks in between the original keyframes are
+    interpolated the same way the library does it at runtime
+    @param A pointer to the animation
+==============================*/
+
+static void bake_animation(s64Anim* anim)
+{
+    unsigned int tick, lasttick;
+    linkedList bakedframes = EMPTY_LINKEDLIST;
+    listNode* curnode = anim->keyframes.head;
+    listNode* kfnode;
+    if (anim->keyframes.size == 0)
+        return;
+    
+    // Generate a keyframe for every tick, up to and including the last keyframe
+    lasttick = ((s64Keyframe*)anim->keyframes.tail->data)->keyframe;
+    for (tick=0; tick<=lasttick; tick++)
+    {
+        float l = 0;
+        listNode* meshnode;
+        s64Keyframe* cur;
+        s64Keyframe* next;
+        s64Keyframe* keyf;
+        
+        // Find the keyframes on either side of this tick
+        while (curnode->next != NULL && ((s64Keyframe*)curnode->next->data)->keyframe <= tick)
+            curnode = curnode->next;
+        cur = (s64Keyframe*)curnode->data;
+        next = (curnode->next != NULL) ? (s64Keyframe*)curnode->next->data : cur;
+        if (next->keyframe > cur->keyframe && tick > cur->keyframe)
+            l = ((float)(tick - cur->keyframe))/((float)(next->keyframe - cur->keyframe));
+        
+        // Create the new keyframe
+        keyf = (s64Keyframe*)calloc(1, sizeof(s64Keyframe));
+        if (keyf == NULL)
+            terminate("Error: Unable to allocate memory for baked animation keyframe\n");
+        keyf->keyframe = tick;
+        list_append(&bakedframes, keyf);
+        
+        // Interpolate every mesh's transform
+        for (meshnode = list_meshes.head; meshnode != NULL; meshnode = meshnode->next)
+        {
+            float dot, norm;
+            s64Mesh* mesh = (s64Mesh*)meshnode->data;
+            s64Transform* a = find_framedata(cur, mesh);
+            s64Transform* b = find_framedata(next, mesh);
+            s64Transform* fdata;
+            Vector4D brot;
+            if (a == NULL)
+                continue;
+            if (b == NULL)
+                b = a;
+            fdata = add_framedata(keyf);
+            fdata->mesh = mesh;
+            fdata->translation.x = a->translation.x + l*(b->translation.x - a->translation.x);
+            fdata->translation.y = a->translation.y + l*(b->translation.y - a->translation.y);
+            fdata->translation.z = a->translation.z + l*(b->translation.z - a->translation.z);
+            fdata->scale.x = a->scale.x + l*(b->scale.x - a->scale.x);
+            fdata->scale.y = a->scale.y + l*(b->scale.y - a->scale.y);
+            fdata->scale.z = a->scale.z + l*(b->scale.z - a->scale.z);
+            
+            // Rotations take the shortest path, and are normalized after being lerped. Ticks that land on a keyframe keep its rotation as is
+            fdata->rotation = a->rotation;
+            if (l == 0)
+                continue;
+            brot = b->rotation;
+            dot = a->rotation.w*brot.w + a->rotation.x*brot.x + a->rotation.y*brot.y + a->rotation.z*brot.z;
+            if (dot < 0)
+            {
+                brot.w = -brot.w;
+                brot.x = -brot.x;
+                brot.y = -brot.y;
+                brot.z = -brot.z;
+            }
+            fdata->rotation.w += l*(brot.w - a->rotation.w);
+            fdata->rotation.x += l*(brot.x - a->rotation.x);
+            fdata->rotation.y += l*(brot.y - a->rotation.y);
+            fdata->rotation.z += l*(brot.z - a->rotation.z);
+            norm = sqrtf(fdata->rotation.w*fdata->rotation.w + fdata->rotation.x*fdata->rotation.x + fdata->rotation.y*fdata->rotation.y + fdata->rotation.z*fdata->rotation.z);
+            if (norm > 0)
+            {
+                fdata->rotation.w /= norm;
+                fdata->rotation.x /= norm;
+                fdata->rotation.y /= norm;
+                fdata->rotation.z /= norm;
+            }
+        }
+    }
+    
+    // Replace the original keyframes with the baked ones
+    for (kfnode = anim->keyframes.head; kfnode != NULL; kfnode = kfnode->next)
+        list_destroy_deep(&((s64Keyframe*)kfnode->data)->framedata);
+    list_destroy_deep(&anim->keyframes);
+    anim->keyframes = bakedframes;
+    anim->baked = TRUE;
+}
+
+
+/*==============================
+    bake_animations
+    Bakes every animation that was requested with '-b'
+==============================*/
+
+void bake_animations()
+{
+    listNode* namenode;
+    if (!global_quiet) printf("Baking animations\n");
+    for (namenode = list_bakeanims.head; namenode != NULL; namenode = namenode->next)
+    {
+        listNode* animnode;
+        char* name = (char*)namenode->data;
+        for (animnode = list_animations.head; animnode != NULL; animnode = animnode->next)
+        {
+            s64Anim* anim = (s64Anim*)animnode->data;
+            if (!strcmp(anim->name, name))
+            {
+                if (!anim->baked)
+                    bake_animation(anim);
+                break;
+            }
+        }
+        if (animnode == NULL)
+            printf("Warning: No animation named '%s' to bake\n", name);
+    }
+}
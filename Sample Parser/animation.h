@@ -23,6 +23,7 @@
     typedef struct {
         char* name;
         linkedList keyframes;
+        bool baked;
     } s64Anim;
     
     
@@ -33,5 +34,6 @@
     extern s64Anim*      add_animation(char* name);
     extern s64Keyframe*  add_keyframe(s64Anim* anim, unsigned int keyframe);
     extern s64Transform* add_framedata(s64Keyframe* frame);
+    extern void          bake_animations();
     
 #endif
\ No newline at end of file
@@ -20,6 +20,26 @@ Constructs a display list string for outputting later.
 
 #define generate(c, ...) (generator(c, commands_f3dex2[c].argcount, ##__VA_ARGS__))
 
+// F3DEX2 opcodes used when assembling binary display lists
+#define F3DEX2_VTX            0x01
+#define F3DEX2_TRI1           0x05
+#define F3DEX2_TRI2           0x06
+#define F3DEX2_GEOMETRYMODE   0xD9
+#define F3DEX2_DL             0xDE
+#define F3DEX2_ENDDL          0xDF
+#define F3DEX2_SETOTHERMODE_L 0xE2
+#define F3DEX2_SETOTHERMODE_H 0xE3
+#define F3DEX2_RDPLOADSYNC    0xE6
+#define F3DEX2_RDPPIPESYNC    0xE7
+#define F3DEX2_SETTILESIZE    0xF2
+#define F3DEX2_LOADBLOCK      0xF3
+#define F3DEX2_SETTILE        0xF5
+#define F3DEX2_SETPRIMCOLOR   0xFA
+#define F3DEX2_SETCOMBINE     0xFC
+#define F3DEX2_SETTIMG        0xFD
+
+#define shiftl(v, s, w) ((uint32_t)(((uint32_t)(v) & ((0x01 << (w)) - 1)) << (s)))
+
 
 /*********************************
               Globals
@@ -40,6 +60,7 @@ const DListCName supported_binary[] = {
     SP1Triangle,
     SP2Triangles,
     DPPipeSync,
+    SPDisplayList,
     SPEndDisplayList
 }; 
 
@@ -301,6 +322,168 @@ static void* _dlist_commandbinary(DListCName c, int size, ...)
 }
 
 
+/*==============================
+    dlist_setupmaterial
+    Appends the commands that change the render state
+    from the last material to a new one
+    @param The list to append the commands to
+    @param The material to change to
+    @param The command generation function
+==============================*/
+
+static void dlist_setupmaterial(linkedList* out, n64Material* mat, void* (*generator)(DListCName c, int size, ...))
+{
+    char strbuff[STRBUF_SIZE];
+    int i;
+    bool pipesync = FALSE;
+    bool changedgeo = FALSE;
+    
+    // Check for different cycle type
+    if (lastMaterial == NULL || strcmp(mat->cycle, lastMaterial->cycle) != 0)
+    {
+        list_append(out, generate(DPSetCycleType, mat->cycle));
+        pipesync = TRUE;
+    }
+    
+    // Check for different render mode
+    if (lastMaterial == NULL || strcmp(mat->rendermode1, lastMaterial->rendermode1) != 0 || strcmp(mat->rendermode2, lastMaterial->rendermode2) != 0)
+    {
+        list_append(out, generate(DPSetRenderMode, mat->rendermode1, mat->rendermode2));
+        pipesync = TRUE;
+    }
+    
+    // Check for different combine mode
+    if (lastMaterial == NULL || strcmp(mat->combinemode1, lastMaterial->combinemode1) != 0 || strcmp(mat->combinemode2, lastMaterial->combinemode2) != 0)
+    {
+        list_append(out, generate(DPSetCombineMode, mat->combinemode1, mat->combinemode2));
+        pipesync = TRUE;
+    }
+    
+    // Check for different texture filter
+    if (lastMaterial == NULL || strcmp(mat->texfilter, lastMaterial->texfilter) != 0)
+    {
+        list_append(out, generate(DPSetTextureFilter, mat->texfilter));
+        pipesync = TRUE;
+    }
+    
+    // Check for different geometry mode
+    if (lastMaterial != NULL)
+    {
+        int flagcount_old = 0;
+        int flagcount_new = 0;
+        char* flags_old[MAXGEOFLAGS];
+        char* flags_new[MAXGEOFLAGS];
+
+        // Store the pointer to the flags somewhere to make the iteration easier
+        for (i=0; i<MAXGEOFLAGS; i++)
+        {
+            if (mat->geomode[i][0] != '\0')
+            {
+                flags_new[flagcount_new] = mat->geomode[i];
+                flagcount_new++;
+            }
+            if (lastMaterial->geomode[i][0] != '\0')
+            {
+                flags_old[flagcount_old] = lastMaterial->geomode[i];
+                flagcount_old++;
+            }
+        }
+
+        // Check if all the flags exist in this other texture
+        if (flagcount_new == flagcount_old)
+        {
+            int j;
+            bool hasthisflag = FALSE;
+            for (i=0; i<flagcount_new; i++)
+            {
+                for (j=0; j<flagcount_old; j++)
+                {
+                    if (!strcmp(flags_new[i], flags_old[j]))
+                    {
+                        hasthisflag = TRUE;
+                        break;
+                    }
+                }
+                if (!hasthisflag)
+                {
+                    changedgeo = TRUE;
+                    break;
+                }
+            }
+        }
+        else
+            changedgeo = TRUE;
+    }
+    else
+        changedgeo = TRUE;
+        
+    // If a geometry mode flag changed, then update the display list
+    if (changedgeo)
+    {
+        bool appendline = FALSE;
+    
+        // TODO: Smartly omit geometry flags commands based on what changed
+        list_append(out, generate(SPClearGeometryMode, "0xFFFFFFFF"));
+        strbuff[0] = '\0';
+        for (i=0; i<MAXGEOFLAGS; i++)
+        {
+            if (mat->geomode[i][0] == '\0')
+                continue;
+            if (appendline)
+            {
+                strcat(strbuff, " | ");
+                appendline = FALSE;
+            }
+            strcat(strbuff, mat->geomode[i]);
+            appendline = TRUE;
+        }
+        list_append(out, generate(SPSetGeometryMode, strbuff));
+    }
+    
+    // Load the material if it wasn't marked as DONTLOAD
+    if (!mat->dontload)
+    {
+        char d1[32], d2[32], d3[32], d4[32];
+        if (mat->type == TYPE_TEXTURE)
+        {
+            sprintf(d1, "%d", mat->data.image.w);
+            sprintf(d2, "%d", mat->data.image.h);
+            sprintf(d3, "%d", nearest_pow2(mat->data.image.w));
+            sprintf(d4, "%d", nearest_pow2(mat->data.image.h));
+            if (!strcmp(mat->data.image.colsize, "G_IM_SIZ_4b"))
+            {
+                list_append(out, generate(DPLoadTextureBlock_4b, 
+                    mat->name, mat->data.image.coltype, d1, d2, "0",
+                    mat->data.image.texmodes, mat->data.image.texmodet, d3, d4, "G_TX_NOLOD", "G_TX_NOLOD")
+                );
+            }
+            else
+            {
+                list_append(out, generate(DPLoadTextureBlock, 
+                    mat->name, mat->data.image.coltype, mat->data.image.colsize, d1, d2, "0",
+                    mat->data.image.texmodes, mat->data.image.texmodet, d3, d4, "G_TX_NOLOD", "G_TX_NOLOD")
+                );
+            }
+            pipesync = TRUE;
+        }
+        else if (mat->type == TYPE_PRIMCOL)
+        {
+            sprintf(d1, "%d", mat->data.color.r);
+            sprintf(d2, "%d", mat->data.color.g);
+            sprintf(d3, "%d", mat->data.color.b);
+            list_append(out, generate(DPSetPrimColor, "0", "0", d1, d2, d3, "255"));
+        }
+    }
+    
+    // Call a pipesync if needed
+    if (pipesync)
+        list_append(out, generate(DPPipeSync));
+
+    // Update the last texture
+    lastMaterial = mat;
+}
+
+
 /*==============================
     dlist_frommesh
     Constructs a display list from a single mesh
@@ -314,6 +497,7 @@ linkedList* dlist_frommesh(s64Mesh* mesh, char isbinary)
     char strbuff[STRBUF_SIZE];
     linkedList* out = list_new();
     bool ismultimesh = (list_meshes.size > 1);
+    bool splitmats = (isbinary && global_matdlists);
     int vertindex = 0;
     if (out == NULL)
         terminate("Error: Unable to malloc for output list\n");
@@ -324,6 +508,10 @@ linkedList* dlist_frommesh(s64Mesh* mesh, char isbinary)
         generator = &_dlist_commandbinary;
     else
         generator = &_dlist_commandstring;
+        
+    // With split materials, every mesh calls its first material itself, since the library decides at runtime which calls to skip
+    if (splitmats)
+        lastMaterial = NULL;
 
     // Loop through the vertex caches
     for (listNode* vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
@@ -339,159 +527,20 @@ linkedList* dlist_frommesh(s64Mesh* mesh, char isbinary)
             n64Material* mat = face->material;
             
             // If we want to skip the initial display list setup, then change the value of our last texture to skip the next if statement
-            if (lastMaterial == NULL && !global_initialload)
+            if (lastMaterial == NULL && !global_initialload && !splitmats)
                 lastMaterial = mat;
         
-            // If a texture change was detected, load the new texture data
+            // If a texture change was detected, load the new texture data (or call its display list if materials are split)
             if (lastMaterial != mat && mat->type != TYPE_OMIT)
             {
-                int i;
-                bool pipesync = FALSE;
-                bool changedgeo = FALSE;
-                
-                // Check for different cycle type
-                if (lastMaterial == NULL || strcmp(mat->cycle, lastMaterial->cycle) != 0)
-                {
-                    list_append(out, generate(DPSetCycleType, mat->cycle));
-                    pipesync = TRUE;
-                }
-                
-                // Check for different render mode
-                if (lastMaterial == NULL || strcmp(mat->rendermode1, lastMaterial->rendermode1) != 0 || strcmp(mat->rendermode2, lastMaterial->rendermode2) != 0)
-                {
-                    list_append(out, generate(DPSetRenderMode, mat->rendermode1, mat->rendermode2));
-                    pipesync = TRUE;
-                }
-                
-                // Check for different combine mode
-                if (lastMaterial == NULL || strcmp(mat->combinemode1, lastMaterial->combinemode1) != 0 || strcmp(mat->combinemode2, lastMaterial->combinemode2) != 0)
+                if (splitmats)
                 {
-                    list_append(out, generate(DPSetCombineMode, mat->combinemode1, mat->combinemode2));
-                    pipesync = TRUE;
-                }
-                
-                // Check for different texture filter
-                if (lastMaterial == NULL || strcmp(mat->texfilter, lastMaterial->texfilter) != 0)
-                {
-                    list_append(out, generate(DPSetTextureFilter, mat->texfilter));
-                    pipesync = TRUE;
-                }
-                
-                // Check for different geometry mode
-                if (lastMaterial != NULL)
-                {
-                    int flagcount_old = 0;
-                    int flagcount_new = 0;
-                    char* flags_old[MAXGEOFLAGS];
-                    char* flags_new[MAXGEOFLAGS];
-
-                    // Store the pointer to the flags somewhere to make the iteration easier
-                    for (i=0; i<MAXGEOFLAGS; i++)
-                    {
-                        if (mat->geomode[i][0] != '\0')
-                        {
-                            flags_new[flagcount_new] = mat->geomode[i];
-                            flagcount_new++;
-                        }
-                        if (lastMaterial->geomode[i][0] != '\0')
-                        {
-                            flags_old[flagcount_old] = lastMaterial->geomode[i];
-                            flagcount_old++;
-                        }
-                    }
-
-                    // Check if all the flags exist in this other texture
-                    if (flagcount_new == flagcount_old)
-                    {
-                        int j;
-                        bool hasthisflag = FALSE;
-                        for (i=0; i<flagcount_new; i++)
-                        {
-                            for (j=0; j<flagcount_old; j++)
-                            {
-                                if (!strcmp(flags_new[i], flags_old[j]))
-                                {
-                                    hasthisflag = TRUE;
-                                    break;
-                                }
-                            }
-                            if (!hasthisflag)
-                            {
-                                changedgeo = TRUE;
-                                break;
-                            }
-                        }
-                    }
-                    else
-                        changedgeo = TRUE;
+                    sprintf(strbuff, "%d", get_drawnmatindex(&list_materials, mat->name));
+                    list_append(out, generate(SPDisplayList, strbuff));
+                    lastMaterial = mat;
                 }
                 else
-                    changedgeo = TRUE;
-                    
-                // If a geometry mode flag changed, then update the display list
-                if (changedgeo)
-                {
-                    bool appendline = FALSE;
-                
-                    // TODO: Smartly omit geometry flags commands based on what changed
-                    list_append(out, generate(SPClearGeometryMode, "0xFFFFFFFF"));
-                    strbuff[0] = '\0';
-                    for (i=0; i<MAXGEOFLAGS; i++)
-                    {
-                        if (mat->geomode[i][0] == '\0')
-                            continue;
-                        if (appendline)
-                        {
-                            strcat(strbuff, " | ");
-                            appendline = FALSE;
-                        }
-                        strcat(strbuff, mat->geomode[i]);
-                        appendline = TRUE;
-                    }
-                    list_append(out, generate(SPSetGeometryMode, strbuff));
-                }
-                
-                // Load the material if it wasn't marked as DONTLOAD
-                if (!mat->dontload)
-                {
-                    char d1[32], d2[32], d3[32], d4[32];
-                    if (mat->type == TYPE_TEXTURE)
-                    {
-                        sprintf(d1, "%d", mat->data.image.w);
-                        sprintf(d2, "%d", mat->data.image.h);
-                        sprintf(d3, "%d", nearest_pow2(mat->data.image.w));
-                        sprintf(d4, "%d", nearest_pow2(mat->data.image.h));
-                        if (!strcmp(mat->data.image.colsize, "G_IM_SIZ_4b"))
-                        {
-                            list_append(out, generate(DPLoadTextureBlock_4b, 
-                                mat->name, mat->data.image.coltype, d1, d2, "0",
-                                mat->data.image.texmodes, mat->data.image.texmodet, d3, d4, "G_TX_NOLOD", "G_TX_NOLOD")
-                            );
-                        }
-                        else
-                        {
-                            list_append(out, generate(DPLoadTextureBlock, 
-                                mat->name, mat->data.image.coltype, mat->data.image.colsize, d1, d2, "0",
-                                mat->data.image.texmodes, mat->data.image.texmodet, d3, d4, "G_TX_NOLOD", "G_TX_NOLOD")
-                            );
-                        }
-                        pipesync = TRUE;
-                    }
-                    else if (mat->type == TYPE_PRIMCOL)
-                    {
-                        sprintf(d1, "%d", mat->data.color.r);
-                        sprintf(d2, "%d", mat->data.color.g);
-                        sprintf(d3, "%d", mat->data.color.b);
-                        list_append(out, generate(DPSetPrimColor, "0", "0", d1, d2, d3, "255"));
-                    }
-                }
-                
-                // Call a pipesync if needed
-                if (pipesync)
-                    list_append(out, generate(DPPipeSync));
-
-                // Update the last texture
-                lastMaterial = mat;
+                    dlist_setupmaterial(out, mat, generator);
             }
 
             // Load a new vertex block if it hasn't been
@@ -549,6 +598,57 @@ linkedList* dlist_frommesh(s64Mesh* mesh, char isbinary)
 }
 
 
+/*==============================
+    dlist_frommesh_standalone
+    Constructs a display list from a single mesh, which sets
+    up all of its own render state instead of relying on the
+    state left behind by the previous mesh
+    @param   The mesh to build a DL of
+    @param   Whether the DL should be binary
+    @returns A linked list with the DL data
+==============================*/
+
+linkedList* dlist_frommesh_standalone(s64Mesh* mesh, char isbinary)
+{
+    linkedList* out;
+    n64Material* prevmaterial = lastMaterial;
+    bool previnitialload = global_initialload;
+    lastMaterial = NULL;
+    global_initialload = TRUE;
+    out = dlist_frommesh(mesh, isbinary);
+    lastMaterial = prevmaterial;
+    global_initialload = previnitialload;
+    return out;
+}
+
+
+/*==============================
+    dlist_frommaterial
+    Constructs a binary display list which sets up all of
+    the render state of a single material, so that meshes
+    can call it instead of having it inlined
+    @param   The material to build a DL of
+    @returns A linked list with the DL data
+==============================*/
+
+linkedList* dlist_frommaterial(n64Material* mat)
+{
+    linkedList* out = list_new();
+    n64Material* prevmaterial = lastMaterial;
+    void* (*generator)(DListCName c, int size, ...) = &_dlist_commandbinary;
+    if (out == NULL)
+        terminate("Error: Unable to malloc for output list\n");
+    
+    // The material can be called after any geometry, so sync before changing the render state
+    lastMaterial = NULL;
+    list_append(out, generate(DPPipeSync));
+    dlist_setupmaterial(out, mat, generator);
+    list_append(out, generate(SPEndDisplayList));
+    lastMaterial = prevmaterial;
+    return out;
+}
+
+
 /*==============================
     construct_dltext
     Constructs a display list and stores it
@@ -653,4 +753,348 @@ void construct_dltext()
     // State we finished
     if (!global_quiet) printf("Finish building display lists\n");
     fclose(fp);
-}
\ No newline at end of file
+}
+
+/*==============================
+    assemble_triangle
+    Assembles the vertex indices of a triangle, rotated
+    by its flag like __gsSP1Triangle_w1f
+    @param   The three vertex indices, followed by the flag
+    @returns The assembled indices
+==============================*/
+
+static uint32_t assemble_triangle(uint8_t* tri)
+{
+    int first = (tri[3] == 1) ? 1 : (tri[3] == 2) ? 2 : 0;
+    return shiftl(tri[first]*2, 16, 8) | shiftl(tri[(first+1)%3]*2, 8, 8) | shiftl(tri[(first+2)%3]*2, 0, 8);
+}
+
+
+/*==============================
+    assemble_loadtextureblock
+    Assembles the 7 commands of a gDPLoadTextureBlock
+    (or gDPLoadTextureBlock_4b) into Gfx words. The texture
+    image pointer is left for the caller to fill in
+    @param   The Gfx buffer to fill
+    @param   The image format
+    @param   The image pixel size
+    @param   The width and height of the image
+    @param   The palette, clamp, mask and shift values
+    @returns The Gfx buffer, after the assembled commands
+==============================*/
+
+static uint32_t* assemble_loadtextureblock(uint32_t* gfx, int fmt, int siz, int width, int height, int pal, int cms, int cmt, int masks, int maskt, int shifts, int shiftt)
+{
+    int loadsiz, texels, linewords, dxtwords, dxt;
+    uint32_t tilemodes = shiftl(pal, 20, 4) | shiftl(cmt, 18, 2) | shiftl(maskt, 14, 4) | shiftl(shiftt, 10, 4) | shiftl(cms, 8, 2) | shiftl(masks, 4, 4) | shiftl(shifts, 0, 4);
+
+    // Work out the load size, number of texels to load, and the line sizes, like the siz##_ macros in gbi.h
+    switch (siz)
+    {
+        case 0: // G_IM_SIZ_4b
+            loadsiz = 2;
+            texels = ((width*height + 3) >> 2) - 1;
+            dxtwords = width/16;
+            linewords = ((width >> 1) + 7) >> 3;
+            break;
+        case 1: // G_IM_SIZ_8b
+            loadsiz = 2;
+            texels = ((width*height + 1) >> 1) - 1;
+            dxtwords = width/8;
+            linewords = (width + 7) >> 3;
+            break;
+        case 2: // G_IM_SIZ_16b
+            loadsiz = 2;
+            texels = width*height - 1;
+            dxtwords = (width*2)/8;
+            linewords = (width*2 + 7) >> 3;
+            break;
+        default: // G_IM_SIZ_32b
+            loadsiz = 3;
+            texels = width*height - 1;
+            dxtwords = (width*4)/8;
+            linewords = (width*2 + 7) >> 3;
+            break;
+    }
+    if (dxtwords < 1)
+        dxtwords = 1;
+    if (texels > 2047)
+        texels = 2047;
+    dxt = ((1 << 11) + dxtwords - 1)/dxtwords;
+
+    // gDPSetTextureImage
+    gfx[0] = shiftl(F3DEX2_SETTIMG, 24, 8) | shiftl(fmt, 21, 3) | shiftl(loadsiz, 19, 2);
+    gfx[1] = 0;
+
+    // gDPSetTile for the load tile
+    gfx[2] = shiftl(F3DEX2_SETTILE, 24, 8) | shiftl(fmt, 21, 3) | shiftl(loadsiz, 19, 2);
+    gfx[3] = shiftl(7, 24, 3) | (tilemodes & ~shiftl(0xF, 20, 4));
+
+    // gDPLoadSync
+    gfx[4] = shiftl(F3DEX2_RDPLOADSYNC, 24, 8);
+    gfx[5] = 0;
+
+    // gDPLoadBlock
+    gfx[6] = shiftl(F3DEX2_LOADBLOCK, 24, 8);
+    gfx[7] = shiftl(7, 24, 3) | shiftl(texels, 12, 12) | shiftl(dxt, 0, 12);
+
+    // gDPPipeSync
+    gfx[8] = shiftl(F3DEX2_RDPPIPESYNC, 24, 8);
+    gfx[9] = 0;
+
+    // gDPSetTile for the render tile
+    gfx[10] = shiftl(F3DEX2_SETTILE, 24, 8) | shiftl(fmt, 21, 3) | shiftl(siz, 19, 2) | shiftl(linewords, 9, 9);
+    gfx[11] = tilemodes;
+
+    // gDPSetTileSize
+    gfx[12] = shiftl(F3DEX2_SETTILESIZE, 24, 8);
+    gfx[13] = shiftl((width - 1) << 2, 12, 12) | shiftl((height - 1) << 2, 0, 12);
+    return gfx + 14;
+}
+
+
+/*==============================
+    assemble_command
+    Assembles a single binary display list command into
+    final F3DEX2 Gfx words
+    @param   The command to assemble
+    @param   The Gfx buffer to fill
+    @param   The slot of the command in the display list
+    @param   The relocation buffer to fill
+    @returns The number of relocations written
+==============================*/
+
+static int assemble_command(DLCBinary* bindl, uint32_t* gfx, int slot, uint32_t* relocs)
+{
+    int reloccount = 0;
+    uint32_t args[4] = {0};
+    uint8_t* bytes = (uint8_t*)bindl->data;
+    for (uint32_t i=0; i<bindl->size && i<4; i++)
+        args[i] = swap_endian32(bindl->data[i]);
+    switch (bindl->cmd)
+    {
+        case SPClearGeometryMode:
+            gfx[0] = shiftl(F3DEX2_GEOMETRYMODE, 24, 8) | shiftl(~args[0], 0, 24);
+            gfx[1] = 0;
+            break;
+        case SPSetGeometryMode:
+            gfx[0] = shiftl(F3DEX2_GEOMETRYMODE, 24, 8) | 0x00FFFFFF;
+            gfx[1] = args[0];
+            break;
+        case SPVertex:
+            relocs[reloccount++] = (GFXRELOC_VERTEX << 24) | slot;
+            gfx[0] = shiftl(F3DEX2_VTX, 24, 8) | shiftl((args[0] & 0x0000FF00) >> 8, 12, 8) | shiftl(((args[0] & 0x0000FF00) >> 8) + (args[0] & 0x000000FF), 1, 7);
+            gfx[1] = ((args[0] & 0xFFFF0000) >> 16)*16;
+            break;
+        case SP1Triangle:
+            gfx[0] = shiftl(F3DEX2_TRI1, 24, 8) | assemble_triangle(bytes);
+            gfx[1] = 0;
+            break;
+        case SP2Triangles:
+            gfx[0] = shiftl(F3DEX2_TRI2, 24, 8) | assemble_triangle(bytes);
+            gfx[1] = assemble_triangle(bytes+4);
+            break;
+        case DPSetPrimColor:
+            gfx[0] = shiftl(F3DEX2_SETPRIMCOLOR, 24, 8) | shiftl((args[0] & 0xFFFF0000) >> 16, 8, 8) | shiftl(args[0] & 0x0000FFFF, 0, 8);
+            gfx[1] = args[1];
+            break;
+        case DPSetCombineLERP: // The 16 bytes are a, b, c, d, Aa, Ab, Ac, Ad for both cycles
+            gfx[0] = shiftl(F3DEX2_SETCOMBINE, 24, 8) 
+                   | shiftl(bytes[0], 20, 4) | shiftl(bytes[2], 15, 5) | shiftl(bytes[4], 12, 3) | shiftl(bytes[6], 9, 3)
+                   | shiftl(bytes[8], 5, 4) | shiftl(bytes[10], 0, 5);
+            gfx[1] = shiftl(bytes[1], 28, 4) | shiftl(bytes[3], 15, 3) | shiftl(bytes[5], 12, 3) | shiftl(bytes[7], 9, 3)
+                   | shiftl(bytes[9], 24, 4) | shiftl(bytes[12], 21, 3) | shiftl(bytes[14], 18, 3) | shiftl(bytes[11], 6, 3) | shiftl(bytes[13], 3, 3) | shiftl(bytes[15], 0, 3);
+            break;
+        case DPPipeSync:
+            gfx[0] = shiftl(F3DEX2_RDPPIPESYNC, 24, 8);
+            gfx[1] = 0;
+            break;
+        case DPSetCycleType: // G_MDSFT_CYCLETYPE, 2 bits
+            gfx[0] = shiftl(F3DEX2_SETOTHERMODE_H, 24, 8) | shiftl(32 - 20 - 2, 8, 8) | shiftl(2 - 1, 0, 8);
+            gfx[1] = args[0];
+            break;
+        case DPSetTextureFilter: // G_MDSFT_TEXTFILT, 2 bits
+            gfx[0] = shiftl(F3DEX2_SETOTHERMODE_H, 24, 8) | shiftl(32 - 12 - 2, 8, 8) | shiftl(2 - 1, 0, 8);
+            gfx[1] = args[0];
+            break;
+        case DPSetRenderMode: // G_MDSFT_RENDERMODE, 29 bits
+            gfx[0] = shiftl(F3DEX2_SETOTHERMODE_L, 24, 8) | shiftl(32 - 3 - 29, 8, 8) | shiftl(29 - 1, 0, 8);
+            gfx[1] = args[0] | args[1];
+            break;
+        case DPLoadTextureBlock_4b:
+        case DPLoadTextureBlock:
+            relocs[reloccount++] = (GFXRELOC_TEXTURE << 24) | slot;
+            assemble_loadtextureblock(gfx, bytes[2], bytes[3], (args[1] & 0xFFFF0000) >> 16, args[1] & 0x0000FFFF,
+                bytes[8], bytes[9], bytes[10], bytes[11], bytes[12], bytes[13], bytes[14]
+            );
+            gfx[1] = (args[0] & 0xFFFF0000) >> 16;
+            break;
+        case SPDisplayList: // The command has the material index
+            relocs[reloccount++] = (GFXRELOC_MATERIAL << 24) | slot;
+            gfx[0] = shiftl(F3DEX2_DL, 24, 8);
+            gfx[1] = args[0];
+            break;
+        case SPEndDisplayList:
+            gfx[0] = shiftl(F3DEX2_ENDDL, 24, 8);
+            gfx[1] = 0;
+            break;
+        default:
+            break;
+    }
+    return reloccount;
+}
+
+
+/*==============================
+    dlist_assemble
+    Assembles a binary display list into final F3DEX2
+    Gfx words, so that loading it is just a copy. Vertex and
+    texture pointers aren't known until the model is loaded,
+    so those commands store the vertex offset (in bytes) or
+    the texture index instead, and get a relocation entry
+    @param   The binary display list to assemble
+    @param   The Gfx buffer to fill (two words per slot)
+    @param   The relocation buffer to fill
+    @returns The number of relocations written
+==============================*/
+
+int dlist_assemble(linkedList* dl, uint32_t* gfx, uint32_t* relocs)
+{
+    int reloccount = 0;
+    uint32_t* gfxstart = gfx;
+    for (listNode* dllnode = dl->head; dllnode != NULL; dllnode = dllnode->next)
+    {
+        DLCBinary* bindl = (DLCBinary*)dllnode->data;
+        reloccount += assemble_command(bindl, gfx, (gfx - gfxstart)/2, &relocs[reloccount]);
+        gfx += 2*commands_f3dex2[bindl->cmd].size;
+    }
+    return reloccount;
+}
+
+
+/*==============================
+    dlist_slotcount
+    Counts how many Gfx slots a binary display list takes
+    up once it's assembled
+    @param   The binary display list to count
+    @param   Whether the display list will be assembled
+             with dlist_assemble_split
+    @returns The number of Gfx slots
+==============================*/
+
+int dlist_slotcount(linkedList* dl, bool split)
+{
+    int slotcount = 0;
+    bool insegment = FALSE;
+    for (listNode* dllnode = dl->head; dllnode != NULL; dllnode = dllnode->next)
+    {
+        DLCBinary* bindl = (DLCBinary*)dllnode->data;
+        if (!split)
+            slotcount += commands_f3dex2[bindl->cmd].size;
+        else if (bindl->cmd == SPDisplayList)
+        {
+            slotcount++;
+            insegment = FALSE;
+        }
+        else if (bindl->cmd != SPEndDisplayList)
+        {
+            // A new geometry segment needs a call in the header and its own end command
+            if (!insegment)
+                slotcount += 2;
+            slotcount += commands_f3dex2[bindl->cmd].size;
+            insegment = TRUE;
+        }
+    }
+    
+    // The header needs its own end command
+    if (split)
+        slotcount++;
+    return slotcount;
+}
+
+
+/*==============================
+    dlist_assemble_split
+    Assembles a binary display list with material calls in
+    it into a header, which only has the calls to the
+    material display lists and to each stretch of geometry
+    between them, followed by the geometry itself. This way
+    the library can walk the header and skip calls to the
+    material that's already loaded. Calls to the geometry
+    store the slot they start at, and get a relocation entry
+    @param   The binary display list to assemble
+    @param   The Gfx buffer to fill (two words per slot)
+    @param   The relocation buffer to fill
+    @returns The number of relocations written
+==============================*/
+
+int dlist_assemble_split(linkedList* dl, uint32_t* gfx, uint32_t* relocs)
+{
+    int reloccount = 0;
+    int headerslots = 1;
+    bool insegment = FALSE;
+    uint32_t* header = gfx;
+    uint32_t* body;
+    listNode* dllnode;
+    
+    // Count the header's calls to find where the geometry starts
+    for (dllnode = dl->head; dllnode != NULL; dllnode = dllnode->next)
+    {
+        DLCBinary* bindl = (DLCBinary*)dllnode->data;
+        if (bindl->cmd == SPDisplayList)
+        {
+            headerslots++;
+            insegment = FALSE;
+        }
+        else if (bindl->cmd != SPEndDisplayList && !insegment)
+        {
+            headerslots++;
+            insegment = TRUE;
+        }
+    }
+    body = gfx + 2*headerslots;
+    
+    // Assemble the material calls into the header, and the geometry after it
+    insegment = FALSE;
+    for (dllnode = dl->head; dllnode != NULL; dllnode = dllnode->next)
+    {
+        DLCBinary* bindl = (DLCBinary*)dllnode->data;
+        if (bindl->cmd == SPEndDisplayList)
+            continue;
+        if (bindl->cmd == SPDisplayList)
+        {
+            reloccount += assemble_command(bindl, header, (header - gfx)/2, &relocs[reloccount]);
+            header += 2;
+            
+            // End the previous stretch of geometry
+            if (insegment)
+            {
+                body[0] = shiftl(F3DEX2_ENDDL, 24, 8);
+                body[1] = 0;
+                body += 2;
+                insegment = FALSE;
+            }
+            continue;
+        }
+        
+        // Start a new stretch of geometry
+        if (!insegment)
+        {
+            relocs[reloccount++] = (GFXRELOC_DLIST << 24) | (header - gfx)/2;
+            header[0] = shiftl(F3DEX2_DL, 24, 8);
+            header[1] = (body - gfx)/2;
+            header += 2;
+            insegment = TRUE;
+        }
+        reloccount += assemble_command(bindl, body, (body - gfx)/2, &relocs[reloccount]);
+        body += 2*commands_f3dex2[bindl->cmd].size;
+    }
+    if (insegment)
+    {
+        body[0] = shiftl(F3DEX2_ENDDL, 24, 8);
+        body[1] = 0;
+    }
+    header[0] = shiftl(F3DEX2_ENDDL, 24, 8);
+    header[1] = 0;
+    return reloccount;
+}
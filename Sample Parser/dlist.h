@@ -5,6 +5,12 @@
     #include "mesh.h"
     #include "gbi.h"
 
+    // Relocation types for assembled display lists
+    #define GFXRELOC_VERTEX   0
+    #define GFXRELOC_TEXTURE  1
+    #define GFXRELOC_MATERIAL 2
+    #define GFXRELOC_DLIST    3
+
     typedef struct {
         DListCName cmd;
         uint32_t size;
@@ -15,6 +21,11 @@
     extern uint32_t    swap_endian32(uint32_t val);
     extern float       swap_endianfloat(float val);
     extern linkedList* dlist_frommesh(s64Mesh* mesh, bool isbinary);
+    extern linkedList* dlist_frommesh_standalone(s64Mesh* mesh, bool isbinary);
+    extern linkedList* dlist_frommaterial(n64Material* mat);
+    extern int         dlist_assemble(linkedList* dl, uint32_t* gfx, uint32_t* relocs);
+    extern int         dlist_assemble_split(linkedList* dl, uint32_t* gfx, uint32_t* relocs);
+    extern int         dlist_slotcount(linkedList* dl, bool split);
     extern void        construct_dltext();
     
 #endif
\ No newline at end of file
@@ -0,0 +1,516 @@
+/***************************************************************
+                             lod.c
+
+Generates lower detail versions of each mesh, by repeatedly
+collapsing the edges that change the shape of the mesh the
+least. The cost of each collapse is measured with the quadric
+error metrics described by Garland and Heckbert in "Surface
+Simplification Using Quadric Error Metrics". Vertices are only
+ever moved onto one of their neighbours, so every vertex in a
+LOD is also a vertex of the original mesh. Vertices on open
+edges, UV/normal seams, and material borders are never moved,
+so the outline and the texturing of the mesh stay intact.
+***************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "main.h"
+#include "mesh.h"
+#include "lod.h"
+
+
+/*********************************
+              Macros
+*********************************/
+
+#define LOD_MINFACES     8    // Meshes with less faces than this don't get LODs
+#define LOD_MINREDUCTION 0.9  // Stop making LODs once a level would keep more than this fraction of the faces
+#define LOD_MINFLIPDOT   0.2  // Collapses that turn a face further than this (cosine of the angle) are rejected
+
+
+/*********************************
+             Structs
+*********************************/
+
+typedef struct {
+    s64Vert* vert;        // The vertex in the original mesh
+    double   quadric[10]; // The upper half of the symmetric 4x4 error quadric
+    bool     locked;      // Whether this vertex is never allowed to move
+    bool     touched;     // Whether this vertex was changed during this pass
+    int      mark;        // Scratch value used when looking at a vertex's neighbours
+} LODVert;
+
+typedef struct {
+    int          verts[MAXVERTS];
+    n64Material* material;
+    bool         alive;
+} LODFace;
+
+typedef struct {
+    int    from;
+    int    to;
+    double cost;
+} LODCollapse;
+
+
+/*==============================
+    same_vert
+    Checks if two vertices are identical
+    @param   The first vertex
+    @param   The second vertex
+    @returns Whether all the vertex attributes match
+==============================*/
+
+static bool same_vert(s64Vert* a, s64Vert* b)
+{
+    return a->pos.x == b->pos.x && a->pos.y == b->pos.y && a->pos.z == b->pos.z &&
+           a->normal.x == b->normal.x && a->normal.y == b->normal.y && a->normal.z == b->normal.z &&
+           a->color.x == b->color.x && a->color.y == b->color.y && a->color.z == b->color.z &&
+           a->UV.x == b->UV.x && a->UV.y == b->UV.y;
+}
+
+
+/*==============================
+    face_hasvert
+    Checks if a face uses a vertex
+    @param   The face to check
+    @param   The index of the vertex
+    @returns Whether the face uses the vertex
+==============================*/
+
+static inline bool face_hasvert(LODFace* face, int vert)
+{
+    return face->verts[0] == vert || face->verts[1] == vert || face->verts[2] == vert;
+}
+
+
+/*==============================
+    face_normal
+    Calculates the (unnormalized) normal of a triangle
+    @param   The first vertex position
+    @param   The second vertex position
+    @param   The third vertex position
+    @returns The normal, whose length is twice the area of the triangle
+==============================*/
+
+static Vector3D face_normal(Vector3D a, Vector3D b, Vector3D c)
+{
+    Vector3D n;
+    Vector3D ab = {b.x - a.x, b.y - a.y, b.z - a.z};
+    Vector3D ac = {c.x - a.x, c.y - a.y, c.z - a.z};
+    n.x = ab.y*ac.z - ab.z*ac.y;
+    n.y = ab.z*ac.x - ab.x*ac.z;
+    n.z = ab.x*ac.y - ab.y*ac.x;
+    return n;
+}
+
+
+/*==============================
+    quadric_error
+    Calculates the error of placing a vertex at a given position
+    @param   The combined quadric of the vertices being collapsed
+    @param   The position to test
+    @returns The sum of the squared distances to the original planes
+==============================*/
+
+static double quadric_error(double* q, Vector3D p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+         + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+         + q[7]*z*z + 2*q[8]*z
+         + q[9];
+}
+
+
+/*==============================
+    compare_collapses
+    qsort comparison function for sorting collapses by cost
+==============================*/
+
+static int compare_collapses(const void* a, const void* b)
+{
+    double ca = ((LODCollapse*)a)->cost;
+    double cb = ((LODCollapse*)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+
+/*==============================
+    lod_build
+    Converts a mesh into the arrays used for simplification,
+    welding identical vertices together, locking the ones that
+    can't move, and calculating the error quadrics
+    @param The mesh to convert
+    @param A pointer to store the vertex array in
+    @param A pointer to store the vertex count in
+    @param A pointer to store the face array in
+    @param A pointer to store the face count in
+==============================*/
+
+static void lod_build(s64Mesh* mesh, LODVert** outverts, int* outvcount, LODFace** outfaces, int* outfcount)
+{
+    int i, j, k;
+    int vcount = 0, fcount = 0;
+    n64Material** vertmats;
+    LODVert* verts = (LODVert*)calloc(mesh->faces.size*MAXVERTS, sizeof(LODVert));
+    LODFace* faces = (LODFace*)calloc(mesh->faces.size, sizeof(LODFace));
+    if (verts == NULL || faces == NULL)
+        terminate("Error: Unable to allocate memory for LOD generation\n");
+
+    // Copy the faces, welding together vertices which are identical (the faces in the S64 file don't share vertices)
+    for (listNode* facenode = mesh->faces.head; facenode != NULL; facenode = facenode->next)
+    {
+        s64Face* face = (s64Face*)facenode->data;
+        for (i=0; i<MAXVERTS; i++)
+        {
+            for (j=0; j<vcount; j++)
+                if (verts[j].vert == face->verts[i] || same_vert(verts[j].vert, face->verts[i]))
+                    break;
+            if (j == vcount)
+                verts[vcount++].vert = face->verts[i];
+            faces[fcount].verts[i] = j;
+        }
+        faces[fcount].material = face->material;
+        faces[fcount].alive = TRUE;
+        fcount++;
+    }
+
+    // Lock the vertices on edges which aren't shared by exactly two faces. Seams end up here too, since the vertices on each side differ
+    for (i=0; i<fcount; i++)
+    {
+        for (j=0; j<MAXVERTS; j++)
+        {
+            int a = faces[i].verts[j];
+            int b = faces[i].verts[(j+1)%MAXVERTS];
+            int sharedcount = 0;
+            for (k=0; k<fcount; k++)
+                if (face_hasvert(&faces[k], a) && face_hasvert(&faces[k], b))
+                    sharedcount++;
+            if (sharedcount != 2)
+            {
+                verts[a].locked = TRUE;
+                verts[b].locked = TRUE;
+            }
+        }
+    }
+
+    // Lock the vertices which are used by more than one material
+    vertmats = (n64Material**)calloc(vcount, sizeof(n64Material*));
+    if (vertmats == NULL)
+        terminate("Error: Unable to allocate memory for LOD generation\n");
+    for (i=0; i<fcount; i++)
+    {
+        for (j=0; j<MAXVERTS; j++)
+        {
+            int v = faces[i].verts[j];
+            if (vertmats[v] == NULL)
+                vertmats[v] = faces[i].material;
+            else if (vertmats[v] != faces[i].material)
+                verts[v].locked = TRUE;
+        }
+    }
+    free(vertmats);
+
+    // Accumulate the plane of each face into the quadrics of its vertices, weighted by the face's area
+    for (i=0; i<fcount; i++)
+    {
+        Vector3D p = verts[faces[i].verts[0]].vert->pos;
+        Vector3D n = face_normal(p, verts[faces[i].verts[1]].vert->pos, verts[faces[i].verts[2]].vert->pos);
+        double len = sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+        double a, b, c, d, area;
+        if (len == 0)
+            continue;
+        a = n.x/len;
+        b = n.y/len;
+        c = n.z/len;
+        d = -(a*p.x + b*p.y + c*p.z);
+        area = len/2;
+        for (j=0; j<MAXVERTS; j++)
+        {
+            double* q = verts[faces[i].verts[j]].quadric;
+            q[0] += area*a*a; q[1] += area*a*b; q[2] += area*a*c; q[3] += area*a*d;
+            q[4] += area*b*b; q[5] += area*b*c; q[6] += area*b*d;
+            q[7] += area*c*c; q[8] += area*c*d;
+            q[9] += area*d*d;
+        }
+    }
+
+    // Done
+    *outverts = verts;
+    *outvcount = vcount;
+    *outfaces = faces;
+    *outfcount = fcount;
+}
+
+
+/*==============================
+    lod_cancollapse
+    Checks whether moving one vertex onto another keeps the
+    mesh valid
+    @param   The vertex array
+    @param   The face array
+    @param   The number of faces
+    @param   The vertex to move
+    @param   The vertex to move it onto
+    @returns Whether the collapse is allowed
+==============================*/
+
+static bool lod_cancollapse(LODVert* verts, LODFace* faces, int fcount, int from, int to)
+{
+    int i, j;
+    int sharedfaces = 0, sharedneighbours = 0;
+
+    // Mark the neighbours of the vertex being moved
+    for (i=0; i<fcount; i++)
+        if (faces[i].alive && face_hasvert(&faces[i], from))
+            for (j=0; j<MAXVERTS; j++)
+                verts[faces[i].verts[j]].mark = 1;
+
+    // The only neighbours both vertices can share are the ones across the faces which will be removed, otherwise the mesh folds onto itself
+    for (i=0; i<fcount; i++)
+    {
+        if (!faces[i].alive || !face_hasvert(&faces[i], to))
+            continue;
+        if (face_hasvert(&faces[i], from))
+            sharedfaces++;
+        for (j=0; j<MAXVERTS; j++)
+        {
+            LODVert* v = &verts[faces[i].verts[j]];
+            if (v->mark == 1 && faces[i].verts[j] != from && faces[i].verts[j] != to)
+            {
+                v->mark = 2;
+                sharedneighbours++;
+            }
+        }
+    }
+    for (i=0; i<fcount; i++)
+        if (faces[i].alive && (face_hasvert(&faces[i], from) || face_hasvert(&faces[i], to)))
+            for (j=0; j<MAXVERTS; j++)
+                verts[faces[i].verts[j]].mark = 0;
+    if (sharedfaces == 0 || sharedneighbours != sharedfaces)
+        return FALSE;
+
+    // Make sure none of the remaining faces get flipped, squashed, or end up on top of another face
+    for (i=0; i<fcount; i++)
+    {
+        int k;
+        Vector3D pos[MAXVERTS];
+        Vector3D oldn, newn;
+        double oldlen, newlen;
+        if (!faces[i].alive || !face_hasvert(&faces[i], from) || face_hasvert(&faces[i], to))
+            continue;
+        for (k=0; k<fcount; k++)
+        {
+            if (!faces[k].alive || !face_hasvert(&faces[k], to))
+                continue;
+            for (j=0; j<MAXVERTS; j++)
+                if (faces[i].verts[j] != from && !face_hasvert(&faces[k], faces[i].verts[j]))
+                    break;
+            if (j == MAXVERTS)
+                return FALSE;
+        }
+        for (j=0; j<MAXVERTS; j++)
+            pos[j] = verts[faces[i].verts[j]].vert->pos;
+        oldn = face_normal(pos[0], pos[1], pos[2]);
+        for (j=0; j<MAXVERTS; j++)
+            if (faces[i].verts[j] == from)
+                pos[j] = verts[to].vert->pos;
+        newn = face_normal(pos[0], pos[1], pos[2]);
+        oldlen = sqrt(oldn.x*oldn.x + oldn.y*oldn.y + oldn.z*oldn.z);
+        newlen = sqrt(newn.x*newn.x + newn.y*newn.y + newn.z*newn.z);
+        if (newlen == 0 || oldlen == 0)
+            return FALSE;
+        if ((oldn.x*newn.x + oldn.y*newn.y + oldn.z*newn.z)/(oldlen*newlen) < LOD_MINFLIPDOT)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+/*==============================
+    lod_simplify
+    Collapses edges until the mesh has the target number of
+    faces, or until no more edges can be collapsed
+    @param   The vertex array
+    @param   The number of vertices
+    @param   The face array
+    @param   The number of faces
+    @param   The number of faces which are still alive
+    @param   The number of faces to reduce the mesh to
+    @returns The number of faces which are still alive
+==============================*/
+
+static int lod_simplify(LODVert* verts, int vcount, LODFace* faces, int fcount, int alive, int target)
+{
+    int i, j;
+    LODCollapse* collapses = (LODCollapse*)malloc(sizeof(LODCollapse)*fcount*MAXVERTS*2);
+    if (collapses == NULL)
+        terminate("Error: Unable to allocate memory for LOD generation\n");
+
+    // Each pass tries the cheapest collapses first, and skips the ones whose cost was changed by an earlier collapse in the same pass
+    while (alive > target)
+    {
+        int collapsecount = 0;
+        int collapsed = 0;
+
+        // Find every possible collapse and its cost
+        for (i=0; i<fcount; i++)
+        {
+            if (!faces[i].alive)
+                continue;
+            for (j=0; j<MAXVERTS*2; j++)
+            {
+                double q[10];
+                int k;
+                int from = faces[i].verts[j%MAXVERTS];
+                int to = faces[i].verts[(j/MAXVERTS + 1 + j)%MAXVERTS];
+                if (verts[from].locked)
+                    continue;
+                for (k=0; k<10; k++)
+                    q[k] = verts[from].quadric[k] + verts[to].quadric[k];
+                collapses[collapsecount].from = from;
+                collapses[collapsecount].to = to;
+                collapses[collapsecount].cost = quadric_error(q, verts[to].vert->pos);
+                collapsecount++;
+            }
+        }
+        qsort(collapses, collapsecount, sizeof(LODCollapse), compare_collapses);
+        for (i=0; i<vcount; i++)
+            verts[i].touched = FALSE;
+
+        // Perform the collapses
+        for (i=0; i<collapsecount && alive > target; i++)
+        {
+            int from = collapses[i].from;
+            int to = collapses[i].to;
+            if (verts[from].touched || verts[to].touched || !lod_cancollapse(verts, faces, fcount, from, to))
+                continue;
+
+            // Remove the faces on the collapsed edge, and move the rest onto the other vertex
+            for (j=0; j<fcount; j++)
+            {
+                int k;
+                if (!faces[j].alive || !face_hasvert(&faces[j], from))
+                    continue;
+                for (k=0; k<MAXVERTS; k++)
+                    verts[faces[j].verts[k]].touched = TRUE;
+                if (face_hasvert(&faces[j], to))
+                {
+                    faces[j].alive = FALSE;
+                    alive--;
+                    continue;
+                }
+                for (k=0; k<MAXVERTS; k++)
+                    if (faces[j].verts[k] == from)
+                        faces[j].verts[k] = to;
+            }
+            for (j=0; j<10; j++)
+                verts[to].quadric[j] += verts[from].quadric[j];
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+    }
+    free(collapses);
+    return alive;
+}
+
+
+/*==============================
+    lod_createmesh
+    Creates a mesh out of the faces which are still alive
+    @param   The mesh which is being simplified
+    @param   The vertex array
+    @param   The face array
+    @param   The number of faces
+    @returns The newly created LOD mesh
+==============================*/
+
+static s64Mesh* lod_createmesh(s64Mesh* mesh, LODVert* verts, LODFace* faces, int fcount)
+{
+    int i, j;
+    s64Mesh* lod = (s64Mesh*)calloc(1, sizeof(s64Mesh));
+    if (lod == NULL)
+        terminate("Error: Unable to allocate memory for LOD mesh\n");
+
+    // The LOD is drawn in place of the original, so it shares its properties
+    lod->name = mesh->name;
+    lod->parent = mesh->parent;
+    lod->root = mesh->root;
+    lod->props = mesh->props;
+
+    // Copy the faces that are still alive, keeping them in the same order so the material changes match the original mesh
+    for (i=0; i<fcount; i++)
+    {
+        s64Face* face;
+        if (!faces[i].alive)
+            continue;
+        face = add_face(lod);
+        face->material = faces[i].material;
+        for (j=0; j<MAXVERTS; j++)
+        {
+            face->verts[j] = verts[faces[i].verts[j]].vert;
+            if (!list_hasvalue(&lod->verts, face->verts[j]))
+                list_append(&lod->verts, face->verts[j]);
+        }
+    }
+
+    // Keep the materials which are still used
+    for (listNode* matnode = mesh->materials.head; matnode != NULL; matnode = matnode->next)
+    {
+        for (listNode* facenode = lod->faces.head; facenode != NULL; facenode = facenode->next)
+        {
+            if (((s64Face*)facenode->data)->material == matnode->data)
+            {
+                list_append(&lod->materials, matnode->data);
+                break;
+            }
+        }
+    }
+    return lod;
+}
+
+
+/*==============================
+    generate_lods
+    Generates the levels of detail for every mesh in the model,
+    each one with roughly half the faces of the previous one
+==============================*/
+
+void generate_lods()
+{
+    int generated = 0;
+    if (!global_quiet) printf("    Generating LODs\n");
+
+    for (listNode* meshnode = list_meshes.head; meshnode != NULL; meshnode = meshnode->next)
+    {
+        unsigned int i;
+        int vcount, fcount, alive;
+        LODVert* verts;
+        LODFace* faces;
+        s64Mesh* mesh = (s64Mesh*)meshnode->data;
+        if (mesh->faces.size < LOD_MINFACES)
+            continue;
+
+        // Simplify the mesh one level at a time, stopping early if the mesh can't be simplified much further
+        lod_build(mesh, &verts, &vcount, &faces, &fcount);
+        alive = fcount;
+        for (i=0; i<global_lodcount; i++)
+        {
+            int previous = alive;
+            alive = lod_simplify(verts, vcount, faces, fcount, alive, alive/2);
+            if (alive > previous*LOD_MINREDUCTION)
+                break;
+            list_append(&mesh->lods, lod_createmesh(mesh, verts, faces, fcount));
+            generated++;
+            if (!global_quiet) printf("        Mesh '%s' LOD %u has %d faces (from %d)\n", mesh->name, i+1, alive, fcount);
+        }
+        free(verts);
+        free(faces);
+    }
+
+    if (!global_quiet) printf("        %d LODs generated\n", generated);
+}
@@ -0,0 +1,9 @@
+#ifndef _SAUSN64_LOD_H
+#define _SAUSN64_LOD_H
+
+    // The most levels of detail a mesh can have (not counting the full detail mesh)
+    #define MAXLODS 8
+
+    extern void generate_lods();
+
+#endif
\ No newline at end of file
@@ -12,6 +12,9 @@ Program entrypoint
 #include "parser.h"
 #include "optimizer.h"
 #include "output.h"
+#include "lod.h"
+#include "mesh.h"
+#include "animation.h"
 
 
 /*********************************
@@ -29,6 +32,7 @@ static void parse_programargs(int argc, char* argv[]);
 linkedList list_meshes = EMPTY_LINKEDLIST;
 linkedList list_animations = EMPTY_LINKEDLIST;
 linkedList list_materials = EMPTY_LINKEDLIST;
+linkedList list_bakeanims = EMPTY_LINKEDLIST;
 
 // Program settings
 bool global_quiet = FALSE;
@@ -37,9 +41,14 @@ bool global_binaryout = TRUE;
 bool global_initialload = TRUE;
 bool global_no2tri = FALSE;
 bool global_opengl = FALSE;
+bool global_quantizeanims = FALSE;
+bool global_packverts = FALSE;
+bool global_matdlists = FALSE;
+bool global_gfxdlists = FALSE;
 char* global_outputname = "outdlist";
 char* global_modelname = "MyModel";
 unsigned int global_cachesize = 32;
+unsigned int global_lodcount = 0;
 
 // Input file pointers
 static FILE *fp_m = NULL;
@@ -71,6 +80,12 @@ int main(int argc, char* argv[])
             "\t-g \t\t(optional) Export an OpenGL compatible model instead\n"
             "\t-c <Int>\t(optional) Vertex cache size (default '32') (libultra only)\n"
             "\t-i \t\t(optional) Omit initial display list setup (libultra only)\n"
+            "\t-k \t\t(optional) Quantize the animation keyframes (binary only)\n"
+            "\t-a \t\t(optional) Pre-assemble the display lists for F3DEX2 (libultra binary only)\n"
+            "\t-b <Name>\t(optional) Bake an animation into one keyframe per tick (can be repeated)\n"
+            "\t-l <Int>\t(optional) Number of LODs to generate per mesh (needs '-a')\n"
+            "\t-p \t\t(optional) Pack the vertices into 16 bytes (libdragon binary only)\n"
+            "\t-m \t\t(optional) Put each material's setup in its own display list (needs '-a')\n"
             "\t-n <Name>\t(optional) Model name (default 'MyModel')\n"
             "\t-o <File>\t(optional) Output filename (default 'outdlist')\n"
             "\t-q \t\t(optional) Quiet mode\n"
@@ -79,6 +94,28 @@ int main(int argc, char* argv[])
      
     // Parse the command line arguments
     parse_programargs(argc, argv);
+    if (global_gfxdlists && (global_opengl || !global_binaryout))
+    {
+        printf("Warning: Pre-assembled display lists are only for libultra binary models, ignoring '-a'\n");
+        global_gfxdlists = FALSE;
+    }
+    if (global_gfxdlists && global_no2tri)
+        terminate("Error: Pre-assembled display lists only work with F3DEX2, which doesn't need '-2'\n");
+    if (global_lodcount > 0 && !global_gfxdlists)
+    {
+        printf("Warning: LODs are only generated for pre-assembled display lists, ignoring '-l'\n");
+        global_lodcount = 0;
+    }
+    if (global_packverts && (!global_opengl || !global_binaryout))
+    {
+        printf("Warning: Packed vertices are only for libdragon binary models, ignoring '-p'\n");
+        global_packverts = FALSE;
+    }
+    if (global_matdlists && !global_gfxdlists)
+    {
+        printf("Warning: Material display lists are only for pre-assembled display lists, ignoring '-m'\n");
+        global_matdlists = FALSE;
+    }
     
     // Parse the materials file if it's given
     list_append(&list_materials, &material_none);
@@ -88,6 +125,10 @@ int main(int argc, char* argv[])
     // Parse the model file
     parse_sausage(fp_m);
     
+    // Resample the animations that were requested to be baked
+    if (list_bakeanims.size > 0)
+        bake_animations();
+    
     // Optimize the model
     optimize_mdl();
     
@@ -179,6 +220,35 @@ static void parse_programargs(int argc, char* argv[])
                 case '2':
                     global_no2tri = !global_no2tri;
                     break;
+                case 'k':
+                    global_quantizeanims = !global_quantizeanims;
+                    break;
+                case 'a':
+                    global_gfxdlists = !global_gfxdlists;
+                    break;
+                case 'b':
+                    i++;
+                    if (i == argc)
+                        terminate("Error: Incorrect number of arguments provided for '-b'\n");
+                    list_append(&list_bakeanims, argv[i]);
+                    break;
+                case 'p':
+                    global_packverts = !global_packverts;
+                    break;
+                case 'm':
+                    global_matdlists = !global_matdlists;
+                    break;
+                case 'l':
+                    i++;
+                    if (i == argc)
+                        terminate("Error: Incorrect number of arguments provided for '-l'\n");
+                    global_lodcount = atoi(argv[i]);
+                    if (global_lodcount > MAXLODS)
+                    {
+                        sprintf(errbuf, "Error: Can't generate more than %d LODs\n", MAXLODS);
+                        terminate(errbuf);
+                    }
+                    break;
                 default:
                     sprintf(errbuf, "Error: Unknown argument '%s'\n", argv[i]);
                     terminate(errbuf);
@@ -10,7 +10,7 @@
 
     #define PROGRAM_NAME    "Arabiki64"
     #define PROGRAM_VERSION "1.4"
-    #define BINARY_VERSION  0
+    #define BINARY_VERSION  1
     
     
     /*********************************
@@ -20,6 +20,7 @@
     extern linkedList list_meshes;
     extern linkedList list_animations;
     extern linkedList list_materials;
+    extern linkedList list_bakeanims;
     
     extern bool global_quiet;
     extern bool global_fixroot;
@@ -27,9 +28,14 @@
     extern bool global_initialload;
     extern bool global_no2tri;
     extern bool global_opengl;
+    extern bool global_quantizeanims;
+    extern bool global_packverts;
+    extern bool global_matdlists;
+    extern bool global_gfxdlists;
     extern char* global_outputname;
     extern char* global_modelname;
     extern unsigned int global_cachesize;
+    extern unsigned int global_lodcount;
     
     
     /*********************************
@@ -538,4 +538,33 @@ int get_validmatindex(linkedList* materials, char* name)
         }
     }
     return -1;
+}
+
+/*==============================
+    get_drawnmatindex
+    Like get_validmatindex, but counts materials with the
+    DONTLOAD flag as well, since those still need their
+    setup to be drawn.
+    @param   The list of materials to iterate
+    @param   The name of the material to find
+    @returns The drawn material index, or -1
+==============================*/
+
+int get_drawnmatindex(linkedList* materials, char* name)
+{
+    int index = 0;
+    listNode* matnode;
+    
+    // Iterate through the mesh list
+    for (matnode = materials->head; matnode != NULL; matnode = matnode->next)
+    {
+        n64Material* mat = (n64Material*)matnode->data;
+        if (mat->type != TYPE_OMIT)
+        {
+            if (!strcmp(mat->name, name))
+                return index;
+            index++;
+        }
+    }
+    return -1;
 }
\ No newline at end of file
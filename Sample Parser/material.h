@@ -125,5 +125,6 @@
     extern bool        isvalidmat(n64Material* mat);
     extern int         get_validtexindex(linkedList* materials, char* name);
     extern int         get_validmatindex(linkedList* materials, char* name);
+    extern int         get_drawnmatindex(linkedList* materials, char* name);
     
 #endif
\ No newline at end of file
@@ -20,6 +20,7 @@
         linkedList materials;
         linkedList props;
         linkedList vertcache;
+        linkedList lods;
     } s64Mesh;
     
     // Vertex struct
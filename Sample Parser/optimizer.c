@@ -17,6 +17,7 @@ generates vertex caches. The optimizations are as follows:
 #include <math.h>
 #include "main.h"
 #include "mesh.h"
+#include "lod.h"
 
 
 /*********************************
@@ -1116,6 +1117,59 @@ static void combine_caches(s64Mesh* mesh)
 }
 
 
+/*==============================
+    build_vertcaches
+    Splits a mesh into blocks of vertices that fit in the
+    vertex cache
+    @param The mesh to build the vertex caches of
+==============================*/
+
+static void build_vertcaches(s64Mesh* mesh)
+{
+    // See if the model fits in the vertex cache
+    if (mesh->verts.size > global_cachesize)
+    {
+        int index = 0;
+        printf("    Mesh '%s' too large for vertex cache, splitting by material.\n", mesh->name);
+    
+        // Oh dear, this model doesn't fit... Let's split the mesh by material and see if that helps
+        split_verts_by_material(mesh);
+        
+        // Try to combine any cache blocks that could fit together after having been split by material
+        combine_caches(mesh);
+        
+        // If that didn't help, then split the vertex block further and duplicate verts with the help of Forsyth
+        for (listNode* vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
+        {
+            vertCache* vcache = (vertCache*)vcachenode->data;
+            if (vcache->verts.size > global_cachesize)
+            {
+                linkedList* list;
+                printf("        Cache needs to be split further, applying Forsyth + duplicating verts.\n");
+                
+                // Apply Forsyth on this cache node and retrieve a new list of vertex caches to replace this one
+                list = forsyth(vcache);
+                free(list_swapindex_withlist(&mesh->vertcache, index, list));
+                vcachenode = list->tail;
+                index += list->size;
+                continue;
+            }
+            index++;
+        }
+    }
+    else
+    {
+        // Model fits fine, lets just shove every vert into a cache.
+        vertCache* vcache = (vertCache*) calloc(1, sizeof(vertCache));
+        if (vcache == NULL)
+            terminate("Error: Unable to allocate memory for vertex cache\n");
+        vcache->verts = mesh->verts;
+        vcache->faces = mesh->faces;
+        list_append(&mesh->vertcache, vcache);
+    }
+}
+
+
 /*==============================
     optimize_mdl
     Performs all sorts of optimizations on the model
@@ -1135,52 +1189,17 @@ void optimize_mdl()
     // If there's two duplicated vertices with same normals and vcolors, but they're both used for primitive color materials, we can safely merge them (since UV's are useless)
     optimize_duplicatedverts();
     
+    // Generate the lower detail versions of each mesh, if they were requested
+    if (global_lodcount > 0)
+        generate_lods();
+    
     // Now that our model is all nice and optimized, go through each model
     for (listNode* meshnode = list_meshes.head; meshnode != NULL; meshnode = meshnode->next)
     {
         s64Mesh* mesh = (s64Mesh*)meshnode->data;
-        
-        // See if the model fits in the vertex cache
-        if (mesh->verts.size > global_cachesize)
-        {
-            int index = 0;
-            printf("    Mesh '%s' too large for vertex cache, splitting by material.\n", mesh->name);
-        
-            // Oh dear, this model doesn't fit... Let's split the mesh by material and see if that helps
-            split_verts_by_material(mesh);
-            
-            // Try to combine any cache blocks that could fit together after having been split by material
-            combine_caches(mesh);
-            
-            // If that didn't help, then split the vertex block further and duplicate verts with the help of Forsyth
-            for (listNode* vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
-            {
-                vertCache* vcache = (vertCache*)vcachenode->data;
-                if (vcache->verts.size > global_cachesize)
-                {
-                    linkedList* list;
-                    printf("        Cache needs to be split further, applying Forsyth + duplicating verts.\n");
-                    
-                    // Apply Forsyth on this cache node and retrieve a new list of vertex caches to replace this one
-                    list = forsyth(vcache);
-                    free(list_swapindex_withlist(&mesh->vertcache, index, list));
-                    vcachenode = list->tail;
-                    index += list->size;
-                    continue;
-                }
-                index++;
-            }
-        }
-        else
-        {
-            // Model fits fine, lets just shove every vert into a cache.
-            vertCache* vcache = (vertCache*) calloc(1, sizeof(vertCache));
-            if (vcache == NULL)
-                terminate("Error: Unable to allocate memory for vertex cache\n");
-            vcache->verts = mesh->verts;
-            vcache->faces = mesh->faces;
-            list_append(&mesh->vertcache, vcache);
-        }
+        build_vertcaches(mesh);
+        for (listNode* lodnode = mesh->lods.head; lodnode != NULL; lodnode = lodnode->next)
+            build_vertcaches((s64Mesh*)lodnode->data);
     }
     
     // Finished
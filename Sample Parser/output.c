@@ -14,9 +14,27 @@ Outputs the parsed data to a file
 #include "animation.h"
 #include "dlist.h"
 #include "opengl.h"
+#include "lod.h"
 
 #define STRBUF_SIZE 512
 
+#define BINFLAG_QUANTIZEDANIMS 0x00000001
+#define BINFLAG_GFXDLISTS      0x00000002
+#define BINFLAG_BOUNDS         0x00000004
+#define BINFLAG_LODS           0x00000008
+#define BINFLAG_PACKEDVERTS    0x00000010
+#define BINFLAG_MATDLISTS      0x00000020
+#define BINFLAG_BAKEDANIMS     0x00000040
+
+// Set in a baked animation's keyframe count, when the binary has baked animations
+#define BINARY_ANIMBAKED 0x80000000
+
+#define QUAT_SMALLEST3_RANGE 0.70710678118f
+
+// Packed vertex UVs are stored as fixed point with this many units per texture repeat
+// Must match S64_PACKEDUVSCALE in the library
+#define PACKEDVERT_UVSCALE 1024.0f
+
 #define member_size(type, member) (sizeof( ((type *)0)->member ))
 
 typedef struct {
@@ -27,6 +45,8 @@ typedef struct {
     uint16_t offset_meshes;
     uint32_t offset_materials;
     uint32_t offset_anims;
+    uint32_t flags;
+    float    posscale;
 } BinFile;
 
 typedef struct {
@@ -45,6 +65,9 @@ typedef struct {
     int16_t parent;
     uint8_t is_billboard;
     char*   name;
+    float   bounds[4];
+    uint8_t lodcount;
+    uint32_t lodstarts[MAXLODS];
 } BinFile_MeshData;
 
 typedef struct {
@@ -61,6 +84,13 @@ typedef struct {
     float color[3];
 } BinFile_DragonVert;
 
+typedef struct {
+    int16_t pos[3];
+    int16_t tex[2];
+    int8_t  normal[3];
+    uint8_t color[3];
+} BinFile_DragonPackedVert;
+
 typedef struct {
     uint16_t vertcount;
     uint16_t vertoffset;
@@ -112,6 +142,7 @@ typedef struct {
     uint32_t kfcount;
     uint16_t* kfindices;
     char* name;
+    float bounds[4];
 } BinFile_AnimData;
 
 typedef struct {
@@ -120,6 +151,12 @@ typedef struct {
     float scale[3];
 } BinFile_KeyFrame;
 
+typedef struct {
+    int16_t  pos[3];
+    uint16_t rot[3];
+    int16_t  scale[3];
+} BinFile_QKeyFrame;
+
 
 /*==============================
     align_32bits
@@ -134,6 +171,42 @@ static int align_32bits(int num)
 }
 
 
+/*==============================
+    align_64bits
+    Aligns a number to 64 bits
+    @param  The number to align
+    @return The aligned value
+==============================*/
+
+static int align_64bits(int num)
+{
+    return ((num + (8 - 1))/8)*8;
+}
+
+
+/*==============================
+    pack_clamped
+    Rounds a value and clamps it to the given range
+    @param  The value to pack
+    @param  The smallest allowed value
+    @param  The largest allowed value
+    @param  A pointer to a counter to increment if the
+            value had to be clamped
+    @return The rounded and clamped value
+==============================*/
+
+static int pack_clamped(double value, int min, int max, int* clamped)
+{
+    int result = (int)round(value);
+    if (result < min || result > max)
+    {
+        (*clamped)++;
+        return (result < min) ? min : max;
+    }
+    return result;
+}
+
+
 /*==============================
     writepadding
     Write zero padding to a file
@@ -150,6 +223,258 @@ static void writepadding(FILE* fp, int padvalue)
 }
 
 
+/*==============================
+    writepadding_to
+    Write zero padding to a file until it
+    reaches the given offset
+    @param The file to PAD
+    @param The offset to pad up to
+==============================*/
+
+static void writepadding_to(FILE* fp, int offset)
+{
+    const uint8_t padbyte = 0;
+    while (ftell(fp) < offset)
+        fwrite(&padbyte, 1, 1, fp);
+}
+
+
+/*==============================
+    isbinarymat
+    Checks if a material should be stored in the binary.
+    Libultra material display lists also need the
+    materials with the DONTLOAD flag, since the meshes
+    still call them to set up the render state
+    @param  The material to check
+    @return Whether the material goes in the binary
+==============================*/
+
+static bool isbinarymat(n64Material* mat)
+{
+    if (global_opengl)
+        return isvalidmat(mat);
+    return mat->type != TYPE_OMIT;
+}
+
+
+/*==============================
+    quantize_keyframe
+    Quantizes a keyframe's transform. Translations are stored
+    as 16-bit integers scaled by the model's position scale,
+    rotations use the smallest three components of the
+    quaternion (15 bits each, plus 2 bits for the index of the
+    largest one), and scales are stored in 8.8 fixed point
+    @param The keyframe to quantize
+    @param The position scale of the model
+    @param The quantized keyframe to fill
+==============================*/
+
+static void quantize_keyframe(BinFile_KeyFrame* kf, float posscale, BinFile_QKeyFrame* qkf)
+{
+    int i, j, largest = 0;
+    float rot[4], norm;
+    uint64_t packed;
+
+    // Translation and scale
+    for (i=0; i<3; i++)
+    {
+        qkf->pos[i] = (int16_t)round(kf->pos[i]/posscale);
+        qkf->scale[i] = (int16_t)round(kf->scale[i]*256.0f);
+    }
+
+    // Normalize the quaternion, as the reconstruction of the largest component assumes unit length
+    norm = sqrtf(kf->rot[0]*kf->rot[0] + kf->rot[1]*kf->rot[1] + kf->rot[2]*kf->rot[2] + kf->rot[3]*kf->rot[3]);
+    if (norm == 0)
+        norm = 1;
+    for (i=0; i<4; i++)
+        rot[i] = kf->rot[i]/norm;
+
+    // Find the largest quaternion component, and flip the quaternion so that it's positive
+    for (i=1; i<4; i++)
+        if (fabs(rot[i]) > fabs(rot[largest]))
+            largest = i;
+    if (rot[largest] < 0)
+        for (i=0; i<4; i++)
+            rot[i] = -rot[i];
+
+    // Pack the remaining three components
+    packed = (uint64_t)largest << 45;
+    j = 2;
+    for (i=0; i<4; i++)
+    {
+        float val;
+        if (i == largest)
+            continue;
+        val = (rot[i]/QUAT_SMALLEST3_RANGE + 1.0f)*0.5f;
+        if (val < 0.0f) val = 0.0f;
+        if (val > 1.0f) val = 1.0f;
+        packed |= ((uint64_t)round(val*32767.0f)) << (15*j);
+        j--;
+    }
+    qkf->rot[0] = (packed >> 32) & 0xFFFF;
+    qkf->rot[1] = (packed >> 16) & 0xFFFF;
+    qkf->rot[2] = packed & 0xFFFF;
+}
+
+
+/*==============================
+    dequantize_keyframe
+    Converts a quantized keyframe back to floats.
+    Used to measure the quantization error.
+    @param The quantized keyframe
+    @param The position scale of the model
+    @param The keyframe to fill
+==============================*/
+
+static void dequantize_keyframe(BinFile_QKeyFrame* qkf, float posscale, BinFile_KeyFrame* kf)
+{
+    int i, j = 2;
+    float sum = 0;
+    uint64_t packed = ((uint64_t)qkf->rot[0] << 32) | ((uint64_t)qkf->rot[1] << 16) | qkf->rot[2];
+    int largest = (packed >> 45) & 0x03;
+    for (i=0; i<3; i++)
+    {
+        kf->pos[i] = qkf->pos[i]*posscale;
+        kf->scale[i] = qkf->scale[i]/256.0f;
+    }
+    for (i=0; i<4; i++)
+    {
+        if (i == largest)
+            continue;
+        kf->rot[i] = ((((packed >> (15*j)) & 0x7FFF)/32767.0f)*2.0f - 1.0f)*QUAT_SMALLEST3_RANGE;
+        sum += kf->rot[i]*kf->rot[i];
+        j--;
+    }
+    kf->rot[largest] = (sum < 1.0f) ? sqrtf(1.0f - sum) : 0.0f;
+}
+
+
+/*==============================
+    calc_meshbounds
+    Calculates a bounding sphere around a mesh's vertices
+    @param The mesh to calculate the bounds of
+    @param The array to store the center and radius in
+==============================*/
+
+static void calc_meshbounds(s64Mesh* mesh, float bounds[4])
+{
+    listNode* vertnode;
+    Vector3D min = {0, 0, 0}, max = {0, 0, 0};
+    float radius = 0;
+
+    // Find the center of the mesh's bounding box
+    for (vertnode = mesh->verts.head; vertnode != NULL; vertnode = vertnode->next)
+    {
+        s64Vert* vert = (s64Vert*)vertnode->data;
+        if (vertnode == mesh->verts.head)
+        {
+            min = vert->pos;
+            max = vert->pos;
+            continue;
+        }
+        min.x = fminf(min.x, vert->pos.x);
+        min.y = fminf(min.y, vert->pos.y);
+        min.z = fminf(min.z, vert->pos.z);
+        max.x = fmaxf(max.x, vert->pos.x);
+        max.y = fmaxf(max.y, vert->pos.y);
+        max.z = fmaxf(max.z, vert->pos.z);
+    }
+    bounds[0] = (min.x + max.x)/2;
+    bounds[1] = (min.y + max.y)/2;
+    bounds[2] = (min.z + max.z)/2;
+
+    // Find the vertex furthest from the center
+    for (vertnode = mesh->verts.head; vertnode != NULL; vertnode = vertnode->next)
+    {
+        s64Vert* vert = (s64Vert*)vertnode->data;
+        float dx = vert->pos.x - bounds[0];
+        float dy = vert->pos.y - bounds[1];
+        float dz = vert->pos.z - bounds[2];
+        radius = fmaxf(radius, sqrtf(dx*dx + dy*dy + dz*dz));
+    }
+
+    // Libultra vertices get rounded to integers, so account for that
+    if (!global_opengl && mesh->verts.size > 0)
+        radius += 0.8660254f;
+    bounds[3] = radius;
+}
+
+
+/*==============================
+    calc_animbounds
+    Calculates a bounding sphere that contains the whole model
+    throughout an animation. Each mesh is kept inside a sphere
+    around its pivot, which no rotation can move it out of
+    @param The animation to calculate the bounds of
+    @param The array to store the center and radius in
+==============================*/
+
+static void calc_animbounds(s64Anim* anim, float bounds[4])
+{
+    int i, pass;
+    listNode* curnode;
+    Vector3D min = {0, 0, 0}, max = {0, 0, 0};
+    float radius = 0;
+    bool first = TRUE;
+    float* reaches = (float*)calloc(list_meshes.size, sizeof(float));
+    if (reaches == NULL)
+        terminate("Error: Unable to malloc for animation bounds\n");
+
+    // Get how far each mesh reaches from its pivot
+    for (curnode = list_meshes.head, i = 0; curnode != NULL; curnode = curnode->next, i++)
+    {
+        float meshbounds[4];
+        calc_meshbounds((s64Mesh*)curnode->data, meshbounds);
+        reaches[i] = sqrtf(meshbounds[0]*meshbounds[0] + meshbounds[1]*meshbounds[1] + meshbounds[2]*meshbounds[2]) + meshbounds[3];
+    }
+
+    // First pass finds the center of the bounding box, the second the radius
+    for (pass=0; pass<2; pass++)
+    {
+        listNode* kfnode;
+        for (kfnode = anim->keyframes.head; kfnode != NULL; kfnode = kfnode->next)
+        {
+            listNode* fdnode;
+            s64Keyframe* keyf = (s64Keyframe*)kfnode->data;
+            for (fdnode = keyf->framedata.head; fdnode != NULL; fdnode = fdnode->next)
+            {
+                s64Transform* fdata = (s64Transform*)fdnode->data;
+                Vector3D pos = fdata->translation;
+                float scale = fmaxf(fabsf(fdata->scale.x), fmaxf(fabsf(fdata->scale.y), fabsf(fdata->scale.z)));
+                float reach = scale*reaches[list_index_from_data(&list_meshes, fdata->mesh)];
+                if (pass == 0)
+                {
+                    if (first)
+                    {
+                        min.x = pos.x - reach; min.y = pos.y - reach; min.z = pos.z - reach;
+                        max.x = pos.x + reach; max.y = pos.y + reach; max.z = pos.z + reach;
+                        first = FALSE;
+                    }
+                    min.x = fminf(min.x, pos.x - reach);
+                    min.y = fminf(min.y, pos.y - reach);
+                    min.z = fminf(min.z, pos.z - reach);
+                    max.x = fmaxf(max.x, pos.x + reach);
+                    max.y = fmaxf(max.y, pos.y + reach);
+                    max.z = fmaxf(max.z, pos.z + reach);
+                }
+                else
+                {
+                    float dx = pos.x - bounds[0];
+                    float dy = pos.y - bounds[1];
+                    float dz = pos.z - bounds[2];
+                    radius = fmaxf(radius, sqrtf(dx*dx + dy*dy + dz*dz) + reach);
+                }
+            }
+        }
+        bounds[0] = (min.x + max.x)/2;
+        bounds[1] = (min.y + max.y)/2;
+        bounds[2] = (min.z + max.z)/2;
+    }
+    bounds[3] = radius;
+    free(reaches);
+}
+
+
 /*==============================
     write_header
     Writes the header data to a text file.
@@ -302,7 +627,31 @@ void write_output_text()
                 s64Keyframe* keyf = (s64Keyframe*)keyfnode->data;
                 fprintf(fp, "    {%d, anim_%s_%s_framedata%d},\n", keyf->keyframe, global_modelname, anim->name, keyf->keyframe);
             }
-            fprintf(fp, "};");
+            fprintf(fp, "};\n");
+            
+            // And finally, print the tick to keyframe lookup table. Baked animations don't need one, as every tick is a keyframe
+            if (anim->baked)
+                continue;
+            fprintf(fp, "static u16 anim_%s_%s_kflookup[] = {", global_modelname, anim->name);
+            if (anim->keyframes.size > 0)
+            {
+                unsigned int tick = 0, kfindex = 0;
+                for (keyfnode = anim->keyframes.head; keyfnode != NULL; keyfnode = keyfnode->next)
+                {
+                    s64Keyframe* keyf = (s64Keyframe*)keyfnode->data;
+                    unsigned int end = keyf->keyframe+1;
+                    if (keyfnode->next != NULL)
+                        end = ((s64Keyframe*)keyfnode->next->data)->keyframe;
+                    for (; tick < end; tick++)
+                    {
+                        if (tick%16 == 0)
+                            fputs("\n   ", fp);
+                        fprintf(fp, " %d,", kfindex);
+                    }
+                    kfindex++;
+                }
+            }
+            fprintf(fp, "\n};");
         }
     }
     
@@ -323,6 +672,7 @@ void write_output_text()
         for (curnode = list_meshes.head; curnode != NULL; curnode = curnode->next)
         {
             bool billboard = FALSE;
+            float bounds[4];
             s64Mesh* mesh = (s64Mesh*)curnode->data;
             
             // Write the model data line
@@ -352,7 +702,9 @@ void write_output_text()
             else
                 fprintf(fp, "-1");
 
-            fprintf(fp, "},\n");
+            // Write the bounding sphere
+            calc_meshbounds(mesh, bounds);
+            fprintf(fp, ", {%.4ff, %.4ff, %.4ff, %.4ff}},\n", bounds[0], bounds[1], bounds[2], bounds[3]);
         }
         fputs("};\n\n", fp);
         
@@ -360,8 +712,15 @@ void write_output_text()
         fprintf(fp, "static s64Animation anims_%s[] = {\n", global_modelname);
         for (curnode = list_animations.head; curnode != NULL; curnode = curnode->next)
         {
+            float bounds[4];
             s64Anim* anim = (s64Anim*)curnode->data;
-            fprintf(fp, "    {\"%s\", %d, anim_%s_%s_keyframes},\n", anim->name, anim->keyframes.size, global_modelname, anim->name);
+            calc_animbounds(anim, bounds);
+            fprintf(fp, "    {\"%s\", %d, anim_%s_%s_keyframes, ", anim->name, anim->keyframes.size, global_modelname, anim->name);
+            if (anim->baked)
+                fputs("NULL", fp);
+            else
+                fprintf(fp, "anim_%s_%s_kflookup", global_modelname, anim->name);
+            fprintf(fp, ", {%.4ff, %.4ff, %.4ff, %.4ff}, %d},\n", bounds[0], bounds[1], bounds[2], bounds[3], anim->baked);
         }
         fputs("};\n\n", fp);
 
@@ -405,6 +764,9 @@ void write_output_binary()
     BinFile_MatData* matdatas;
     BinFile_Material_Texture* textures;
     BinFile_Material_PrimColor* primcolors;
+    uint32_t** matdls = NULL;
+    float qerror_pos = 0, qerror_rot = 0, qerror_scale = 0;
+    int packclamps_pos = 0, packclamps_uv = 0, packclamps_normal = 0, packclamps_color = 0;
     
     // Open the file
     sprintf(strbuff, "%s.bin", global_outputname);
@@ -420,12 +782,28 @@ void write_output_binary()
     bin.count_meshes  = list_meshes.size;
     bin.count_materials = 0;
     bin.count_anims   = list_animations.size;
-    if (global_opengl)
+    bin.flags         = 0;
+    bin.posscale      = 1.0f;
+    if (global_quantizeanims)
+        bin.flags |= BINFLAG_QUANTIZEDANIMS;
+    if (global_gfxdlists)
+        bin.flags |= BINFLAG_GFXDLISTS;
+    bin.flags |= BINFLAG_BOUNDS;
+    if (global_lodcount > 0)
+        bin.flags |= BINFLAG_LODS;
+    if (global_packverts)
+        bin.flags |= BINFLAG_PACKEDVERTS;
+    if (global_matdlists)
+        bin.flags |= BINFLAG_MATDLISTS;
+    for (curnode = list_animations.head; curnode != NULL; curnode = curnode->next)
+        if (((s64Anim*)curnode->data)->baked)
+            bin.flags |= BINFLAG_BAKEDANIMS;
+    if (global_opengl || global_matdlists)
     {
         for (curnode = list_materials.head; curnode != NULL; curnode = curnode->next)
         {
             n64Material* mat = (n64Material*)curnode->data;
-            if (isvalidmat(mat))
+            if (isbinarymat(mat))
                 bin.count_materials++;
         }
     }
@@ -435,8 +813,10 @@ void write_output_binary()
     meshdatas = (BinFile_MeshData*)calloc(sizeof(BinFile_MeshData)*list_meshes.size, 1);
     if (!global_opengl)
         vertdatas = (BinFile_UltraVert**)calloc(sizeof(BinFile_UltraVert*)*list_meshes.size, 1);
-    else
+    else if (!global_packverts)
         vertdatas = (BinFile_DragonVert**)calloc(sizeof(BinFile_DragonVert*)*list_meshes.size, 1);
+    else
+        vertdatas = (BinFile_DragonPackedVert**)calloc(sizeof(BinFile_DragonPackedVert*)*list_meshes.size, 1);
     facedatas = (uint16_t**)calloc(sizeof(uint16_t*)*list_meshes.size, 1);
     dldatas = (uint32_t**)calloc(sizeof(uint32_t*)*list_meshes.size, 1);
     vtotal = (int*)calloc(sizeof(int)*list_meshes.size, 1);
@@ -452,10 +832,19 @@ void write_output_binary()
     i = 0;
     for (curnode = list_meshes.head; curnode != NULL; curnode = curnode->next)
     {
+        int l;
         int parent = 0;
+        int levelcount = 0;
+        s64Mesh* levels[MAXLODS+1];
+        int levelverts[MAXLODS+1];
         listNode* vcachenode;
         s64Mesh* mesh = (s64Mesh*)curnode->data;
 
+        // The full detail mesh is followed by its LODs, which get stored in the same vertex and display list blocks
+        levels[levelcount++] = mesh;
+        for (vcachenode = mesh->lods.head; vcachenode != NULL; vcachenode = vcachenode->next)
+            levels[levelcount++] = (s64Mesh*)vcachenode->data;
+
         // Find the parent mesh
         if (mesh->parent != NULL)
         {
@@ -475,11 +864,16 @@ void write_output_binary()
         meshdatas[i].parent = parent;
         meshdatas[i].is_billboard = has_property(mesh, "Billboard");
         meshdatas[i].name = mesh->name;
+        calc_meshbounds(mesh, meshdatas[i].bounds);
+        meshdatas[i].lodcount = levelcount-1;
  
         // Update the mesh data size and offset
         toc_meshes[i].meshdata_size = member_size(BinFile_MeshData, parent) 
                                     + member_size(BinFile_MeshData, is_billboard)
-                                    + strlen(meshdatas[i].name)+1;
+                                    + strlen(meshdatas[i].name)+1
+                                    + member_size(BinFile_MeshData, bounds);
+        if (bin.flags & BINFLAG_LODS)
+            toc_meshes[i].meshdata_size += member_size(BinFile_MeshData, lodcount) + member_size(BinFile_MeshData, lodstarts[0])*meshdatas[i].lodcount;
         if (i == 0)
         {
             toc_meshes[i].meshdata_offset += member_size(BinFile_TOC_Meshes, meshdata_offset);
@@ -502,22 +896,29 @@ void write_output_binary()
             toc_meshes[i].meshdata_offset += member_size(BinFile, offset_meshes);
             toc_meshes[i].meshdata_offset += member_size(BinFile, offset_anims);
             toc_meshes[i].meshdata_offset += member_size(BinFile, offset_materials);
+            toc_meshes[i].meshdata_offset += member_size(BinFile, flags);
+            toc_meshes[i].meshdata_offset += member_size(BinFile, posscale);
         }
         else
             toc_meshes[i].meshdata_offset = toc_meshes[i-1].dldata_offset + toc_meshes[i-1].dldata_size;
 
         // Get the total vert and face count
         vtotal[i] = 0;
-        for (vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
+        for (l=0; l<levelcount; l++)
         {
-            vertCache* vcache = (vertCache*)vcachenode->data;
-            listNode* vertnode;
-            
-            // Cycle through all the verts
-            for (vertnode = vcache->verts.head; vertnode != NULL; vertnode = vertnode->next)
-                vtotal[i]++;
-            for (vertnode = vcache->faces.head; vertnode != NULL; vertnode = vertnode->next)
-                ftotal[i]++;
+            levelverts[l] = vtotal[i];
+            for (vcachenode = levels[l]->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
+            {
+                vertCache* vcache = (vertCache*)vcachenode->data;
+                listNode* vertnode;
+                
+                // Cycle through all the verts
+                for (vertnode = vcache->verts.head; vertnode != NULL; vertnode = vertnode->next)
+                    vtotal[i]++;
+                if (l == 0)
+                    for (vertnode = vcache->faces.head; vertnode != NULL; vertnode = vertnode->next)
+                        ftotal[i]++;
+            }
         }
 
         // Create the vert data
@@ -529,56 +930,59 @@ void write_output_binary()
             if (((BinFile_UltraVert**)vertdatas)[i] == NULL)
                 terminate("Error: Unable to malloc for vert data\n");
 
-            // Copy the vert data by cycling through the vcache blocks
-            for (vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
+            // Copy the vert data by cycling through the vcache blocks of each level
+            for (l=0; l<levelcount; l++)
             {
-                vertCache* vcache = (vertCache*)vcachenode->data;
-                listNode* vertnode;
-                
-                // Cycle through all the verts
-                for (vertnode = vcache->verts.head; vertnode != NULL; vertnode = vertnode->next)
+                for (vcachenode = levels[l]->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
                 {
-                    int texturew = 0, textureh = 0;
-                    s64Vert* vert = (s64Vert*)vertnode->data;
-                    n64Material* mat = find_material_fromvert(&vcache->faces, vert);
-                    Vector3D normorcol = {0, 0, 0};
+                    vertCache* vcache = (vertCache*)vcachenode->data;
+                    listNode* vertnode;
+                
+                    // Cycle through all the verts
+                    for (vertnode = vcache->verts.head; vertnode != NULL; vertnode = vertnode->next)
+                    {
+                        int texturew = 0, textureh = 0;
+                        s64Vert* vert = (s64Vert*)vertnode->data;
+                        n64Material* mat = find_material_fromvert(&vcache->faces, vert);
+                        Vector3D normorcol = {0, 0, 0};
                     
-                    // Ensure the texture is valid
-                    if (mat == NULL)
-                        terminate("Error: Inconsistent face/vertex material information\n");
+                        // Ensure the texture is valid
+                        if (mat == NULL)
+                            terminate("Error: Inconsistent face/vertex material information\n");
                     
-                    // Retrieve texture/normal/color data for this vertex
-                    switch (mat->type)
-                    {
-                        case TYPE_TEXTURE:
-                            // Get the texture size
-                            texturew = (mat->data).image.w;
-                            textureh = (mat->data).image.h;
+                        // Retrieve texture/normal/color data for this vertex
+                        switch (mat->type)
+                        {
+                            case TYPE_TEXTURE:
+                                // Get the texture size
+                                texturew = (mat->data).image.w;
+                                textureh = (mat->data).image.h;
                             
-                            // Intentional fallthrough
-                        case TYPE_PRIMCOL:
-                            // Pick vertex normals or vertex colors, depending on the texture flag
-                            if (mat_hasgeoflag(mat, "G_LIGHTING"))
-                                normorcol = vector_scale(vert->normal, 127);
-                            else
-                                normorcol = vector_scale(vert->color, 255);
-                            break;
-                        case TYPE_OMIT:
-                            break;
-                    }
+                                // Intentional fallthrough
+                            case TYPE_PRIMCOL:
+                                // Pick vertex normals or vertex colors, depending on the texture flag
+                                if (mat_hasgeoflag(mat, "G_LIGHTING"))
+                                    normorcol = vector_scale(vert->normal, 127);
+                                else
+                                    normorcol = vector_scale(vert->color, 255);
+                                break;
+                            case TYPE_OMIT:
+                                break;
+                        }
 
-                    // Dump the vert data
-                    ((BinFile_UltraVert**)vertdatas)[i][j].pos[0] = round(vert->pos.x);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].pos[1] = round(vert->pos.y);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].pos[2] = round(vert->pos.z);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].pad = 0;
-                    ((BinFile_UltraVert**)vertdatas)[i][j].tex[0] = float_to_s10p5(vert->UV.x*texturew);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].tex[1] = float_to_s10p5(vert->UV.y*textureh);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[0] = round(normorcol.x);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[1] = round(normorcol.y);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[2] = round(normorcol.z);
-                    ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[3] = 255;
-                    j++;
+                        // Dump the vert data
+                        ((BinFile_UltraVert**)vertdatas)[i][j].pos[0] = round(vert->pos.x);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].pos[1] = round(vert->pos.y);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].pos[2] = round(vert->pos.z);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].pad = 0;
+                        ((BinFile_UltraVert**)vertdatas)[i][j].tex[0] = float_to_s10p5(vert->UV.x*texturew);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].tex[1] = float_to_s10p5(vert->UV.y*textureh);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[0] = round(normorcol.x);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[1] = round(normorcol.y);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[2] = round(normorcol.z);
+                        ((BinFile_UltraVert**)vertdatas)[i][j].colornormal[3] = 255;
+                        j++;
+                    }
                 }
             }
 
@@ -589,6 +993,48 @@ void write_output_binary()
                                         + member_size(BinFile_UltraVert, colornormal)
                                         )*vtotal[i];
         }
+        else if (global_packverts)
+        {
+            int j = 0;
+
+            ((BinFile_DragonPackedVert**)vertdatas)[i] = (BinFile_DragonPackedVert*)malloc(sizeof(BinFile_DragonPackedVert)*vtotal[i]);
+            if (((BinFile_DragonPackedVert**)vertdatas)[i] == NULL)
+                terminate("Error: Unable to malloc for vert data\n");
+
+            for (vcachenode = mesh->vertcache.head; vcachenode != NULL; vcachenode = vcachenode->next)
+            {
+                listNode* vertnode;
+                vertCache* vcache = (vertCache*)vcachenode->data;
+                
+                // Cycle through all the verts
+                for (vertnode = vcache->verts.head; vertnode != NULL; vertnode = vertnode->next)
+                {
+                    s64Vert* vert = (s64Vert*)vertnode->data;
+                    BinFile_DragonPackedVert* pvert = &((BinFile_DragonPackedVert**)vertdatas)[i][j];
+                    
+                    // Dump the vert data, using the same integer positions as Libultra
+                    pvert->pos[0] = pack_clamped(vert->pos.x, INT16_MIN, INT16_MAX, &packclamps_pos);
+                    pvert->pos[1] = pack_clamped(vert->pos.y, INT16_MIN, INT16_MAX, &packclamps_pos);
+                    pvert->pos[2] = pack_clamped(vert->pos.z, INT16_MIN, INT16_MAX, &packclamps_pos);
+                    pvert->tex[0] = pack_clamped(vert->UV.x*PACKEDVERT_UVSCALE, INT16_MIN, INT16_MAX, &packclamps_uv);
+                    pvert->tex[1] = pack_clamped(vert->UV.y*PACKEDVERT_UVSCALE, INT16_MIN, INT16_MAX, &packclamps_uv);
+                    pvert->normal[0] = pack_clamped(vert->normal.x*127, -127, 127, &packclamps_normal);
+                    pvert->normal[1] = pack_clamped(vert->normal.y*127, -127, 127, &packclamps_normal);
+                    pvert->normal[2] = pack_clamped(vert->normal.z*127, -127, 127, &packclamps_normal);
+                    pvert->color[0] = pack_clamped(vert->color.x*255, 0, 255, &packclamps_color);
+                    pvert->color[1] = pack_clamped(vert->color.y*255, 0, 255, &packclamps_color);
+                    pvert->color[2] = pack_clamped(vert->color.z*255, 0, 255, &packclamps_color);
+                    j++;
+                }
+            }
+
+            // Update the vert data size and offset in the TOC
+            toc_meshes[i].vertdata_size = (member_size(BinFile_DragonPackedVert, pos)
+                                        + member_size(BinFile_DragonPackedVert, tex)
+                                        + member_size(BinFile_DragonPackedVert, normal) 
+                                        + member_size(BinFile_DragonPackedVert, color)
+                                        )*vtotal[i];
+        }
         else
         {
             int j = 0;
@@ -630,7 +1076,7 @@ void write_output_binary()
                                         + member_size(BinFile_DragonVert, color)
                                         )*vtotal[i];
         }
-        toc_meshes[i].vertdata_offset = toc_meshes[i].meshdata_offset + align_32bits(toc_meshes[i].meshdata_size);
+        toc_meshes[i].vertdata_offset = align_64bits(toc_meshes[i].meshdata_offset + toc_meshes[i].meshdata_size); // Verts are aligned so they can be used in place
 
         // Create the faces list (OpenGL)
         if (global_opengl)
@@ -667,7 +1113,7 @@ void write_output_binary()
         }
 
         // Create the display list
-        if (!global_opengl)
+        if (!global_opengl && !global_gfxdlists)
         {
             int offset = 0;
             int finalsize = 0;
@@ -693,7 +1139,7 @@ void write_output_binary()
             if (dldatas[i] == NULL)
                 terminate("Error: Unable to malloc for DLData\n");
 
-            // Copy the binary list to the final data buffer
+            // Copy the binary list to the final data buffer, so that the library can build the display list for whichever microcode it uses
             for (dllnode = dllist->head; dllnode != NULL; dllnode = dllnode->next)
             {
                 DLCBinary* bindl = (DLCBinary*)dllnode->data;
@@ -708,6 +1154,67 @@ void write_output_binary()
                 free(((DLCBinary*)dllnode->data)->data);
             list_destroy_deep(dllist);
         }
+        else if (!global_opengl)
+        {
+            int j;
+            int reloccount = 0;
+            int slotcount = 0;
+            int levelslots[MAXLODS+1];
+            linkedList* dllists[MAXLODS+1];
+            listNode* dllnode;
+
+            // Generate the display list of each level and count the slots. LODs set up all of their own render state, so they can be swapped in for any frame
+            for (l=0; l<levelcount; l++)
+            {
+                if (l == 0)
+                    dllists[l] = dlist_frommesh(mesh, TRUE);
+                else
+                    dllists[l] = dlist_frommesh_standalone(levels[l], TRUE);
+                levelslots[l] = slotcount;
+                slotcount += dlist_slotcount(dllists[l], global_matdlists);
+                if (l > 0)
+                    meshdatas[i].lodstarts[l-1] = levelslots[l];
+            }
+
+            // Malloc the final data buffer, which has the Gfx words followed by the relocations (at most one per Gfx)
+            dldatas[i] = (uint32_t*)calloc(sizeof(uint32_t)*3*slotcount, 1);
+            if (dldatas[i] == NULL)
+                terminate("Error: Unable to malloc for DLData\n");
+
+            // Assemble the display lists one after the other, and then move the relocations right after the Gfx words
+            for (l=0; l<levelcount; l++)
+            {
+                int levelrelocs;
+                uint32_t* relocs = &dldatas[i][2*slotcount + reloccount];
+                if (global_matdlists)
+                    levelrelocs = dlist_assemble_split(dllists[l], &dldatas[i][2*levelslots[l]], relocs);
+                else
+                    levelrelocs = dlist_assemble(dllists[l], &dldatas[i][2*levelslots[l]], relocs);
+
+                // The relocations are relative to the level, so offset them by where the level's Gfx and verts start
+                for (j=0; j<levelrelocs; j++)
+                {
+                    relocs[j] += levelslots[l];
+                    if ((relocs[j] >> 24) == GFXRELOC_VERTEX)
+                        dldatas[i][2*(relocs[j] & 0x00FFFFFF) + 1] += levelverts[l]*sizeof(BinFile_UltraVert);
+                    else if ((relocs[j] >> 24) == GFXRELOC_DLIST)
+                        dldatas[i][2*(relocs[j] & 0x00FFFFFF) + 1] += levelslots[l];
+                }
+                reloccount += levelrelocs;
+
+                // Cleanup memory
+                for (dllnode = dllists[l]->head; dllnode != NULL; dllnode = dllnode->next)
+                    free(((DLCBinary*)dllnode->data)->data);
+                list_destroy_deep(dllists[l]);
+            }
+            for (j=0; j<2*slotcount + reloccount; j++)
+                dldatas[i][j] = swap_endian32(dldatas[i][j]);
+
+            // Update the TOC
+            toc_meshes[i].dldata_size = sizeof(uint32_t)*(2*slotcount + reloccount);
+            toc_meshes[i].dldata_slotcount = slotcount;
+            toc_meshes[i].dldata_offset = toc_meshes[i].vertdata_offset + toc_meshes[i].vertdata_size;
+        }
         else
         {
             int j=0;
@@ -746,7 +1253,7 @@ void write_output_binary()
     }
 
 
-    // -------------- Material Data (OpenGL) --------------
+    // -------------- Material Data --------------
 
     if (bin.count_materials > 0)
     {
@@ -762,7 +1269,7 @@ void write_output_binary()
         for (curnode = list_materials.head; curnode != NULL; curnode = curnode->next)
         {
             n64Material* mat = (n64Material*)curnode->data;
-            if (!isvalidmat(mat))
+            if (!isbinarymat(mat))
                 continue;
             matdatas[i].type = mat->type;
             matdatas[i].lighting = mat_hasgeoflag(mat, "G_LIGHTING");
@@ -791,6 +1298,12 @@ void write_output_binary()
         primcolors = (BinFile_Material_PrimColor*)malloc(sizeof(BinFile_Material_PrimColor)*primcolorcount);
         if ((texturecount > 0 && textures == NULL) || (primcolorcount > 0 && primcolors == NULL))
             terminate("Error: Unable to malloc for material data");
+        if (!global_opengl)
+        {
+            matdls = (uint32_t**)calloc(sizeof(uint32_t*)*bin.count_materials, 1);
+            if (matdls == NULL)
+                terminate("Error: Unable to malloc for material data");
+        }
 
         // Fill in the material structs
         i=0;
@@ -799,9 +1312,30 @@ void write_output_binary()
         for (curnode = list_materials.head; curnode != NULL; curnode = curnode->next)
         {
             n64Material* mat = (n64Material*)curnode->data;
-            if (!isvalidmat(mat))
+            if (!isbinarymat(mat))
                 continue;
-            switch (mat->type)
+            
+            // Libultra materials are a display list, with the slot count first and the relocations after the Gfx words
+            if (!global_opengl)
+            {
+                int slotcount, reloccount;
+                listNode* dllnode;
+                linkedList* dl = dlist_frommaterial(mat);
+                slotcount = dlist_slotcount(dl, FALSE);
+                matdls[i] = (uint32_t*)calloc(sizeof(uint32_t)*(1 + 3*slotcount), 1);
+                if (matdls[i] == NULL)
+                    terminate("Error: Unable to malloc for material display list");
+                matdls[i][0] = slotcount;
+                reloccount = dlist_assemble(dl, &matdls[i][1], &matdls[i][1 + 2*slotcount]);
+                for (j=0; j<1 + 2*slotcount + reloccount; j++)
+                    matdls[i][j] = swap_endian32(matdls[i][j]);
+                toc_materials[i].material_size = sizeof(uint32_t)*(1 + 2*slotcount + reloccount);
+                for (dllnode = dl->head; dllnode != NULL; dllnode = dllnode->next)
+                    free(((DLCBinary*)dllnode->data)->data);
+                list_destroy_deep(dl);
+                free(dl);
+            }
+            else switch (mat->type)
             {
                 case TYPE_TEXTURE:
                     textures[j].w = swap_endian32(mat->data.image.w);
@@ -895,6 +1429,7 @@ void write_output_binary()
         for (kfnode = anim->keyframes.head; kfnode != NULL; kfnode = kfnode->next)
             animdatas[i].kfindices[j++] = ((s64Keyframe*)kfnode->data)->keyframe;
         animdatas[i].name = anim->name;
+        calc_animbounds(anim, animdatas[i].bounds);
 
         // Assign some keyframe data
         kftotal[i] = animdatas[i].kfcount*list_meshes.size;
@@ -908,7 +1443,8 @@ void write_output_binary()
         // Update the anim data size and offset
         toc_anims[i].animdata_size = member_size(BinFile_AnimData, kfcount) 
                                     + (sizeof(uint16_t)*animdatas[i].kfcount)
-                                    + strlen(animdatas[i].name)+1;
+                                    + strlen(animdatas[i].name)+1
+                                    + member_size(BinFile_AnimData, bounds);
         if (i == 0)
             toc_anims[i].animdata_offset = bin.offset_anims +
                                             (member_size(BinFile_TOC_Anims, animdata_offset) +
@@ -917,8 +1453,11 @@ void write_output_binary()
                                             member_size(BinFile_TOC_Anims, kfdata_size))
                                             *list_animations.size;
         else
-            toc_anims[i].animdata_offset = toc_anims[i-1].kfdata_offset + toc_anims[i-1].kfdata_size;
-        toc_anims[i].kfdata_size = (member_size(BinFile_KeyFrame, pos) + member_size(BinFile_KeyFrame, rot) + member_size(BinFile_KeyFrame, scale))*animdatas[i].kfcount*list_meshes.size;
+            toc_anims[i].animdata_offset = toc_anims[i-1].kfdata_offset + align_32bits(toc_anims[i-1].kfdata_size);
+        if (bin.flags & BINFLAG_QUANTIZEDANIMS)
+            toc_anims[i].kfdata_size = (member_size(BinFile_QKeyFrame, pos) + member_size(BinFile_QKeyFrame, rot) + member_size(BinFile_QKeyFrame, scale))*animdatas[i].kfcount*list_meshes.size;
+        else
+            toc_anims[i].kfdata_size = (member_size(BinFile_KeyFrame, pos) + member_size(BinFile_KeyFrame, rot) + member_size(BinFile_KeyFrame, scale))*animdatas[i].kfcount*list_meshes.size;
         toc_anims[i].kfdata_offset = toc_anims[i].animdata_offset + align_32bits(toc_anims[i].animdata_size);
         j=0;
         for (kfnode = anim->keyframes.head; kfnode != NULL; kfnode = kfnode->next)
@@ -953,6 +1492,22 @@ void write_output_binary()
         i++;
     }
 
+    // Calculate the scale to use for quantized translations, so that the largest translation fits in 16 bits
+    if (bin.flags & BINFLAG_QUANTIZEDANIMS)
+    {
+        float largest = 0;
+        for (i=0; i<list_animations.size; i++)
+        {
+            int j, k;
+            for (j=0; j<kftotal[i]; j++)
+                for (k=0; k<3; k++)
+                    if (fabs(kfdatas[i][j].pos[k]) > largest)
+                        largest = fabs(kfdatas[i][j].pos[k]);
+        }
+        if (largest > 0)
+            bin.posscale = largest/32767.0f;
+    }
+
 
     // -------------- Actually start writing the binary file now --------------
 
@@ -960,9 +1515,11 @@ void write_output_binary()
     bin.count_meshes      = swap_endian16(bin.count_meshes);
     bin.count_materials   = swap_endian16(bin.count_materials);
     bin.count_anims       = swap_endian16(bin.count_anims);
-    bin.offset_meshes     = swap_endian16(0x14);
+    bin.offset_meshes     = swap_endian16(0x1C);
     bin.offset_materials  = swap_endian32(bin.offset_materials);
     bin.offset_anims      = swap_endian32(bin.offset_anims);
+    bin.flags             = swap_endian32(bin.flags);
+    bin.posscale          = swap_endianfloat(bin.posscale);
     fwrite(&bin.header, member_size(BinFile, header), 1, fp);
     fwrite(&bin.count_meshes, member_size(BinFile, count_meshes), 1, fp);
     fwrite(&bin.count_materials, member_size(BinFile, count_materials), 1, fp);
@@ -970,6 +1527,10 @@ void write_output_binary()
     fwrite(&bin.offset_meshes, member_size(BinFile, offset_meshes), 1, fp);
     fwrite(&bin.offset_materials, member_size(BinFile, offset_materials), 1, fp);
     fwrite(&bin.offset_anims, member_size(BinFile, offset_anims), 1, fp);
+    fwrite(&bin.flags, member_size(BinFile, flags), 1, fp);
+    fwrite(&bin.posscale, member_size(BinFile, posscale), 1, fp);
+    bin.flags = swap_endian32(bin.flags);
+    bin.posscale = swap_endianfloat(bin.posscale);
 
     // Write the mesh TOCs
     for (i=0; i<list_meshes.size; i++)
@@ -1005,7 +1566,19 @@ void write_output_binary()
         fwrite(&meshdatas[i].parent, member_size(BinFile_MeshData, parent), 1, fp);
         fwrite(&meshdatas[i].is_billboard, member_size(BinFile_MeshData, is_billboard), 1, fp);
         fwrite(meshdatas[i].name, strlen(meshdatas[i].name)+1, 1, fp);
-        writepadding(fp, swap_endian32(toc_meshes[i].meshdata_size));
+        for (j=0; j<4; j++)
+            meshdatas[i].bounds[j] = swap_endianfloat(meshdatas[i].bounds[j]);
+        fwrite(meshdatas[i].bounds, member_size(BinFile_MeshData, bounds), 1, fp);
+        if (bin.flags & BINFLAG_LODS)
+        {
+            fwrite(&meshdatas[i].lodcount, member_size(BinFile_MeshData, lodcount), 1, fp);
+            for (j=0; j<meshdatas[i].lodcount; j++)
+            {
+                meshdatas[i].lodstarts[j] = swap_endian32(meshdatas[i].lodstarts[j]);
+                fwrite(&meshdatas[i].lodstarts[j], member_size(BinFile_MeshData, lodstarts[0]), 1, fp);
+            }
+        }
+        writepadding_to(fp, swap_endian32(toc_meshes[i].vertdata_offset));
         if (!global_opengl)
         {
             for (j=0; j<vtotal[i]; j++)
@@ -1024,12 +1597,31 @@ void write_output_binary()
         }
         else
         {
-            for (j=0; j<vtotal[i]; j++)
+            if (global_packverts)
+            {
+                for (j=0; j<vtotal[i]; j++)
+                {
+                    BinFile_DragonPackedVert* pvert = &((BinFile_DragonPackedVert**)vertdatas)[i][j];
+                    pvert->pos[0] = swap_endian16(pvert->pos[0]);
+                    pvert->pos[1] = swap_endian16(pvert->pos[1]);
+                    pvert->pos[2] = swap_endian16(pvert->pos[2]);
+                    pvert->tex[0] = swap_endian16(pvert->tex[0]);
+                    pvert->tex[1] = swap_endian16(pvert->tex[1]);
+                    fwrite(&pvert->pos[0], member_size(BinFile_DragonPackedVert, pos), 1, fp);
+                    fwrite(&pvert->tex[0], member_size(BinFile_DragonPackedVert, tex), 1, fp);
+                    fwrite(&pvert->normal[0], member_size(BinFile_DragonPackedVert, normal), 1, fp);
+                    fwrite(&pvert->color[0], member_size(BinFile_DragonPackedVert, color), 1, fp);
+                }
+            }
+            else
             {
-                fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].pos[0], member_size(BinFile_DragonVert, pos), 1, fp);
-                fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].tex[0], member_size(BinFile_DragonVert, tex), 1, fp);
-                fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].normal[0], member_size(BinFile_DragonVert, normal), 1, fp);
-                fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].color[0], member_size(BinFile_DragonVert, color), 1, fp);
+                for (j=0; j<vtotal[i]; j++)
+                {
+                    fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].pos[0], member_size(BinFile_DragonVert, pos), 1, fp);
+                    fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].tex[0], member_size(BinFile_DragonVert, tex), 1, fp);
+                    fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].normal[0], member_size(BinFile_DragonVert, normal), 1, fp);
+                    fwrite(&((BinFile_DragonVert**)vertdatas)[i][j].color[0], member_size(BinFile_DragonVert, color), 1, fp);
+                }
             }
             for (j=0; j<ftotal[i]; j++)
                 fwrite(&facedatas[i][j*3], sizeof(uint16_t), 3, fp);
@@ -1064,7 +1656,12 @@ void write_output_binary()
         fwrite(&matdatas[i].depthtest, member_size(BinFile_MatData, depthtest), 1, fp);
         fwrite(matdatas[i].name, strlen(matdatas[i].name)+1, 1, fp);
         writepadding(fp, swap_endian32(toc_materials[i].matdata_size));
-        switch (matdatas[i].type)
+        if (!global_opengl)
+        {
+            fwrite(matdls[i], swap_endian32(toc_materials[i].material_size), 1, fp);
+            writepadding(fp, swap_endian32(toc_materials[i].material_size));
+        }
+        else switch (matdatas[i].type)
         {
             case TYPE_TEXTURE:
                 fwrite(&textures[texturecount].w, member_size(BinFile_Material_Texture, w), 1, fp);
@@ -1098,32 +1695,90 @@ void write_output_binary()
     }
 
     // Write the anim data + keyframes
+    curnode = list_animations.head;
     for (i=0; i<list_animations.size; i++)
     {
         int j;
-        for (j=0; j<animdatas[i].kfcount; j++)
+        const uint32_t kfcount = animdatas[i].kfcount;
+        for (j=0; j<kfcount; j++)
             animdatas[i].kfindices[j] = swap_endian16(animdatas[i].kfindices[j]);
+        if (((s64Anim*)curnode->data)->baked)
+            animdatas[i].kfcount |= BINARY_ANIMBAKED;
         animdatas[i].kfcount = swap_endian32(animdatas[i].kfcount);
         fwrite(&animdatas[i].kfcount, member_size(BinFile_AnimData, kfcount), 1, fp);
-        fwrite(animdatas[i].kfindices, sizeof(uint16_t)*swap_endian32(animdatas[i].kfcount), 1, fp);
+        fwrite(animdatas[i].kfindices, sizeof(uint16_t)*kfcount, 1, fp);
         fwrite(animdatas[i].name, strlen(animdatas[i].name)+1, 1, fp);
+        for (j=0; j<4; j++)
+            animdatas[i].bounds[j] = swap_endianfloat(animdatas[i].bounds[j]);
+        fwrite(animdatas[i].bounds, member_size(BinFile_AnimData, bounds), 1, fp);
         writepadding(fp, swap_endian32(toc_anims[i].animdata_size));
-        for (j=0; j<kftotal[i]; j++)
+        if (bin.flags & BINFLAG_QUANTIZEDANIMS)
+        {
+            for (j=0; j<kftotal[i]; j++)
+            {
+                int k;
+                BinFile_QKeyFrame qkf;
+                BinFile_KeyFrame dqkf;
+                double dot = 0, norm = 0, qdiff = 0, qsum = 0;
+                
+                // Quantize the keyframe, and then measure how much precision we lost
+                quantize_keyframe(&kfdatas[i][j], bin.posscale, &qkf);
+                dequantize_keyframe(&qkf, bin.posscale, &dqkf);
+                for (k=0; k<3; k++)
+                {
+                    if (fabs(dqkf.pos[k] - kfdatas[i][j].pos[k]) > qerror_pos)
+                        qerror_pos = fabs(dqkf.pos[k] - kfdatas[i][j].pos[k]);
+                    if (fabs(dqkf.scale[k] - kfdatas[i][j].scale[k]) > qerror_scale)
+                        qerror_scale = fabs(dqkf.scale[k] - kfdatas[i][j].scale[k]);
+                }
+                for (k=0; k<4; k++)
+                    norm += kfdatas[i][j].rot[k]*kfdatas[i][j].rot[k];
+                norm = (norm > 0) ? 1/sqrt(norm) : 1;
+                for (k=0; k<4; k++)
+                    dot += dqkf.rot[k]*kfdatas[i][j].rot[k];
+                for (k=0; k<4; k++)
+                {
+                    double a = kfdatas[i][j].rot[k]*norm;
+                    double b = (dot < 0) ? -dqkf.rot[k] : dqkf.rot[k];
+                    qdiff += (a - b)*(a - b);
+                    qsum += (a + b)*(a + b);
+                }
+                if (4*atan2(sqrt(qdiff), sqrt(qsum))*(180.0/M_PI) > qerror_rot)
+                    qerror_rot = 4*atan2(sqrt(qdiff), sqrt(qsum))*(180.0/M_PI);
+                
+                // Write it
+                for (k=0; k<3; k++)
+                {
+                    qkf.pos[k] = swap_endian16(qkf.pos[k]);
+                    qkf.rot[k] = swap_endian16(qkf.rot[k]);
+                    qkf.scale[k] = swap_endian16(qkf.scale[k]);
+                }
+                fwrite(&qkf.pos[0], member_size(BinFile_QKeyFrame, pos), 1, fp);
+                fwrite(&qkf.rot[0], member_size(BinFile_QKeyFrame, rot), 1, fp);
+                fwrite(&qkf.scale[0], member_size(BinFile_QKeyFrame, scale), 1, fp);
+            }
+        }
+        else
         {
-            kfdatas[i][j].pos[0] = swap_endianfloat(kfdatas[i][j].pos[0]);
-            kfdatas[i][j].pos[1] = swap_endianfloat(kfdatas[i][j].pos[1]);
-            kfdatas[i][j].pos[2] = swap_endianfloat(kfdatas[i][j].pos[2]);
-            kfdatas[i][j].rot[0] = swap_endianfloat(kfdatas[i][j].rot[0]);
-            kfdatas[i][j].rot[1] = swap_endianfloat(kfdatas[i][j].rot[1]);
-            kfdatas[i][j].rot[2] = swap_endianfloat(kfdatas[i][j].rot[2]);
-            kfdatas[i][j].rot[3] = swap_endianfloat(kfdatas[i][j].rot[3]);
-            kfdatas[i][j].scale[0] = swap_endianfloat(kfdatas[i][j].scale[0]);
-            kfdatas[i][j].scale[1] = swap_endianfloat(kfdatas[i][j].scale[1]);
-            kfdatas[i][j].scale[2] = swap_endianfloat(kfdatas[i][j].scale[2]);
-            fwrite(&kfdatas[i][j].pos[0], member_size(BinFile_KeyFrame, pos), 1, fp);
-            fwrite(&kfdatas[i][j].rot[0], member_size(BinFile_KeyFrame, rot), 1, fp);
-            fwrite(&kfdatas[i][j].scale[0], member_size(BinFile_KeyFrame, scale), 1, fp);
+            for (j=0; j<kftotal[i]; j++)
+            {
+                kfdatas[i][j].pos[0] = swap_endianfloat(kfdatas[i][j].pos[0]);
+                kfdatas[i][j].pos[1] = swap_endianfloat(kfdatas[i][j].pos[1]);
+                kfdatas[i][j].pos[2] = swap_endianfloat(kfdatas[i][j].pos[2]);
+                kfdatas[i][j].rot[0] = swap_endianfloat(kfdatas[i][j].rot[0]);
+                kfdatas[i][j].rot[1] = swap_endianfloat(kfdatas[i][j].rot[1]);
+                kfdatas[i][j].rot[2] = swap_endianfloat(kfdatas[i][j].rot[2]);
+                kfdatas[i][j].rot[3] = swap_endianfloat(kfdatas[i][j].rot[3]);
+                kfdatas[i][j].scale[0] = swap_endianfloat(kfdatas[i][j].scale[0]);
+                kfdatas[i][j].scale[1] = swap_endianfloat(kfdatas[i][j].scale[1]);
+                kfdatas[i][j].scale[2] = swap_endianfloat(kfdatas[i][j].scale[2]);
+                fwrite(&kfdatas[i][j].pos[0], member_size(BinFile_KeyFrame, pos), 1, fp);
+                fwrite(&kfdatas[i][j].rot[0], member_size(BinFile_KeyFrame, rot), 1, fp);
+                fwrite(&kfdatas[i][j].scale[0], member_size(BinFile_KeyFrame, scale), 1, fp);
+            }
         }
+        writepadding(fp, swap_endian32(toc_anims[i].kfdata_size));
+        curnode = curnode->next;
     }
     fclose(fp);
 
@@ -1181,6 +1836,24 @@ void write_output_binary()
     // Done
     fclose(fp);
 
+    // Report the precision lost from quantizing the animations
+    if (!global_quiet && (bin.flags & BINFLAG_QUANTIZEDANIMS))
+    {
+        printf("Quantized animation keyframes\n");
+        printf("    Translation scale: %f\n", bin.posscale);
+        printf("    Max translation error: %f\n", qerror_pos);
+        printf("    Max rotation error: %f degrees\n", qerror_rot);
+        printf("    Max scale error: %f\n", qerror_scale);
+    }
+    
+    // Warn about any vertex values that didn't fit in the packed format
+    if (packclamps_pos > 0)
+        printf("Warning: %d vertex position values didn't fit in 16 bits and were clamped\n", packclamps_pos);
+    if (packclamps_uv > 0)
+        printf("Warning: %d UV values were outside of +-%d texture repeats and were clamped\n", packclamps_uv, (int)(INT16_MAX/PACKEDVERT_UVSCALE));
+    if (!global_quiet && (packclamps_normal > 0 || packclamps_color > 0))
+        printf("Clamped %d normal and %d color values while packing the vertices\n", packclamps_normal, packclamps_color);
+
     // Finished writing the output
     if (!global_quiet) printf("Wrote output to '%s.bin' and '%s.h'\n", global_outputname, global_outputname);
 }
\ No newline at end of file
@@ -364,6 +364,7 @@ void scene_render()
     glClearColor(0.3f, 0.1f, 0.6f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glColorMaterial(GL_FRONT_AND_BACK, GL_DIFFUSE);
+    sausage64_reset_glstate();
 
     // Initialize our view
     glMatrixMode(GL_MODELVIEW);
@@ -13,6 +13,7 @@ https://github.com/buu342/Blender-Sausage64
     #include <asset.h>
 #endif
 #include <stdlib.h>
+#include <assert.h>
 #include <malloc.h>
 #include <string.h>
 
@@ -35,7 +36,81 @@ https://github.com/buu342/Blender-Sausage64
        Binary Asset Macros
 *********************************/
 
-#define BINARY_VERSION 0
+#define BINARY_VERSION 1
+
+// Size of the binary header, and of each entry in its mesh table
+#define BINARY_HEADERSIZE 28
+#ifndef LIBDRAGON
+    #define BINARY_MESHTOCSIZE 0x1C
+#else
+    #define BINARY_MESHTOCSIZE 0x24
+#endif
+
+// Binary header flags
+#define BINFLAG_QUANTIZEDANIMS 0x00000001
+#define BINFLAG_GFXDLISTS      0x00000002
+#define BINFLAG_BOUNDS         0x00000004
+#define BINFLAG_LODS           0x00000008
+#define BINFLAG_PACKEDVERTS    0x00000010
+#define BINFLAG_MATDLISTS      0x00000020
+#define BINFLAG_BAKEDANIMS     0x00000040
+
+// Set in a baked animation's keyframe count, when the binary has baked animations
+#define BINARY_ANIMBAKED 0x80000000
+
+// Relocation types of pre-assembled display lists
+#define BINARY_RELOC_VERTEX   0
+#define BINARY_RELOC_TEXTURE  1
+#define BINARY_RELOC_MATERIAL 2
+#define BINARY_RELOC_DLIST    3
+
+// Range of the three smallest components of a quantized quaternion (1/sqrt(2))
+#define QUAT_SMALLEST3_RANGE 0.70710678118f
+
+// Alignment of each block inside a model's memory arena
+#define s64align(x) (((x) + 15) & ~15)
+
+// Number of Gfx commands in each mesh's instancing display list block
+// The block starts with the display list that restores the mesh's render state, and ends with the one used by instances
+#define S64_INSTANCEDL_SIZE 20
+
+// Number of other mode, combine, and primitive color commands that the RDP state tracker remembers (Libultra only)
+#define S64_RDPMODES 8
+
+// Packed vertex UVs are stored as fixed point with this many units per texture repeat (Libdragon only)
+#define S64_PACKEDUVSCALE 1024.0f
+
+// Alignment that vertex data needs to have in the binary file in order to be used in place
+#ifndef LIBDRAGON
+    #define BINARY_VTXALIGN 8
+#else
+    #define BINARY_VTXALIGN 4
+#endif
+
+// Profiling counters, which compile to nothing unless S64_PROFILE is defined
+// S64_PROFILE_BEGIN declares a variable, so it must come after the function's other declarations
+#ifdef S64_PROFILE
+    #ifndef S64_PROFILE_CLOCK
+        #ifndef LIBDRAGON
+            #define S64_PROFILE_CLOCK() osGetCount()
+        #else
+            #define S64_PROFILE_CLOCK() TICKS_READ()
+        #endif
+    #endif
+    #define S64_PROFILE_BEGIN(name) const u32 s64prof_##name = S64_PROFILE_CLOCK()
+    #define S64_PROFILE_END(name) { s64_stats.name##_cycles += S64_PROFILE_CLOCK() - s64prof_##name; s64_stats.name##_calls++; }
+    #define S64_PROFILE_ADD(field, amount) (s64_stats.field += (amount))
+    #define S64_PROFILE_SUB(field, amount) (s64_stats.field -= (amount))
+    #define S64_PROFILE_GFXBEGIN(glistp) Gfx* const s64prof_glist = *(glistp)
+    #define S64_PROFILE_GFXEND(glistp) (s64_stats.gfxcommands += *(glistp) - s64prof_glist)
+#else
+    #define S64_PROFILE_BEGIN(name)
+    #define S64_PROFILE_END(name)
+    #define S64_PROFILE_ADD(field, amount)
+    #define S64_PROFILE_SUB(field, amount)
+    #define S64_PROFILE_GFXBEGIN(glistp)
+    #define S64_PROFILE_GFXEND(glistp)
+#endif
 
 // Custom Combine LERP function that doesn't do macro hackery
 #ifndef LIBDRAGON
@@ -69,6 +144,8 @@ typedef struct {
     u16 offset_meshes;
     u32 offset_materials;
     u32 offset_anims;
+    u32 flags;
+    f32 posscale;
 } BinFile_Header;
 
 typedef struct {
@@ -87,6 +164,9 @@ typedef struct {
     s16   parent;
     u8    is_billboard;
     char* name;
+    f32   bounds[4];
+    u8    lodcount;
+    u8*   lodstarts;
 } BinFile_MeshData;
 
 typedef struct {
@@ -117,8 +197,97 @@ typedef struct {
     u32 kfcount;
     u16* kfindices;
     char* name;
+    f32 bounds[4];
+    u8 baked;
 } BinFile_AnimData;
 
+// The progress of a binary model that is being built
+typedef struct s64ParseState {
+    u8 stage;
+    u32 step;
+    u8* data;
+    u8* scratch;
+    BinFile_Header header;
+    BinFile_TOC_Meshes* toc_meshes;
+    BinFile_MeshData* meshdatas;
+    BinFile_TOC_Materials* toc_mats;
+    BinFile_MatData* matdatas;
+    BinFile_TOC_Anims* toc_anims;
+    BinFile_AnimData* animdatas;
+    u32 offset_strings, offset_verts, offset_gfx, offset_keyframes, offset_transforms, offset_kflookup;
+    u32 mallocsize_strings, mallocsize_verts, mallocsize_gfx, mallocsize_keyframes, mallocsize_transforms, mallocsize_kflookup;
+    u32 streamslotsize;
+    u32 arenasize;
+    u32 kfsize, kfalign;
+    u8 keepdata;
+    u8 inplace;
+    char* strings;
+    s64Gfx* dlists;
+    s64Mesh* meshes;
+    s64Animation* anims;
+    s64KeyFrame* keyframes;
+    u8* kfblock;
+    s64AnimStream* stream;
+    u16* kflookup;
+    u16* meshorder;
+    s64ModelData* mdl;
+    #ifndef LIBDRAGON
+        u32** textures;
+        Vtx* verts;
+        const Gfx** lodlists;
+        u32 offset_lods;
+        Gfx* matgfx;
+        Gfx** matlists;
+        u32 mallocsize_lods, mallocsize_matgfx, offset_matgfx;
+    #else
+        sprite_t** textures;
+        f32* verts;
+        u16* faces;
+        u32 offset_faces, offset_rbs, offset_texes, offset_primcols;
+        u32 mallocsize_faces, mallocsize_rbs, mallocsize_texes, mallocsize_primcols;
+        s64RenderBlock* rbs;
+        s64Material* mats;
+        s64Texture* texes;
+        s64PrimColor* primcols;
+        GLuint* texids;
+    #endif
+} s64ParseState;
+
+#ifndef LIBDRAGON
+    // The render state that the last material display lists left behind
+    typedef struct {
+        u32 material;
+        u8 geovalid;
+        u32 geomode;
+        u8 modecount;
+        Gfx modes[S64_RDPMODES];
+        u8 texvalid;
+        Gfx texload[7];
+    } s64RDPState;
+#else
+    // The OpenGL state that the last loaded material left behind
+    typedef struct {
+        u8 valid;
+        s64Material* material;
+        u8 textured;
+        GLuint texture;
+        u32 diffuse;
+        u8 cullfront;
+        u8 cullback;
+        u8 lighting;
+        u8 depthtest;
+        u8 smooth;
+    } s64GLState;
+
+    // A render block waiting in the draw queue
+    typedef struct {
+        s64Material* material;
+        GLuint list;
+        u32 matrix;
+        u8 packed;
+    } s64QueueEntry;
+#endif
+
 
 /*********************************
              Enum
@@ -232,6 +401,20 @@ typedef enum {
     SPSelectBranchDL
 } DListCName;
 
+// Stages of loading a binary model in the background
+typedef enum {
+    LOADSTAGE_HEADER = 0,
+    LOADSTAGE_MESHTABLE,
+    LOADSTAGE_MATTABLE,
+    LOADSTAGE_ANIMTABLE,
+    LOADSTAGE_ALLOC,
+    LOADSTAGE_MATERIALS,
+    LOADSTAGE_MESHES,
+    LOADSTAGE_ANIMS,
+    LOADSTAGE_UPLOAD,
+    LOADSTAGE_DONE
+} s64LoadStage;
+
 
 /*********************************
              Globals
@@ -240,9 +423,29 @@ typedef enum {
 #ifndef LIBDRAGON
     static f32 s64_viewmat[4][4];
     static f32 s64_projmat[4][4];
+    static s64CullStats s64_cullstats = {0, 0, 0, 0};
+    static s64RDPState s64_rdpstate = {0};
+    static u32 s64_frame = 0;
+    static u8  s64_frameset = 0;
+    static u8  s64_framestarted = FALSE;
 #else
-    static f32 s64_campos[3];
-    static s64Material* s64_lastmat = NULL;
+    static f32 s64_billboard[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    static f32 s64_basemtx[4][4];
+    static u8  s64_mtxloaded = FALSE;
+    static s64GLState s64_glstate = {FALSE, NULL, 0, 0, 0, 0, 0, 0, 0, 0};
+    static s64QueueEntry* s64_queue = NULL;
+    static u32 s64_queuecount = 0;
+    static u32 s64_queuesize = 0;
+    static f32 (*s64_queuemtx)[4][4] = NULL;
+    static u32 s64_queuemtxcount = 0;
+    static u32 s64_queuemtxsize = 0;
+#endif
+static void* (*s64_allocfunc)(u32) = NULL;
+static void  (*s64_freefunc)(void*) = NULL;
+static u16   s64_animslots = 0;
+static u32   s64_poseids = 0;
+#ifdef S64_PROFILE
+    static s64Stats s64_stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 #endif
 
 
@@ -388,13 +591,13 @@ static inline s64Quat s64slerp(s64Quat a, s64Quat b, f32 f)
 
 
 /*==============================
-    s64quat_to_mtx
-    Converts a quaternion to a rotation matrix
+    s64quat_to_rot
+    Converts a quaternion to a 3x3 rotation matrix
     @param The quaternion to convert
-    @param The rotation matrix to modify
+    @param The rotation matrix to fill
 ==============================*/
 
-static inline void s64quat_to_mtx(s64Quat q, f32 dest[][4])
+static inline void s64quat_to_rot(s64Quat q, f32 dest[3][3])
 {
     f32 xx, yy, zz, xy, yz, xz, wx, wy, wz, norm, s = 0;
     
@@ -426,15 +629,6 @@ static inline void s64quat_to_mtx(s64Quat q, f32 dest[][4])
     dest[0][0] = 1 - yy - zz;
     dest[1][1] = 1 - xx - zz;
     dest[2][2] = 1 - xx - yy;
-    dest[3][3] = 1;
-
-    // The rest of the matrix should be 0
-    dest[3][0] = 0;
-    dest[0][3] = 0;
-    dest[1][3] = 0;
-    dest[2][3] = 0;
-    dest[3][1] = 0;
-    dest[3][2] = 0;
 }
 
 
@@ -497,83 +691,6 @@ static inline s64Quat s64quat_fromeuler(f32 yaw, f32 pitch, f32 roll)
 }
 
 
-#ifndef LIBDRAGON
-    /*==============================
-        s64calc_billboard
-        Calculate a billboard matrix
-        @param The matrix to fill
-    ==============================*/
-
-    static inline void s64calc_billboard(f32 mtx[4][4])
-    {
-        mtx[0][0] = s64_viewmat[0][0];
-        mtx[1][0] = s64_viewmat[0][1];
-        mtx[2][0] = s64_viewmat[0][2];
-        mtx[3][0] = 0;
-
-        mtx[0][1] = s64_viewmat[1][0];
-        mtx[1][1] = s64_viewmat[1][1];
-        mtx[2][1] = s64_viewmat[1][2];
-        mtx[3][1] = 0;
-
-        mtx[0][2] = s64_viewmat[2][0];
-        mtx[1][2] = s64_viewmat[2][1];
-        mtx[2][2] = s64_viewmat[2][2];
-        mtx[3][2] = 0;
-
-        mtx[0][3] = 0;
-        mtx[1][3] = 0;
-        mtx[2][3] = 0;
-        mtx[3][3] = 1;
-    }
-#else
-    /*==============================
-        s64calc_billboard
-        Calculate a billboard matrix
-        @param The matrix to fill
-        @param The model helper
-        @param The mesh to billboard
-    ==============================*/
-
-    static inline void s64calc_billboard(f32 mtx[4][4], s64ModelHelper* mdl, u16 mesh)
-    {
-        f32 w;
-        f32 dir[3];
-        s64Quat q = {0.525322, 0.850904, 0.0, 0.0};
-        s64Quat looked;
-        s64Transform* trans = &mdl->transforms[mesh].data;
-
-        // In libdragon, since we can't retrieve matrix states, we gotta calculate billboarding manually
-        // Luckily, the lookat function will do the heavy lifting, we just need to get the direction of the camera
-        dir[0] = s64_campos[0] - trans->pos[0];
-        dir[1] = s64_campos[1] - trans->pos[1];
-        dir[2] = s64_campos[2] - trans->pos[2];
-        w = sqrtf(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
-        if (w != 0)
-            w = 1/w;
-        else
-            w = 0;
-        dir[0] *= w;
-        dir[1] *= w;
-        dir[2] *= w;
-
-        // Use lookat
-        sausage64_lookat(mdl, mesh, dir, 1.0f, FALSE);
-
-        // Rotate the mesh 90 degrees to match the billboarding in Libultra
-        looked.w = trans->rot[0];
-        looked.x = trans->rot[1];
-        looked.y = trans->rot[2];
-        looked.z = trans->rot[3];
-        q = s64quat_mul(looked, q);
-        trans->rot[0] = q.w;
-        trans->rot[1] = q.x;
-        trans->rot[2] = q.y;
-        trans->rot[3] = q.z;
-    }
-#endif
-
-
 /*==============================
     s64vec_rotate
     Rotate a vector using a quaternion
@@ -639,6 +756,9 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
             .t.repeats = repeatt,
             .t.mirror = mirrort
         });
+        
+        // The texture binding was changed behind the material cache's back
+        s64_glstate.valid = FALSE;
     }
 
 
@@ -651,23 +771,24 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
     void sausage64_unload_texture(s64Texture* tex)
     {
         glDeleteTextures(1, tex->identifier);
+        s64_glstate.valid = FALSE;
     }
 
 
     /*==============================
-        sausage64_load_staticmodel
-        Generates the display lists for a
-        static OpenGL model
-        @param The pointer to the model data
-               to generate
+        sausage64_load_staticmesh
+        Uploads the buffers of a mesh's OpenGL display
+        list, and generates one list per render block
+        @param The display list to generate
     ==============================*/
 
-    void sausage64_load_staticmodel(s64ModelData* mdldata)
+    static void sausage64_load_staticmesh(s64Gfx* dl)
     {
-        u32 meshcount = mdldata->meshcount;
+        u32 facecount = 0, vertcount = 0;
+        const u32 vertsize = dl->packed ? sizeof(s64PackedVert) : sizeof(f32)*11;
 
-        // Check that the model hasn't been initialized yet
-        if (mdldata->meshes[0].dl->guid_mdl != 0xFFFFFFFF)
+        // Check that the mesh hasn't been initialized yet
+        if (dl->guid_mdl != 0xFFFFFFFF)
             return;
 
         // Enable the array client states so that the display list can be built
@@ -676,45 +797,45 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
         glEnableClientState(GL_NORMAL_ARRAY);
         glEnableClientState(GL_COLOR_ARRAY);
 
-        // Generate the buffers, and then assign them to the vert+face arrays
-        for (u32 i=0; i<meshcount; i++)
+        // Count the number of faces
+        for (u32 j=0; j<dl->blockcount; j++)
         {
-            s64Gfx* dl = (s64Gfx*)mdldata->meshes[i].dl;
-            u32 facecount = 0, vertcount = 0;
-
-            // Count the number of faces
-            for (u32 j=0; j<dl->blockcount; j++)
-            {
-                vertcount += dl->renders[j].vertcount;
-                facecount += dl->renders[j].facecount;
-            }
-
-            // Generate the array buffers
-            glGenBuffersARB(1, &dl->guid_verts);
-            glBindBufferARB(GL_ARRAY_BUFFER_ARB, dl->guid_verts);
-            glBufferDataARB(GL_ARRAY_BUFFER_ARB, vertcount*sizeof(f32)*11, dl->renders[0].verts, GL_STATIC_DRAW_ARB);
-            glGenBuffersARB(1, &dl->guid_faces);
-            glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, dl->guid_faces);
-            glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, facecount*sizeof(u16)*3, dl->renders[0].faces, GL_STATIC_DRAW_ARB);
+            vertcount += dl->renders[j].vertcount;
+            facecount += dl->renders[j].facecount;
+        }
 
-            // Now generate the display list
-            dl->guid_mdl = glGenLists(1);
-            glNewList(dl->guid_mdl, GL_COMPILE);
+        // Generate the array buffers
+        glGenBuffersARB(1, &dl->guid_verts);
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, dl->guid_verts);
+        glBufferDataARB(GL_ARRAY_BUFFER_ARB, vertcount*vertsize, dl->renders[0].verts, GL_STATIC_DRAW_ARB);
+        glGenBuffersARB(1, &dl->guid_faces);
+        glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, dl->guid_faces);
+        glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, facecount*sizeof(u16)*3, dl->renders[0].faces, GL_STATIC_DRAW_ARB);
+
+        // Now generate one display list per render block, with only the geometry in it, so that materials are loaded while drawing
+        dl->guid_mdl = glGenLists(dl->blockcount);
+        for (u32 j=0; j<dl->blockcount; j++)
+        {
+            s64RenderBlock* render = &dl->renders[j];
+            int fc = render->facecount;
+            glNewList(dl->guid_mdl + j, GL_COMPILE);
             glBindBufferARB(GL_ARRAY_BUFFER_ARB, dl->guid_verts);
             glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, dl->guid_faces);
-            for (u32 j=0; j<dl->blockcount; j++)
+            if (dl->packed)
+            {
+                glVertexPointer(3, GL_SHORT, sizeof(s64PackedVert), (u8*)(0*sizeof(s16)));
+                glTexCoordPointer(2, GL_SHORT, sizeof(s64PackedVert), (u8*)(3*sizeof(s16)));
+                glNormalPointer(GL_BYTE, sizeof(s64PackedVert), (u8*)(5*sizeof(s16)));
+                glColorPointer(3, GL_UNSIGNED_BYTE, sizeof(s64PackedVert), (u8*)(5*sizeof(s16) + 3*sizeof(s8)));
+            }
+            else
             {
-                s64RenderBlock* render = &dl->renders[j];
-                int fc = render->facecount;
-                if (render->material != NULL && render->material != s64_lastmat)
-                    sausage64_loadmaterial(render->material);
-                s64_lastmat = render->material;
                 glVertexPointer(3, GL_FLOAT, sizeof(f32)*11, (u8*)(0*sizeof(f32)));
                 glTexCoordPointer(2, GL_FLOAT, sizeof(f32)*11, (u8*)(3*sizeof(f32)));
                 glNormalPointer(GL_FLOAT, sizeof(f32)*11, (u8*)(5*sizeof(f32)));
                 glColorPointer(3, GL_FLOAT, sizeof(f32)*11, (u8*)(8*sizeof(f32)));
-                glDrawElements(GL_TRIANGLES, fc * 3, GL_UNSIGNED_SHORT, (u8*)(3*sizeof(u16)*(render->faces - dl->renders[0].faces)));
             }
+            glDrawElements(GL_TRIANGLES, fc * 3, GL_UNSIGNED_SHORT, (u8*)(3*sizeof(u16)*(render->faces - dl->renders[0].faces)));
             glEndList();
         }
         
@@ -723,7 +844,21 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
         glDisableClientState(GL_TEXTURE_COORD_ARRAY);
         glDisableClientState(GL_NORMAL_ARRAY);
         glDisableClientState(GL_COLOR_ARRAY);
-        s64_lastmat = NULL;
+    }
+
+
+    /*==============================
+        sausage64_load_staticmodel
+        Generates the display lists for a
+        static OpenGL model
+        @param The pointer to the model data
+               to generate
+    ==============================*/
+
+    void sausage64_load_staticmodel(s64ModelData* mdldata)
+    {
+        for (u32 i=0; i<mdldata->meshcount; i++)
+            sausage64_load_staticmesh((s64Gfx*)mdldata->meshes[i].dl);
     }
 
 
@@ -743,7 +878,7 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
             s64Gfx* dl = (s64Gfx*)mdldata->meshes[i].dl;
             glDeleteBuffersARB(1, &dl->guid_verts);
             glDeleteBuffersARB(1, &dl->guid_faces);
-            glDeleteLists(dl->guid_mdl, 1);
+            glDeleteLists(dl->guid_mdl, dl->blockcount);
             dl->guid_mdl = 0xFFFFFFFF;
             dl->guid_verts = 0xFFFFFFFF;
             dl->guid_faces = 0xFFFFFFFF;
@@ -767,7 +902,7 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
         int i;
         u32 offset = 0;
         u32 args[16];
-        Gfx* dlist_original = dlist;
+        S64_PROFILE_BEGIN(gendlist);
         while (1)
         {
             u32 datablock = data[offset++];
@@ -881,6 +1016,7 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
                     break;
                 case SPEndDisplayList:
                     gSPEndDisplayList(dlist++);
+                    S64_PROFILE_END(gendlist);
                     return;
                 default:
                     //debug_printf("Warning: Unknown DL Command with ID %d\n", datablock);
@@ -888,113 +1024,272 @@ static inline void s64vec_rotate(f32 vec[3], s64Quat rot, f32 result[3])
             }
         }
     }
+    
+    
+    /*==============================
+        sausage64_relocdlist
+        Patch the vertex and texture pointers of a display
+        list that was pre-assembled by Arabiki64. They're
+        patched in as physical addresses, which the RSP
+        reads the same way as KSEG0 ones
+        @param The display list to patch
+        @param The list of relocations
+        @param The number of relocations
+        @param The list of verts to use
+        @param The list of textures to use
+        @param The list of material display lists to use
+    ==============================*/
+
+    static void sausage64_relocdlist(Gfx* dlist, u32* relocs, u32 count, Vtx* verts, u32** textures, Gfx** materials)
+    {
+        u32 i;
+        int j;
+        for (i=0; i<count; i++)
+        {
+            Gfx* cmd = &dlist[relocs[i] & 0x00FFFFFF];
+            switch (relocs[i] >> 24)
+            {
+                case BINARY_RELOC_VERTEX: // The command has the offset into the vertex list, in bytes
+                    cmd->words.w1 = OS_K0_TO_PHYSICAL(((u8*)verts) + cmd->words.w1);
+                    break;
+                case BINARY_RELOC_TEXTURE: // The command has the texture index, and starts a gDPLoadTextureBlock
+                    if (textures != NULL)
+                        cmd->words.w1 = OS_K0_TO_PHYSICAL(textures[cmd->words.w1]);
+                    else
+                        for (j=0; j<7; j++)
+                            gSPNoOp(&cmd[j]);
+                    break;
+                case BINARY_RELOC_MATERIAL: // The command has the material index, and calls its display list
+                    cmd->words.w1 = OS_K0_TO_PHYSICAL(materials[cmd->words.w1]);
+                    break;
+                case BINARY_RELOC_DLIST: // The command has the slot where the geometry starts, in this same display list
+                    cmd->words.w1 = OS_K0_TO_PHYSICAL(&dlist[cmd->words.w1]);
+                    break;
+            }
+        }
+    }
 #endif
 
 
 /*==============================
-    sausage64_load_binarymodel
-    Load a binary model from ROM
-    @param  (Libultra) The starting address in ROM
-    @param  (Libdragon) The dfs file path of the asset
-    @param  (Libultra) The size of the model
+    sausage64_set_allocator
+    Sets the functions used to allocate and free the memory
+    of binary models, model helpers and the draw queue
+    @param The allocation function, or NULL to use malloc.
+           It must return memory aligned to 16 bytes
+    @param The free function, or NULL to use free
+==============================*/
+
+void sausage64_set_allocator(void* (*allocfunc)(u32), void (*freefunc)(void*))
+{
+    s64_allocfunc = allocfunc;
+    s64_freefunc = freefunc;
+}
+
+
+/*==============================
+    sausage64_set_animstreaming
+    Makes binary models loaded after this call keep their
+    animations in ROM, and only load them when they are
+    played. Older animations are evicted when the pool of
+    animation slots fills up. A helper needs a slot for its
+    animation, one for the blend and one per layer
+    @param The number of animations to keep in memory per
+           model (at least 2), or 0 to load every animation
+==============================*/
+
+void sausage64_set_animstreaming(u16 slots)
+{
+    if (slots == 1)
+        slots = 2;
+    s64_animslots = slots;
+}
+
+
+/*==============================
+    s64alloc
+    Allocates memory with the user's allocator,
+    if one was given
+    @param  The number of bytes to allocate
+    @return The allocated memory, or NULL
+==============================*/
+
+static void* s64alloc(u32 size)
+{
+    if (s64_allocfunc != NULL)
+        return s64_allocfunc(size);
+    return memalign(16, size);
+}
+
+
+/*==============================
+    s64free
+    Frees memory with the user's free function,
+    if one was given
+    @param  The memory to free
+==============================*/
+
+static void s64free(void* ptr)
+{
+    if (s64_freefunc != NULL)
+        s64_freefunc(ptr);
+    else
+        free(ptr);
+}
+
+
+/*==============================
+    s64arena_take
+    Takes a block of memory from an arena
+    @param  A pointer to the next free byte in the arena
+    @param  The size of the block
+    @return The block's address
+==============================*/
+
+static void* s64arena_take(u8** arena, u32 size)
+{
+    void* block = *arena;
+    *arena += s64align(size);
+    return block;
+}
+
+
+/*==============================
+    sausage64_build_kflookup
+    Fills a tick to keyframe lookup table for an animation,
+    so that finding the current keyframe doesn't require
+    walking through the keyframe list
+    @param The lookup table to fill (must have space for the
+           last keyframe's tick + 1 entries)
+    @param The list of keyframe ticks
+    @param The number of keyframes
+==============================*/
+
+static void sausage64_build_kflookup(u16* lookup, const u16* kfticks, u32 kfcount)
+{
+    u32 i, tick = 0;
+    for (i=0; i<kfcount; i++)
+    {
+        const u32 end = (i+1 < kfcount) ? kfticks[i+1] : kfticks[i]+1;
+        while (tick < end)
+            lookup[tick++] = i;
+    }
+}
+
+
+/*==============================
+    sausage64_build_subtree
+    Adds a mesh and all of its children to a mesh order
+    list, depth first, and stores where its subtree starts
+    and how many meshes it has
+    @param The model data
+    @param The mesh order list, followed by the subtrees
+    @param The mesh to add
+    @param A pointer to the number of meshes ordered so far
+==============================*/
+
+static void sausage64_build_subtree(const s64ModelData* mdldata, u16* order, u16 mesh, u16* count)
+{
+    u16 i;
+    u16 (*subtrees)[2] = (u16(*)[2])&order[mdldata->meshcount];
+    subtrees[mesh][0] = *count;
+    order[(*count)++] = mesh;
+    for (i=0; i<mdldata->meshcount; i++)
+        if (mdldata->meshes[i].parent == mesh && i != mesh && subtrees[i][0] == 0xFFFF)
+            sausage64_build_subtree(mdldata, order, i, count);
+    subtrees[mesh][1] = *count - subtrees[mesh][0] - 1;
+}
+
+
+/*==============================
+    sausage64_build_hierarchy
+    Builds the mesh hierarchy of a model, with parents always
+    coming before their children
+    @param The model data
+    @param The list to fill, with space for three u16's
+           per mesh. The first third is the mesh order, the
+           rest is where each subtree starts and its size
+==============================*/
+
+static void sausage64_build_hierarchy(const s64ModelData* mdldata, u16* order)
+{
+    u16 i, count = 0;
+    const u16 mcount = mdldata->meshcount;
+    u16 (*subtrees)[2] = (u16(*)[2])&order[mcount];
+    memset(subtrees, 0xFF, sizeof(u16)*mcount*2);
+    
+    // Go through the tree from every root mesh
+    for (i=0; i<mcount; i++)
+        if (mdldata->meshes[i].parent < 0 || mdldata->meshes[i].parent >= mcount || mdldata->meshes[i].parent == i)
+            sausage64_build_subtree(mdldata, order, i, &count);
+    for (i=0; i<mcount; i++) // Meshes stuck in a parenting loop get treated as roots
+        if (subtrees[i][0] == 0xFFFF)
+            sausage64_build_subtree(mdldata, order, i, &count);
+}
+
+
+/*==============================
+    sausage64_parse_header
+    Reads the header of a binary file, and allocates the
+    scratch memory that its tables are read into
+    @param  The parsing state to fill
+    @param  The binary file data, which only needs its
+            header to be loaded
     @param  (Libultra) The list of textures to use
-    @param  (Libdragon) The list of dfs file paths of textures
-    @return The newly allocated model
+    @param  (Libdragon) The list of texture sprites
+    @return Whether the header is valid and the scratch
+            memory could be allocated
 ==============================*/
 
 #ifndef LIBDRAGON
-s64ModelData* sausage64_load_binarymodel(u32 romstart, u32 size, u32** textures)
+static u8 sausage64_parse_header(s64ParseState* ps, u8* data, u32** textures)
 #else
-s64ModelData* sausage64_load_binarymodel(char* filepath, sprite_t** textures)
+static u8 sausage64_parse_header(s64ParseState* ps, u8* data, sprite_t** textures)
 #endif
 {
-    int i;
-    u8 mallocfailed = FALSE;
-    #ifndef LIBDRAGON
-        OSMesg   dmamsg;
-        OSIoMesg iomsg;
-        OSMesgQueue msgq;
-        u32 left = size;
-    #else
-        int size;
-    #endif
-    u8* data;
+    u8* scratchnext;
     BinFile_Header header;
-    BinFile_TOC_Meshes* toc_meshes = NULL;
-    BinFile_MeshData* meshdatas = NULL;
-    BinFile_TOC_Materials* toc_mats = NULL;
-    BinFile_MatData* matdatas = NULL;
-    BinFile_TOC_Anims* toc_anims = NULL;
-    BinFile_AnimData* animdatas = NULL;
-    u32 mallocsize_strings = 0, mallocsize_verts = 0, mallocsize_gfx = 0, mallocsize_keyframes = 0, mallocsize_transforms = 0;
-    u32 offset_strings = 0, offset_verts = 0, offset_gfx = 0, offset_keyframes = 0, offset_transforms = 0;
-    char* strings = NULL;
+    ps->data = data;
+    ps->textures = textures;
+    ps->keepdata = FALSE;
+    ps->inplace = (s64_animslots == 0); // Streamed models can't keep the file around, since it holds all the animations
+    ps->offset_strings = 0;
+    ps->offset_verts = 0;
+    ps->offset_gfx = 0;
+    ps->offset_keyframes = 0;
+    ps->offset_transforms = 0;
+    ps->offset_kflookup = 0;
+    ps->mallocsize_strings = 0;
+    ps->mallocsize_verts = 0;
+    ps->mallocsize_gfx = 0;
+    ps->mallocsize_keyframes = 0;
+    ps->mallocsize_transforms = 0;
+    ps->mallocsize_kflookup = 0;
+    ps->streamslotsize = 0;
     #ifndef LIBDRAGON
-        Vtx* verts = NULL;
+        ps->offset_lods = 0;
+        ps->offset_matgfx = 0;
+        ps->mallocsize_lods = 0;
+        ps->mallocsize_matgfx = 0;
     #else
-        float* verts = NULL;
-        u16* faces = NULL;
-    #endif
-    s64Gfx* dlists = NULL;
-    s64Mesh* meshes = NULL;
-    s64Animation* anims = NULL;
-    s64KeyFrame* keyframes = NULL;
-    s64Transform* transforms = NULL;
-    s64ModelData* mdl = NULL;
-    #ifdef LIBDRAGON
-        u32 mallocsize_faces = 0, mallocsize_rbs = 0, mallocsize_texes = 0, mallocsize_primcols = 0;
-        u32 offset_faces = 0, offset_rbs = 0;
-        s64RenderBlock* rbs = NULL;
-        s64Material* mats = NULL;
-        s64Texture* texes = NULL;
-        s64PrimColor* primcols = NULL;
-        GLuint* texids = NULL;
+        ps->offset_faces = 0;
+        ps->offset_rbs = 0;
+        ps->offset_texes = 0;
+        ps->offset_primcols = 0;
+        ps->mallocsize_faces = 0;
+        ps->mallocsize_rbs = 0;
+        ps->mallocsize_texes = 0;
+        ps->mallocsize_primcols = 0;
     #endif
-    
-    // Load the asset from ROM
-    #ifndef LIBDRAGON
-        // Reserve some memory for the file we're about to read
-        data = (u8*)memalign(16, size);
-        if (data == NULL)
-            return NULL;
-            
-        // Initialize the message queue and invalidate the data cache
-        osCreateMesgQueue(&msgq, &dmamsg, 1);
-        osInvalDCache((void*)data, size);
 
-        // Read from ROM
-        while (left > 0)
-        {
-            u32 readsize = left;
-            u32 offset;
-            
-            // Limit the size to prevent audio stutters
-            if (readsize > 16384)
-                readsize = 16384;
-                
-            // Perform the read
-            offset = size - left;
-            osPiStartDma(&iomsg, OS_MESG_PRI_NORMAL, OS_READ, romstart+offset, data+offset, readsize, &msgq);
-            (void)osRecvMesg(&msgq, &dmamsg, OS_MESG_BLOCK);
-            left -= readsize;
-        }
-    #else
-        data = (u8*)asset_load(filepath, &size);
-        if (data == NULL)
-            return NULL;
-    #endif
-    
     // Validate
     header.header[0] = data[0];
     header.header[1] = data[1];
     header.header[2] = data[2];
     header.header[3] = data[3];
-    if (header.header[0] != 'S' || header.header[1] != '6' || header.header[2] != '4' || header.header[3] != BINARY_VERSION)
-    {
-        free(data);
-        return NULL;
-    }
-    
+    if (header.header[0] != 'S' || header.header[1] != '6' || header.header[2] != '4' || header.header[3] > BINARY_VERSION)
+        return FALSE;
+
     // Get model data
     header.count_meshes = ((u16*)data)[2];
     header.offset_meshes = ((u16*)data)[5];
@@ -1002,868 +1297,2340 @@ s64ModelData* sausage64_load_binarymodel(char* filepath, sprite_t** textures)
     header.offset_anims = ((u32*)data)[4];
     header.count_materials = ((u16*)data)[3];
     header.offset_materials = ((u32*)data)[3];
-
-    // Malloc temporary mesh data
-    if (header.count_meshes > 0)
+    header.flags = 0;
+    header.posscale = 0;
+    if (header.header[3] >= 1)
     {
-        toc_meshes = (BinFile_TOC_Meshes*)malloc(sizeof(BinFile_TOC_Meshes)*header.count_meshes);
-        meshdatas = (BinFile_MeshData*)malloc(sizeof(BinFile_MeshData)*header.count_meshes);
-        if (toc_meshes == NULL || meshdatas == NULL)
-            mallocfailed = TRUE;
+        header.flags = ((u32*)data)[5];
+        header.posscale = ((f32*)data)[6];
     }
-
-    // Malloc temporary material data
-    if (header.count_materials > 0)
+    if (header.flags & BINFLAG_QUANTIZEDANIMS)
     {
-        toc_mats = (BinFile_TOC_Materials*)malloc(sizeof(BinFile_TOC_Materials)*header.count_materials);
-        matdatas = (BinFile_MatData*)malloc(sizeof(BinFile_MatData)*header.count_materials);
-        if (toc_mats == NULL || matdatas == NULL)
-            mallocfailed = TRUE;
+        ps->kfsize = sizeof(s64QTransform);
+        ps->kfalign = sizeof(s16);
     }
-
-    // Malloc temporary animation data
-    if (header.count_anims > 0)
+    else
     {
-        toc_anims = (BinFile_TOC_Anims*)malloc(sizeof(BinFile_TOC_Anims)*header.count_anims);
-        animdatas = (BinFile_AnimData*)malloc(sizeof(BinFile_AnimData)*header.count_anims);
-        if (toc_anims == NULL || animdatas == NULL)
-            mallocfailed = TRUE;
+        ps->kfsize = sizeof(s64Transform);
+        ps->kfalign = sizeof(f32);
     }
+    ps->header = header;
+
+    // All the temporary data lives in a single scratch block
+    ps->scratch = (u8*)s64alloc(
+        s64align(sizeof(BinFile_TOC_Meshes)*header.count_meshes) + s64align(sizeof(BinFile_MeshData)*header.count_meshes) +
+        s64align(sizeof(BinFile_TOC_Materials)*header.count_materials) + s64align(sizeof(BinFile_MatData)*header.count_materials) +
+        s64align(sizeof(BinFile_TOC_Anims)*header.count_anims) + s64align(sizeof(BinFile_AnimData)*header.count_anims) + 1
+    );
+    if (ps->scratch == NULL)
+        return FALSE;
+    scratchnext = ps->scratch;
+    ps->toc_meshes = (BinFile_TOC_Meshes*)s64arena_take(&scratchnext, sizeof(BinFile_TOC_Meshes)*header.count_meshes);
+    ps->meshdatas = (BinFile_MeshData*)s64arena_take(&scratchnext, sizeof(BinFile_MeshData)*header.count_meshes);
+    ps->toc_mats = (BinFile_TOC_Materials*)s64arena_take(&scratchnext, sizeof(BinFile_TOC_Materials)*header.count_materials);
+    ps->matdatas = (BinFile_MatData*)s64arena_take(&scratchnext, sizeof(BinFile_MatData)*header.count_materials);
+    ps->toc_anims = (BinFile_TOC_Anims*)s64arena_take(&scratchnext, sizeof(BinFile_TOC_Anims)*header.count_anims);
+    ps->animdatas = (BinFile_AnimData*)s64arena_take(&scratchnext, sizeof(BinFile_AnimData)*header.count_anims);
+    return TRUE;
+}
 
-    // Test that malloc succeeded
-    if (mallocfailed)
-    {
-        free(toc_meshes);
-        free(toc_mats);
-        free(toc_anims);
-        free(meshdatas);
-        free(matdatas);
-        free(animdatas);
-        free(data);
-        return NULL;
-    }
-    
-    // To reduce memory fragmentation, we're going to iterate once through everything
-    // to calculate the size we'll need for all the data,
-    // and then the second iteration is when we'll actually populate the data structures
-    for (i=0; i<header.count_meshes; i++)
-    {
-        #ifndef LIBDRAGON
-            int toc_offset = header.offset_meshes + 0x1C*i;
-            BinFile_TOC_Meshes toc_mesh = {
-                *((u32*)&data[toc_offset+0*sizeof(u32)]),
-                *((u32*)&data[toc_offset+1*sizeof(u32)]),
-                *((u32*)&data[toc_offset+2*sizeof(u32)]),
-                *((u32*)&data[toc_offset+3*sizeof(u32)]),
-                0, // Unused in Libultra
-                0, // Unused in Libultra
-                *((u32*)&data[toc_offset+4*sizeof(u32)]),
-                *((u32*)&data[toc_offset+5*sizeof(u32)]),
-                *((u32*)&data[toc_offset+6*sizeof(u32)]),
-            };
-        #else
-            int toc_offset = header.offset_meshes + 0x24*i;
-            BinFile_TOC_Meshes toc_mesh = {
-                *((u32*)&data[toc_offset+0*sizeof(u32)]),
-                *((u32*)&data[toc_offset+1*sizeof(u32)]),
-                *((u32*)&data[toc_offset+2*sizeof(u32)]),
-                *((u32*)&data[toc_offset+3*sizeof(u32)]),
-                *((u32*)&data[toc_offset+4*sizeof(u32)]),
-                *((u32*)&data[toc_offset+5*sizeof(u32)]),
-                *((u32*)&data[toc_offset+6*sizeof(u32)]),
-                *((u32*)&data[toc_offset+7*sizeof(u32)]),
-                *((u32*)&data[toc_offset+8*sizeof(u32)]),
-            };
-        #endif
-        BinFile_MeshData meshdata = {
-            *((u16*)&data[toc_mesh.meshdata_offset]),
-            data[toc_mesh.meshdata_offset+2],
-            (char*)&data[toc_mesh.meshdata_offset+3]
-        };
-        mallocsize_strings += strlen(meshdata.name)+1;
-        #ifndef LIBDRAGON
-            mallocsize_verts += toc_mesh.vertdata_size/sizeof(Vtx);
-            mallocsize_gfx += toc_mesh.dldata_slotcount;
-        #else
-            mallocsize_verts += toc_mesh.vertdata_size/(sizeof(f32)*11);
-            mallocsize_faces += toc_mesh.facedata_size/(sizeof(u16)*3);
-            mallocsize_gfx += 1;
-            mallocsize_rbs += toc_mesh.dldata_slotcount;
-        #endif
-        
-        // Copy the data
-        toc_meshes[i] = toc_mesh;
-        meshdatas[i] = meshdata;
-    }
-    for (i=0; i<header.count_materials; i++)
-    {
-        int toc_offset = header.offset_materials + 0x10*i;
-        BinFile_TOC_Materials toc_mat = {
+
+/*==============================
+    sausage64_parse_meshtable
+    Reads one mesh's table entry and data header, and adds
+    up how much memory the mesh will need.
+    To reduce memory fragmentation, every table entry is
+    read before anything is allocated, so that all the
+    model's data fits in a single allocation
+    @param  The parsing state
+    @param  The mesh to read
+==============================*/
+
+static void sausage64_parse_meshtable(s64ParseState* ps, u32 i)
+{
+    u8* data = ps->data;
+    const int toc_offset = ps->header.offset_meshes + BINARY_MESHTOCSIZE*i;
+    #ifndef LIBDRAGON
+        BinFile_TOC_Meshes toc_mesh = {
             *((u32*)&data[toc_offset+0*sizeof(u32)]),
             *((u32*)&data[toc_offset+1*sizeof(u32)]),
             *((u32*)&data[toc_offset+2*sizeof(u32)]),
             *((u32*)&data[toc_offset+3*sizeof(u32)]),
+            0, // Unused in Libultra
+            0, // Unused in Libultra
+            *((u32*)&data[toc_offset+4*sizeof(u32)]),
+            *((u32*)&data[toc_offset+5*sizeof(u32)]),
+            *((u32*)&data[toc_offset+6*sizeof(u32)]),
         };
-        BinFile_MatData matdata = {
-            *((u8*)&data[toc_mat.matdata_offset+0]),
-            *((u8*)&data[toc_mat.matdata_offset+1]),
-            *((u8*)&data[toc_mat.matdata_offset+2]),
-            *((u8*)&data[toc_mat.matdata_offset+3]),
-            *((u8*)&data[toc_mat.matdata_offset+4]),
-            *((u8*)&data[toc_mat.matdata_offset+5]),
-            ((char*)&data[toc_mat.matdata_offset+6]),
-        };
-        #ifdef LIBDRAGON
-            switch (matdata.type)
-            {
-                case TYPE_TEXTURE: mallocsize_texes++; break;
-                case TYPE_PRIMCOL: mallocsize_primcols++; break;
-            }
-        #endif
-        
-        // Copy the data
-        toc_mats[i] = toc_mat;
-        matdatas[i] = matdata;
-    }
-    for (i=0; i<header.count_anims; i++)
-    {
-        int toc_offset = header.offset_anims + 0x10*i;
-        BinFile_TOC_Anims toc_anim = {
+    #else
+        BinFile_TOC_Meshes toc_mesh = {
             *((u32*)&data[toc_offset+0*sizeof(u32)]),
             *((u32*)&data[toc_offset+1*sizeof(u32)]),
             *((u32*)&data[toc_offset+2*sizeof(u32)]),
             *((u32*)&data[toc_offset+3*sizeof(u32)]),
+            *((u32*)&data[toc_offset+4*sizeof(u32)]),
+            *((u32*)&data[toc_offset+5*sizeof(u32)]),
+            *((u32*)&data[toc_offset+6*sizeof(u32)]),
+            *((u32*)&data[toc_offset+7*sizeof(u32)]),
+            *((u32*)&data[toc_offset+8*sizeof(u32)]),
         };
-        BinFile_AnimData animdata = {
-            *((u32*)&data[toc_anim.animdata_offset]),
-            (u16*)&data[toc_anim.animdata_offset+2*sizeof(u16)]
-        };
-        animdata.name = (((char*)(animdata.kfindices)) + animdata.kfcount*sizeof(u16));
-        mallocsize_strings += strlen(animdata.name)+1;
-        mallocsize_keyframes += animdata.kfcount;
-        mallocsize_transforms += animdata.kfcount*header.count_meshes;
-        
-        // Copy the data
-        toc_anims[i] = toc_anim;
-        animdatas[i] = animdata;
-    }
-    
-    // Perform the mallocs for the data we're actually going to need
-    mdl = (s64ModelData*)malloc(sizeof(s64ModelData));
-    strings = (char*)malloc(sizeof(char)*mallocsize_strings);
-    if (mdl == NULL || strings == NULL)
-        mallocfailed = TRUE;
-
-    // Malloc mesh data
-    if (header.count_meshes > 0)
-    {
-        meshes = (s64Mesh*)malloc(sizeof(s64Mesh)*header.count_meshes);
-        #ifndef LIBDRAGON
-            verts = (Vtx*)malloc(sizeof(Vtx)*mallocsize_verts);
-        #else
-            verts = (f32*)malloc(sizeof(f32)*mallocsize_verts*11);
-            faces = (u16*)malloc(sizeof(u16)*mallocsize_faces*3);
-            rbs = (s64RenderBlock*)malloc(sizeof(s64RenderBlock)*mallocsize_rbs);
-            if (faces == NULL || rbs == NULL)
-                mallocfailed = TRUE;
-        #endif
-        dlists = (s64Gfx*)malloc(sizeof(s64Gfx)*mallocsize_gfx);
-        if (meshes == NULL || verts == NULL || dlists == NULL)
-            mallocfailed = TRUE;
-    }
-
-    // Malloc material data
-    #ifdef LIBDRAGON
-        if (header.count_materials > 0)
+    #endif
+    BinFile_MeshData meshdata = {
+        *((u16*)&data[toc_mesh.meshdata_offset]),
+        data[toc_mesh.meshdata_offset+2],
+        (char*)&data[toc_mesh.meshdata_offset+3],
+        {0, 0, 0, 0},
+        0,
+        NULL
+    };
+    if (ps->header.flags & BINFLAG_BOUNDS)
+        memcpy(meshdata.bounds, meshdata.name+strlen(meshdata.name)+1, sizeof(meshdata.bounds));
+    ps->mallocsize_strings += strlen(meshdata.name)+1;
+    #ifndef LIBDRAGON
+        if ((ps->header.flags & BINFLAG_LODS) && (ps->header.flags & BINFLAG_GFXDLISTS))
         {
-            mats = (s64Material*)malloc(sizeof(s64Material)*header.count_materials);
-            if (mats == NULL)
-                mallocfailed = TRUE;
-            if (mallocsize_texes > 0)
-            {
-                texes = (s64Texture*)malloc(sizeof(s64Texture)*mallocsize_texes);
-                texids = (GLuint*)malloc(sizeof(GLuint)*mallocsize_texes);
-                if (texes == NULL || texids == NULL)
-                    mallocfailed = TRUE;
-            }
-            if (mallocsize_primcols > 0)
-            {
-                primcols = (s64PrimColor*)malloc(sizeof(s64PrimColor)*mallocsize_primcols);
-                if (primcols == NULL)
-                    mallocfailed = TRUE;
-            }
+            u8* lodtable = (u8*)meshdata.name+strlen(meshdata.name)+1+sizeof(meshdata.bounds);
+            meshdata.lodcount = lodtable[0];
+            meshdata.lodstarts = lodtable+1;
+            ps->mallocsize_lods += meshdata.lodcount;
         }
+        if (!ps->inplace || toc_mesh.vertdata_offset % BINARY_VTXALIGN != 0)
+            ps->mallocsize_verts += toc_mesh.vertdata_size/sizeof(Vtx);
+        if (!(ps->header.flags & BINFLAG_GFXDLISTS) || !ps->inplace || toc_mesh.dldata_offset % sizeof(Gfx) != 0)
+            ps->mallocsize_gfx += toc_mesh.dldata_slotcount;
+    #else
+        if (!ps->inplace || toc_mesh.vertdata_offset % BINARY_VTXALIGN != 0)
+            ps->mallocsize_verts += toc_mesh.vertdata_size/sizeof(f32);
+        if (!ps->inplace || toc_mesh.facedata_offset % sizeof(u16) != 0)
+            ps->mallocsize_faces += toc_mesh.facedata_size/(sizeof(u16)*3);
+        ps->mallocsize_gfx += 1;
+        ps->mallocsize_rbs += toc_mesh.dldata_slotcount;
     #endif
 
-    // Malloc animation data
-    if (header.count_anims > 0)
-    {
-        anims = (s64Animation*)malloc(sizeof(s64Animation)*header.count_anims);
-        keyframes = (s64KeyFrame*)malloc(sizeof(s64KeyFrame)*mallocsize_keyframes);
-        transforms = (s64Transform*)malloc(sizeof(s64Transform)*mallocsize_transforms);
-        if (anims == NULL || keyframes == NULL || transforms == NULL)
-            mallocfailed = TRUE;
-    }
+    // Copy the data
+    ps->toc_meshes[i] = toc_mesh;
+    ps->meshdatas[i] = meshdata;
+}
 
-    // Test that malloc succeeded
-    if (mallocfailed)
-    {
-        free(mdl);
-        free(meshes);
-        free(strings);
-        free(verts);
-        #ifdef LIBDRAGON
-            free(faces);
-            free(rbs);
-            free(mats);
-            free(texes);
-            free(texids);
-            free(primcols);
-        #endif
-        free(dlists);
-        free(anims);
-        free(keyframes);
-        free(transforms);
-        free(toc_meshes);
-        free(toc_mats);
-        free(toc_anims);
-        free(meshdatas);
-        free(matdatas);
-        free(animdatas);
-        free(data);
-        return NULL;
-    }
-    // Now we will actually pull data from the binary file and copy it over to our s64 data structs
-    for (i=0; i<header.count_meshes; i++)
-    {
-        // Copy the s64Mesh
-        *(u32*)&meshes[i].is_billboard = meshdatas[i].is_billboard;
-        *(s32*)&meshes[i].parent = meshdatas[i].parent;
-        meshes[i].name = strings+offset_strings;
-        strcpy(strings+offset_strings, meshdatas[i].name);
-        meshes[i].dl = &dlists[offset_gfx];
 
-        #ifndef LIBDRAGON
-            // Copy the vertex data
-            // It's aligned by design (Thanks SGI!), so we can just memcpy
-            memcpy(&verts[offset_verts], &data[toc_meshes[i].vertdata_offset], toc_meshes[i].vertdata_size);
-            
-            // Generate the display list
-            sausage64_gendlist((u32*)(&data[toc_meshes[i].dldata_offset]), &dlists[offset_gfx], &verts[offset_verts], textures);
-            
-            // Increment pointers
-            offset_verts += toc_meshes[i].vertdata_size/sizeof(Vtx);
-            offset_gfx += toc_meshes[i].dldata_slotcount;
-        #else
-            // Copy the vertex and face data
-            memcpy(&verts[offset_verts], &data[toc_meshes[i].vertdata_offset], toc_meshes[i].vertdata_size);
-            memcpy(&faces[offset_faces], &data[toc_meshes[i].facedata_offset], toc_meshes[i].facedata_size);
-
-            // Copy the s64Gfx data
-            dlists[offset_gfx].blockcount = toc_meshes[i].dldata_slotcount;
-            dlists[offset_gfx].guid_mdl = 0xFFFFFFFF;
-            dlists[offset_gfx].guid_verts = 0xFFFFFFFF;
-            dlists[offset_gfx].guid_faces = 0xFFFFFFFF;
-            dlists[offset_gfx].renders = &rbs[offset_rbs];
-            meshes[i].dl = &dlists[offset_gfx];
-
-            // Copy the render block data
-            for (int j=0; j<toc_meshes[i].dldata_slotcount; j++)
-            {
-                int curoffset = toc_meshes[i].dldata_offset + j*0xC;
-                int matid = *((u32*)&data[curoffset + 2*sizeof(u32)]); 
-                rbs[offset_rbs + j].vertcount = *((u16*)&data[curoffset + 0*sizeof(u16)]);
-                rbs[offset_rbs + j].verts     = (f32(*)[11])(&verts[offset_verts] + (*((u16*)&data[curoffset + 1*sizeof(u16)]))*11);
-                rbs[offset_rbs + j].facecount = *((u16*)&data[curoffset + 2*sizeof(u16)]);
-                rbs[offset_rbs + j].faces     = (u16(*)[3])(&faces[offset_faces] + (*((u16*)&data[curoffset + 3*sizeof(u16)]))*3);
-                if (matid == -1)
-                    rbs[offset_rbs + j].material = NULL;
-                else
-                    rbs[offset_rbs + j].material = &mats[matid];
-            }
+/*==============================
+    sausage64_parse_mattable
+    Reads one material's table entry and data header, and
+    adds up how much memory the material will need
+    @param  The parsing state
+    @param  The material to read
+==============================*/
 
-            offset_verts += toc_meshes[i].vertdata_size/(sizeof(f32));
-            offset_faces += toc_meshes[i].facedata_size/(sizeof(u16));
-            offset_rbs += toc_meshes[i].dldata_slotcount;
-            offset_gfx += 1;
-        #endif
-        offset_strings += strlen(meshes[i].name)+1;
-    }
-    #ifdef LIBDRAGON
-        mallocsize_texes = 0;
-        mallocsize_primcols = 0;
-        for (i=0; i<header.count_materials; i++)
-        {
-            mats[i].type = matdatas[i].type;
-            mats[i].lighting = matdatas[i].lighting;
-            mats[i].cullfront = matdatas[i].cullfront;
-            mats[i].cullback = matdatas[i].cullback;
-            mats[i].smooth = matdatas[i].smooth;
-            mats[i].depthtest = matdatas[i].depthtest;
-            switch (mats[i].type)
-            {
-                case TYPE_TEXTURE:
-                    mats[i].data = &texes[mallocsize_texes];
-                    texids[mallocsize_texes] = 0xFFFFFFFF;
-                    texes[mallocsize_texes].identifier = &texids[mallocsize_texes];
-                    texes[mallocsize_texes].w = *(u32*)&data[toc_mats[i].material_offset + 0];
-                    texes[mallocsize_texes].h = *(u32*)&data[toc_mats[i].material_offset + 4];
-                    texes[mallocsize_texes].filter = *(u32*)&data[toc_mats[i].material_offset + 8];
-                    texes[mallocsize_texes].wraps = *(u16*)&data[toc_mats[i].material_offset + 12];
-                    texes[mallocsize_texes].wrapt = *(u16*)&data[toc_mats[i].material_offset + 14];
-                    sausage64_load_texture(&texes[mallocsize_texes], textures[mallocsize_texes]);
-                    mallocsize_texes++;
-                    break;
-                case TYPE_PRIMCOL:
-                    mats[i].data = &primcols[mallocsize_primcols];
-                    primcols[mallocsize_primcols].r = data[toc_mats[i].material_offset + 0];
-                    primcols[mallocsize_primcols].g = data[toc_mats[i].material_offset + 1];
-                    primcols[mallocsize_primcols].b = data[toc_mats[i].material_offset + 2];
-                    primcols[mallocsize_primcols].a = data[toc_mats[i].material_offset + 3];
-                    mallocsize_primcols++;
-                    break;
-                default: break;
-            }
-        }
-    #endif
-    for (i=0; i<header.count_anims; i++)
-    {
-        int j;
-        
-        // Copy the s64Animation
-        anims[i].name = strings+offset_strings;
-        strcpy(strings+offset_strings, animdatas[i].name);
-        *(u32*)&anims[i].keyframecount = animdatas[i].kfcount;
-        anims[i].keyframes = &keyframes[offset_keyframes];
-        
-        // Copy the s64KeyFrame
-        for (j=0; j<animdatas[i].kfcount; j++)
-        {
-            *(u32*)&keyframes[offset_keyframes + j].framenumber = animdatas[i].kfindices[j];
-            keyframes[offset_keyframes + j].framedata = &transforms[offset_transforms+j*header.count_meshes];
-        }
-        
-        // Memcpy the s64Transforms
-        memcpy(&transforms[offset_transforms], &data[toc_anims[i].kfdata_offset], toc_anims[i].kfdata_size);
-        
-        // Increment pointers
-        offset_strings += strlen(anims[i].name)+1;
-        offset_keyframes += animdatas[i].kfcount;
-        offset_transforms += header.count_meshes*animdatas[i].kfcount;
-    }
-    
-    // Populate the model data struct
-    *(u16*)&mdl->meshcount = header.count_meshes;
-    *(u16*)&mdl->animcount = header.count_anims;
-    mdl->meshes = meshes;
-    mdl->anims = anims;
+static void sausage64_parse_mattable(s64ParseState* ps, u32 i)
+{
+    u8* data = ps->data;
+    const int toc_offset = ps->header.offset_materials + 0x10*i;
+    BinFile_TOC_Materials toc_mat = {
+        *((u32*)&data[toc_offset+0*sizeof(u32)]),
+        *((u32*)&data[toc_offset+1*sizeof(u32)]),
+        *((u32*)&data[toc_offset+2*sizeof(u32)]),
+        *((u32*)&data[toc_offset+3*sizeof(u32)]),
+    };
+    BinFile_MatData matdata = {
+        *((u8*)&data[toc_mat.matdata_offset+0]),
+        *((u8*)&data[toc_mat.matdata_offset+1]),
+        *((u8*)&data[toc_mat.matdata_offset+2]),
+        *((u8*)&data[toc_mat.matdata_offset+3]),
+        *((u8*)&data[toc_mat.matdata_offset+4]),
+        *((u8*)&data[toc_mat.matdata_offset+5]),
+        ((char*)&data[toc_mat.matdata_offset+6]),
+    };
     #ifndef LIBDRAGON
-        mdl->_vtxcleanup = verts;
+        if (ps->header.flags & BINFLAG_MATDLISTS)
+            ps->mallocsize_matgfx += *((u32*)&data[toc_mat.material_offset]);
     #else
-        mdl->_matscleanup = mats;
-        mdl->_matscount = header.count_materials;
+        switch (matdata.type)
+        {
+            case TYPE_TEXTURE: ps->mallocsize_texes++; break;
+            case TYPE_PRIMCOL: ps->mallocsize_primcols++; break;
+        }
     #endif
 
-    // Initialize the display lists for Libdragon
-    #ifdef LIBDRAGON
-        sausage64_load_staticmodel(mdl);
-    #endif
-    
-    // Finish by cleaning up memory we used temporarily and returning the model data pointer
-    if (header.count_meshes > 0)
-    {
-        free(toc_meshes);
-        free(meshdatas);
-    }
-    if (header.count_materials > 0)
+    // Copy the data
+    ps->toc_mats[i] = toc_mat;
+    ps->matdatas[i] = matdata;
+}
+
+
+/*==============================
+    sausage64_parse_animtable
+    Reads one animation's table entry and data header, and
+    adds up how much memory the animation will need
+    @param  The parsing state
+    @param  The animation to read
+==============================*/
+
+static void sausage64_parse_animtable(s64ParseState* ps, u32 i)
+{
+    u8* data = ps->data;
+    const int toc_offset = ps->header.offset_anims + 0x10*i;
+    const u32 kfsize = ps->kfsize;
+    BinFile_TOC_Anims toc_anim = {
+        *((u32*)&data[toc_offset+0*sizeof(u32)]),
+        *((u32*)&data[toc_offset+1*sizeof(u32)]),
+        *((u32*)&data[toc_offset+2*sizeof(u32)]),
+        *((u32*)&data[toc_offset+3*sizeof(u32)]),
+    };
+    BinFile_AnimData animdata = {
+        *((u32*)&data[toc_anim.animdata_offset]),
+        (u16*)&data[toc_anim.animdata_offset+2*sizeof(u16)]
+    };
+    animdata.baked = FALSE;
+    if ((ps->header.flags & BINFLAG_BAKEDANIMS) && (animdata.kfcount & BINARY_ANIMBAKED))
     {
-        free(toc_mats);
-        free(matdatas);
+        animdata.kfcount &= ~BINARY_ANIMBAKED;
+        animdata.baked = TRUE;
     }
-    if (header.count_anims > 0)
+    animdata.name = (((char*)(animdata.kfindices)) + animdata.kfcount*sizeof(u16));
+    memset(animdata.bounds, 0, sizeof(animdata.bounds));
+    if (ps->header.flags & BINFLAG_BOUNDS)
+        memcpy(animdata.bounds, animdata.name+strlen(animdata.name)+1, sizeof(animdata.bounds));
+    ps->mallocsize_strings += strlen(animdata.name)+1;
+    ps->mallocsize_keyframes += animdata.kfcount;
+    if (s64_animslots > 0)
     {
-        free(toc_anims);
-        free(animdatas);
+        if (s64align(kfsize*animdata.kfcount*ps->header.count_meshes) > ps->streamslotsize)
+            ps->streamslotsize = s64align(kfsize*animdata.kfcount*ps->header.count_meshes);
     }
-    free(data);
-    return mdl;
+    else if (toc_anim.kfdata_offset % ps->kfalign != 0)
+        ps->mallocsize_transforms += animdata.kfcount*ps->header.count_meshes;
+    if (animdata.kfcount > 0 && !animdata.baked)
+        ps->mallocsize_kflookup += animdata.kfindices[animdata.kfcount-1]+1;
+
+    // Copy the data
+    ps->toc_anims[i] = toc_anim;
+    ps->animdatas[i] = animdata;
 }
 
 
 /*==============================
-    sausage64_unload_binarymodel
-    Free the memory used by a dynamically loaded binary model
-    @param  The model to free
+    sausage64_parse_alloc
+    Allocates the model, once every table entry has been
+    read
+    @param  The parsing state
+    @param  (Libultra) The starting address in ROM
+    @param  (Libdragon) The dfs file path of the asset
+    @return Whether the model could be allocated
 ==============================*/
 
-void sausage64_unload_binarymodel(s64ModelData* mdl)
+#ifndef LIBDRAGON
+static u8 sausage64_parse_alloc(s64ParseState* ps, u32 romstart)
+#else
+static u8 sausage64_parse_alloc(s64ParseState* ps, char* filepath)
+#endif
 {
-    // Because all the data is malloc'd sequentially, to free, we just need to free the first instance of everything
-    if (mdl->meshcount > 0)
+    int i;
+    u8* arena;
+    s64AnimStream* stream = NULL;
+    const BinFile_Header* header = &ps->header;
+    const u32 kfsize = ps->kfsize;
+
+    // Calculate how big the model's arena needs to be, so that everything can go in a single allocation
+    ps->arenasize = s64align(sizeof(s64ModelData)) + s64align(sizeof(char)*ps->mallocsize_strings);
+    ps->arenasize += s64align(sizeof(s64Mesh)*header->count_meshes) + s64align(sizeof(s64Gfx)*ps->mallocsize_gfx);
+    #ifndef LIBDRAGON
+        ps->arenasize += s64align(sizeof(Vtx)*ps->mallocsize_verts) + s64align(sizeof(Gfx*)*ps->mallocsize_lods);
+        ps->arenasize += s64align(sizeof(Gfx)*ps->mallocsize_matgfx) + s64align(sizeof(Gfx*)*header->count_materials);
+    #else
+        ps->arenasize += s64align(sizeof(f32)*ps->mallocsize_verts) + s64align(sizeof(u16)*ps->mallocsize_faces*3) + s64align(sizeof(s64RenderBlock)*ps->mallocsize_rbs);
+        ps->arenasize += s64align(sizeof(s64Material)*header->count_materials) + s64align(sizeof(s64Texture)*ps->mallocsize_texes);
+        ps->arenasize += s64align(sizeof(GLuint)*ps->mallocsize_texes) + s64align(sizeof(s64PrimColor)*ps->mallocsize_primcols);
+    #endif
+    ps->arenasize += s64align(sizeof(s64Animation)*header->count_anims) + s64align(sizeof(s64KeyFrame)*ps->mallocsize_keyframes);
+    ps->arenasize += s64align(kfsize*ps->mallocsize_transforms);
+    if (s64_animslots > 0 && header->count_anims > 0)
     {
+        ps->arenasize += s64align(sizeof(s64AnimStream)) + s64align(ps->streamslotsize*s64_animslots);
+        ps->arenasize += s64align(sizeof(u16)*s64_animslots) + s64align(sizeof(u32)*s64_animslots);
+        ps->arenasize += s64align(sizeof(u16)*header->count_anims) + s64align(sizeof(u32)*header->count_anims);
         #ifdef LIBDRAGON
-            int i;
-            s64Texture* firsttex = NULL;
-            s64PrimColor* firstprimcol = NULL;
-            for (i=0; i<mdl->_matscount; i++)
-            {
-                s64Material* mat = &mdl->_matscleanup[i];
-                if (mat != NULL)
-                {
-                    switch (mat->type)
-                    {
-                        case TYPE_TEXTURE: 
-                            if (firsttex == NULL) 
-                                firsttex = (s64Texture*)mat->data;
-                            sausage64_unload_texture((s64Texture*)mat->data);
-                            break;
-                        case TYPE_PRIMCOL: 
-                            if (firstprimcol == NULL) 
-                                firstprimcol = (s64PrimColor*)mat->data;
-                            break;
-                        default: break;
-                    }
-                }
-            }
-            if (firsttex != NULL)
-                free(firsttex->identifier);
-            free(firsttex);
-            free(firstprimcol);
-            free(mdl->_matscleanup);
-            sausage64_unload_staticmodel(mdl);
-            free(mdl->meshes[0].dl->renders[0].verts);
-            free(mdl->meshes[0].dl->renders[0].faces);
-            free(mdl->meshes[0].dl->renders);
-        #else
-            free(mdl->_vtxcleanup);
+            ps->arenasize += s64align(strlen(filepath)+1);
         #endif
-        free((char*)mdl->meshes[0].name);
-        free((s64Gfx*)mdl->meshes[0].dl);
-        free((s64Mesh*)mdl->meshes);
     }
-    if (mdl->animcount > 0)
+    ps->arenasize += s64align(sizeof(u16)*ps->mallocsize_kflookup);
+    ps->arenasize += s64align(sizeof(u16)*header->count_meshes*3);
+
+    // Allocate the arena
+    arena = (u8*)s64alloc(ps->arenasize);
+    if (arena == NULL)
+        return FALSE;
+
+    // Split the arena into the blocks we need, in the same order as above
+    ps->mdl = (s64ModelData*)s64arena_take(&arena, sizeof(s64ModelData));
+    ps->strings = (char*)s64arena_take(&arena, sizeof(char)*ps->mallocsize_strings);
+    ps->meshes = (s64Mesh*)s64arena_take(&arena, sizeof(s64Mesh)*header->count_meshes);
+    ps->dlists = (s64Gfx*)s64arena_take(&arena, sizeof(s64Gfx)*ps->mallocsize_gfx);
+    #ifndef LIBDRAGON
+        ps->verts = (Vtx*)s64arena_take(&arena, sizeof(Vtx)*ps->mallocsize_verts);
+        ps->lodlists = (const Gfx**)s64arena_take(&arena, sizeof(Gfx*)*ps->mallocsize_lods);
+        ps->matgfx = (Gfx*)s64arena_take(&arena, sizeof(Gfx)*ps->mallocsize_matgfx);
+        ps->matlists = (Gfx**)s64arena_take(&arena, sizeof(Gfx*)*header->count_materials);
+    #else
+        ps->verts = (f32*)s64arena_take(&arena, sizeof(f32)*ps->mallocsize_verts);
+        ps->faces = (u16*)s64arena_take(&arena, sizeof(u16)*ps->mallocsize_faces*3);
+        ps->rbs = (s64RenderBlock*)s64arena_take(&arena, sizeof(s64RenderBlock)*ps->mallocsize_rbs);
+        ps->mats = (s64Material*)s64arena_take(&arena, sizeof(s64Material)*header->count_materials);
+        ps->texes = (s64Texture*)s64arena_take(&arena, sizeof(s64Texture)*ps->mallocsize_texes);
+        ps->texids = (GLuint*)s64arena_take(&arena, sizeof(GLuint)*ps->mallocsize_texes);
+        ps->primcols = (s64PrimColor*)s64arena_take(&arena, sizeof(s64PrimColor)*ps->mallocsize_primcols);
+    #endif
+    ps->anims = (s64Animation*)s64arena_take(&arena, sizeof(s64Animation)*header->count_anims);
+    ps->keyframes = (s64KeyFrame*)s64arena_take(&arena, sizeof(s64KeyFrame)*ps->mallocsize_keyframes);
+    ps->kfblock = (u8*)s64arena_take(&arena, kfsize*ps->mallocsize_transforms);
+    if (s64_animslots > 0 && header->count_anims > 0)
     {
-        free((s64Transform*)mdl->anims[0].keyframes[0].framedata);
-        free((s64KeyFrame*)mdl->anims[0].keyframes);
-        free((s64Animation*)mdl->anims);
+        stream = (s64AnimStream*)s64arena_take(&arena, sizeof(s64AnimStream));
+        stream->pool = (u8*)s64arena_take(&arena, ps->streamslotsize*s64_animslots);
+        stream->slotanim = (u16*)s64arena_take(&arena, sizeof(u16)*s64_animslots);
+        stream->slotused = (u32*)s64arena_take(&arena, sizeof(u32)*s64_animslots);
+        stream->animslot = (u16*)s64arena_take(&arena, sizeof(u16)*header->count_anims);
+        stream->kfoffsets = (u32*)s64arena_take(&arena, sizeof(u32)*header->count_anims);
+        #ifndef LIBDRAGON
+            stream->romstart = romstart;
+        #else
+            stream->filepath = (char*)s64arena_take(&arena, strlen(filepath)+1);
+            strcpy(stream->filepath, filepath);
+        #endif
+        stream->slotcount = s64_animslots;
+        stream->slotsize = ps->streamslotsize;
+        stream->kfsize = kfsize;
+        stream->usecount = 0;
+        for (i=0; i<s64_animslots; i++)
+        {
+            stream->slotanim[i] = 0xFFFF;
+            stream->slotused[i] = 0;
+        }
     }
-    free(mdl);
+    ps->stream = stream;
+    ps->kflookup = (u16*)s64arena_take(&arena, sizeof(u16)*ps->mallocsize_kflookup);
+    ps->meshorder = (u16*)s64arena_take(&arena, sizeof(u16)*ps->header.count_meshes*3);
+    return TRUE;
 }
 
 
-/*********************************
-       Sausage64 Functions
-*********************************/
-
 /*==============================
-    sausage64_inithelper
-    Allocate a new model helper struct
-    @param  The model data
-    @return A newly allocated model helper, or
-            NULL if it failed to allocate
+    sausage64_parse_material
+    Builds one material of a binary model. In Libultra,
+    this relocates its display list, in Libdragon, this
+    uploads its texture
+    @param  The parsing state
+    @param  The material to build
 ==============================*/
 
-s64ModelHelper* sausage64_inithelper(s64ModelData* mdldata)
+static void sausage64_parse_material(s64ParseState* ps, u32 i)
 {
-    // Start by allocating a model helper struct
-    s64ModelHelper* mdl = (s64ModelHelper*)malloc(sizeof(s64ModelHelper));
-    if (mdl == NULL)
-        return NULL;
-
-    // Initialize the newly allocated structure
-    mdl->interpolate = TRUE;
-    mdl->loop = TRUE;
-    mdl->rendercount = 1;
-    mdl->predraw = NULL;
-    mdl->postdraw = NULL;
-    mdl->animcallback = NULL;
-    mdl->mdldata = mdldata;
-
-    // Set the the first animation if it exists, otherwise set the animation to NULL
-    if (mdldata->animcount > 0)
-        mdl->curanim.animdata = &mdldata->anims[0];
-    else
-        mdl->curanim.animdata = NULL;
-    mdl->curanim.curtick = 0;
-    mdl->curanim.curkeyframe = 0;
-    
-    // No animation to blend with at initialization
-    mdl->blendanim.animdata = NULL;
-    mdl->blendanim.curtick = 0;
-    mdl->blendanim.curkeyframe = 0;
-    mdl->blendticks = 0;
-    mdl->blendticks_left = 0;
-
-    // Allocate space for the transform helper
-    mdl->transforms = (s64FrameTransform*)calloc(sizeof(s64FrameTransform)*mdldata->meshcount, 1);
-    if (mdl->transforms == NULL)
-    {
-        free(mdl);
-        return NULL;
-    }
-
-    // Allocate space for the model matrices in Libultra
+    u8* data = ps->data;
     #ifndef LIBDRAGON
-        mdl->matrix = (Mtx*)malloc(sizeof(Mtx)*1); // TODO: Handle frame buffering properly. Will require a better API
-        if (mdl->matrix == NULL)
+        // Material display lists need to exist before the meshes that call them are patched
+        if (ps->header.flags & BINFLAG_MATDLISTS)
         {
-            free(mdl->transforms);
-            free(mdl);
-            return NULL;
+            u8* matblock = &data[ps->toc_mats[i].material_offset];
+            u32 slotcount = *((u32*)matblock);
+            u32 gfxsize = sizeof(Gfx)*slotcount;
+            ps->matlists[i] = &ps->matgfx[ps->offset_matgfx];
+            memcpy(ps->matlists[i], matblock + sizeof(u32), gfxsize);
+            sausage64_relocdlist(ps->matlists[i], (u32*)(matblock + sizeof(u32) + gfxsize), (ps->toc_mats[i].material_size - sizeof(u32) - gfxsize)/sizeof(u32), NULL, ps->textures, NULL);
+            ps->offset_matgfx += slotcount;
+        }
+    #else
+        s64Material* mat = &ps->mats[i];
+        mat->type = ps->matdatas[i].type;
+        mat->lighting = ps->matdatas[i].lighting;
+        mat->cullfront = ps->matdatas[i].cullfront;
+        mat->cullback = ps->matdatas[i].cullback;
+        mat->smooth = ps->matdatas[i].smooth;
+        mat->depthtest = ps->matdatas[i].depthtest;
+        switch (mat->type)
+        {
+            case TYPE_TEXTURE:
+            {
+                s64Texture* tex = &ps->texes[ps->offset_texes];
+                mat->data = tex;
+                ps->texids[ps->offset_texes] = 0xFFFFFFFF;
+                tex->identifier = &ps->texids[ps->offset_texes];
+                tex->w = *(u32*)&data[ps->toc_mats[i].material_offset + 0];
+                tex->h = *(u32*)&data[ps->toc_mats[i].material_offset + 4];
+                tex->filter = *(u32*)&data[ps->toc_mats[i].material_offset + 8];
+                tex->wraps = *(u16*)&data[ps->toc_mats[i].material_offset + 12];
+                tex->wrapt = *(u16*)&data[ps->toc_mats[i].material_offset + 14];
+                sausage64_load_texture(tex, ps->textures[ps->offset_texes]);
+                ps->offset_texes++;
+                break;
+            }
+            case TYPE_PRIMCOL:
+            {
+                s64PrimColor* col = &ps->primcols[ps->offset_primcols];
+                mat->data = col;
+                col->r = data[ps->toc_mats[i].material_offset + 0];
+                col->g = data[ps->toc_mats[i].material_offset + 1];
+                col->b = data[ps->toc_mats[i].material_offset + 2];
+                col->a = data[ps->toc_mats[i].material_offset + 3];
+                ps->offset_primcols++;
+                break;
+            }
+            default: break;
         }
     #endif
-    return mdl;
 }
 
 
 /*==============================
-    sausage64_set_predrawfunc
-    Set a function that gets called before any mesh is rendered
-    @param The model helper pointer
-    @param The pre draw function
+    sausage64_parse_mesh
+    Builds one mesh of a binary model. In Libultra, this
+    relocates or generates its display list
+    @param  The parsing state
+    @param  The mesh to build
 ==============================*/
 
-inline void sausage64_set_predrawfunc(s64ModelHelper* mdl, u8 (*predraw)(u16))
+static void sausage64_parse_mesh(s64ParseState* ps, u32 i)
 {
-    mdl->predraw = predraw;
-}
+    u8* data = ps->data;
+    const BinFile_TOC_Meshes* toc_mesh = &ps->toc_meshes[i];
+    const BinFile_MeshData* meshdata = &ps->meshdatas[i];
+    s64Mesh* mesh = &ps->meshes[i];
+    #ifndef LIBDRAGON
+        Vtx* meshverts;
+    #else
+        f32* meshverts;
+        u16* meshfaces;
+        const u32 vertsize = (ps->header.flags & BINFLAG_PACKEDVERTS) ? sizeof(s64PackedVert) : sizeof(f32)*11;
+    #endif
 
+    // Copy the s64Mesh
+    *(u32*)&mesh->is_billboard = meshdata->is_billboard;
+    *(s32*)&mesh->parent = meshdata->parent;
+    mesh->name = ps->strings+ps->offset_strings;
+    strcpy(ps->strings+ps->offset_strings, meshdata->name);
+    memcpy((f32*)mesh->bounds, meshdata->bounds, sizeof(mesh->bounds));
+    mesh->dl = &ps->dlists[ps->offset_gfx];
+    *(u32*)&mesh->lodcount = 0;
+    mesh->lods = NULL;
 
-/*==============================
-    sausage64_set_postdrawfunc
-    Set a function that gets called after any mesh is rendered
-    @param The model helper pointer
-    @param The post draw function
-==============================*/
+    #ifndef LIBDRAGON
+        // Use the vertex data where it sits in the file if it's aligned, otherwise copy it
+        if (ps->inplace && toc_mesh->vertdata_offset % BINARY_VTXALIGN == 0)
+        {
+            meshverts = (Vtx*)&data[toc_mesh->vertdata_offset];
+            ps->keepdata = TRUE;
+        }
+        else
+        {
+            meshverts = &ps->verts[ps->offset_verts];
+            memcpy(meshverts, &data[toc_mesh->vertdata_offset], toc_mesh->vertdata_size);
+            ps->offset_verts += toc_mesh->vertdata_size/sizeof(Vtx);
+        }
 
-inline void sausage64_set_postdrawfunc(s64ModelHelper* mdl, void (*postdraw)(u16))
-{
-    mdl->postdraw = postdraw;
-}
+        // Display lists pre-assembled by Arabiki64 just need their pointers patched, and can be used in place if aligned
+        if (ps->header.flags & BINFLAG_GFXDLISTS)
+        {
+            Gfx* meshdl;
+            u32 gfxsize = sizeof(Gfx)*toc_mesh->dldata_slotcount;
+            if (ps->inplace && toc_mesh->dldata_offset % sizeof(Gfx) == 0)
+            {
+                meshdl = (Gfx*)&data[toc_mesh->dldata_offset];
+                ps->keepdata = TRUE;
+            }
+            else
+            {
+                meshdl = &ps->dlists[ps->offset_gfx];
+                memcpy(meshdl, &data[toc_mesh->dldata_offset], gfxsize);
+                ps->offset_gfx += toc_mesh->dldata_slotcount;
+            }
+            sausage64_relocdlist(meshdl, (u32*)&data[toc_mesh->dldata_offset + gfxsize], (toc_mesh->dldata_size - gfxsize)/sizeof(u32), meshverts, ps->textures, ps->matlists);
+            mesh->dl = meshdl;
 
+            // The LODs are stored after the full detail display list, so just point to where each one starts
+            if (meshdata->lodcount > 0)
+            {
+                int j;
+                *(u32*)&mesh->lodcount = meshdata->lodcount;
+                mesh->lods = &ps->lodlists[ps->offset_lods];
+                for (j=0; j<meshdata->lodcount; j++)
+                {
+                    u32 start;
+                    memcpy(&start, &meshdata->lodstarts[j*sizeof(u32)], sizeof(u32));
+                    ps->lodlists[ps->offset_lods++] = &meshdl[start];
+                }
+            }
+        }
+        else
+        {
+            sausage64_gendlist((u32*)(&data[toc_mesh->dldata_offset]), &ps->dlists[ps->offset_gfx], meshverts, ps->textures);
+            ps->offset_gfx += toc_mesh->dldata_slotcount;
+        }
+    #else
+        // Use the vertex and face data where it sits in the file if it's aligned, otherwise copy it
+        if (ps->inplace && toc_mesh->vertdata_offset % BINARY_VTXALIGN == 0)
+        {
+            meshverts = (f32*)&data[toc_mesh->vertdata_offset];
+            ps->keepdata = TRUE;
+        }
+        else
+        {
+            meshverts = &ps->verts[ps->offset_verts];
+            memcpy(meshverts, &data[toc_mesh->vertdata_offset], toc_mesh->vertdata_size);
+            ps->offset_verts += toc_mesh->vertdata_size/(sizeof(f32));
+        }
+        if (ps->inplace && toc_mesh->facedata_offset % sizeof(u16) == 0)
+        {
+            meshfaces = (u16*)&data[toc_mesh->facedata_offset];
+            ps->keepdata = TRUE;
+        }
+        else
+        {
+            meshfaces = &ps->faces[ps->offset_faces];
+            memcpy(meshfaces, &data[toc_mesh->facedata_offset], toc_mesh->facedata_size);
+            ps->offset_faces += toc_mesh->facedata_size/(sizeof(u16));
+        }
 
-/*==============================
-    sausage64_set_animcallback
-    Set a function that gets called when an animation finishes
-    @param The model helper pointer
-    @param The animation end callback function
-==============================*/
+        // Copy the s64Gfx data
+        ps->dlists[ps->offset_gfx].blockcount = toc_mesh->dldata_slotcount;
+        ps->dlists[ps->offset_gfx].guid_mdl = 0xFFFFFFFF;
+        ps->dlists[ps->offset_gfx].guid_verts = 0xFFFFFFFF;
+        ps->dlists[ps->offset_gfx].guid_faces = 0xFFFFFFFF;
+        ps->dlists[ps->offset_gfx].renders = &ps->rbs[ps->offset_rbs];
+        ps->dlists[ps->offset_gfx].packed = ((ps->header.flags & BINFLAG_PACKEDVERTS) != 0);
+        mesh->dl = &ps->dlists[ps->offset_gfx];
+
+        // Copy the render block data
+        for (int j=0; j<toc_mesh->dldata_slotcount; j++)
+        {
+            int curoffset = toc_mesh->dldata_offset + j*0xC;
+            int matid = *((u32*)&data[curoffset + 2*sizeof(u32)]);
+            s64RenderBlock* rb = &ps->rbs[ps->offset_rbs + j];
+            rb->vertcount = *((u16*)&data[curoffset + 0*sizeof(u16)]);
+            rb->verts     = (f32(*)[11])(((u8*)meshverts) + (*((u16*)&data[curoffset + 1*sizeof(u16)]))*vertsize);
+            rb->facecount = *((u16*)&data[curoffset + 2*sizeof(u16)]);
+            rb->faces     = (u16(*)[3])(meshfaces + (*((u16*)&data[curoffset + 3*sizeof(u16)]))*3);
+            if (matid == -1)
+                rb->material = NULL;
+            else
+                rb->material = &ps->mats[matid];
+        }
 
-inline void sausage64_set_animcallback(s64ModelHelper* mdl, void (*animcallback)(u16))
-{
-    mdl->animcallback = animcallback;
+        ps->offset_rbs += toc_mesh->dldata_slotcount;
+        ps->offset_gfx += 1;
+    #endif
+    ps->offset_strings += strlen(mesh->name)+1;
 }
 
 
-#ifndef LIBDRAGON
-    
-    /*==============================
-        sausage64_set_camera
-        Sets the camera for Sausage64 to use for billboarding
-        @param The view matrix
-        @param The projection matrix
-    ==============================*/
+/*==============================
+    sausage64_parse_anim
+    Builds one animation of a binary model, including its
+    keyframe lookup table
+    @param  The parsing state
+    @param  The animation to build
+==============================*/
 
-    void sausage64_set_camera(Mtx* view, Mtx* projection)
+static void sausage64_parse_anim(s64ParseState* ps, u32 i)
+{
+    int j;
+    u8* kfdata;
+    const BinFile_AnimData* animdata = &ps->animdatas[i];
+    const u16 meshcount = ps->header.count_meshes;
+    s64Animation* anim = &ps->anims[i];
+    s64KeyFrame* keyframes = &ps->keyframes[ps->offset_keyframes];
+
+    // Copy the s64Animation
+    anim->name = ps->strings+ps->offset_strings;
+    strcpy(ps->strings+ps->offset_strings, animdata->name);
+    *(u32*)&anim->keyframecount = animdata->kfcount;
+    *(u32*)&anim->baked = animdata->baked;
+    anim->keyframes = keyframes;
+    memcpy((f32*)anim->bounds, animdata->bounds, sizeof(anim->bounds));
+
+    // Use the s64Transforms (or s64QTransforms) where they sit in the file if they're aligned, otherwise copy them
+    // If the animations are being streamed, then they'll get loaded when they're first played
+    if (ps->stream != NULL)
     {
-        guMtxL2F(s64_viewmat, view);
-        guMtxL2F(s64_projmat, projection);
+        ps->stream->animslot[i] = 0xFFFF;
+        ps->stream->kfoffsets[i] = ps->toc_anims[i].kfdata_offset;
+        kfdata = NULL;
     }
-#else
-    
-    /*==============================
-        sausage64_set_camera
-        Sets the camera for Sausage64 to use for billboarding
-        @param The location of the camera, relative to the model's root
-    ==============================*/
-
-    void sausage64_set_camera(f32 campos[3])
+    else if (ps->toc_anims[i].kfdata_offset % ps->kfalign == 0)
     {
-        s64_campos[0] = campos[0];
-        s64_campos[1] = campos[1];
-        s64_campos[2] = campos[2];
+        kfdata = &ps->data[ps->toc_anims[i].kfdata_offset];
+        ps->keepdata = TRUE;
+    }
+    else
+    {
+        kfdata = &ps->kfblock[ps->offset_transforms*ps->kfsize];
+        memcpy(kfdata, &ps->data[ps->toc_anims[i].kfdata_offset], ps->kfsize*meshcount*animdata->kfcount);
+        ps->offset_transforms += meshcount*animdata->kfcount;
     }
-#endif
-
 
-/*==============================
-    sausage64_update_animplay
-    Updates the animation keyframe based on the animation 
-    tick
-    @param The animplay pointer
-==============================*/
-
-static void sausage64_update_animplay(s64AnimPlay* playing)
-{
-    const s64Animation* anim = playing->animdata;
-    const f32 curtick = playing->curtick;
-    u32 curkf_index = playing->curkeyframe;
-    u32 nextkf_index = (curkf_index+1)%(anim->keyframecount);
-    const u32 curkf_value = anim->keyframes[curkf_index].framenumber;
-    
-    // Check if we changed animation frame
-    if (curtick < curkf_value || curtick >= anim->keyframes[nextkf_index].framenumber)
+    // Copy the s64KeyFrame
+    for (j=0; j<animdata->kfcount; j++)
     {
-        int advance = 1;
-        if (curtick < curkf_value)
-            advance = -1;
-            
-        // Cycle through all remaining, starting at the one after the current frame
-        do
+        *(u32*)&keyframes[j].framenumber = animdata->kfindices[j];
+        if (kfdata == NULL)
         {
-            curkf_index += advance;
-            nextkf_index += advance;
-            if (curtick >= anim->keyframes[curkf_index].framenumber && curtick < anim->keyframes[nextkf_index].framenumber)
-            {
-                playing->curkeyframe = curkf_index;
-                return;
-            }
+            keyframes[j].framedata = NULL;
+            keyframes[j].qframedata = NULL;
         }
-        while (1);
-    }
-}
-
-
-/*==============================
-    sausage64_advance_animplay
-    Advances the animation player after a tick has occurred
-    @param The model helper pointer
-    @param The amount to increase the animation tick by
-==============================*/
-
-static void sausage64_advance_animplay(s64ModelHelper* mdl, s64AnimPlay* playing, f32 tickamount)
-{
-    int rollover = 0;
-    const int animlength = playing->animdata->keyframes[playing->animdata->keyframecount-1].framenumber;
-    playing->curtick += tickamount;
-    
-    // Check for rollover
-    if (playing->curtick >= animlength)
-        rollover = 1;
-    else if (playing->curtick <= 0)
-        rollover = -1;
-    
-    // If the animation ended, call the callback function and roll the tick value over
-    if (rollover)
-    {
-        f32 division;
-    
-        // Execute the animation end callback function
-        if (mdl->animcallback != NULL)
-            mdl->animcallback(playing->animdata - &mdl->mdldata->anims[0]);
-        
-        // If looping is disabled, then stop
-        if (!mdl->loop)
+        else if (ps->header.flags & BINFLAG_QUANTIZEDANIMS)
         {
-            if (rollover > 0)
-            {
-                playing->curtick = (f32)animlength;
-                playing->curkeyframe = playing->animdata->keyframecount-1;
-            }
-            else
-            {
-                playing->curtick = 0;
-                playing->curkeyframe = 0;
-            }
-            return;
+            keyframes[j].framedata = NULL;
+            keyframes[j].qframedata = &((s64QTransform*)kfdata)[j*meshcount];
         }
-        
-        // Calculate the correct tick
-        division = playing->curtick/((f32)animlength);
-        if (rollover > 0)
-            playing->curtick = (division - ((int)division))*((f32)animlength);
         else
-            playing->curtick = (1+(division - ((int)division)))*((f32)animlength);
+        {
+            keyframes[j].framedata = &((s64Transform*)kfdata)[j*meshcount];
+            keyframes[j].qframedata = NULL;
+        }
     }
 
-    // Update the animation
-    if (playing->animdata->keyframecount > 0)
-        sausage64_update_animplay(playing);
+    // Generate the keyframe lookup table. Baked animations have a keyframe on every tick, so they don't need one
+    if (animdata->kfcount > 0 && !animdata->baked)
+    {
+        anim->kflookup = &ps->kflookup[ps->offset_kflookup];
+        sausage64_build_kflookup(&ps->kflookup[ps->offset_kflookup], animdata->kfindices, animdata->kfcount);
+        ps->offset_kflookup += animdata->kfindices[animdata->kfcount-1]+1;
+    }
+    else
+        anim->kflookup = NULL;
+
+    // Increment pointers
+    ps->offset_strings += strlen(anim->name)+1;
+    ps->offset_keyframes += animdata->kfcount;
 }
 
 
 /*==============================
-    sausage64_advance_anim
-    Advances the animation tick by the given amount
-    @param The model helper pointer
-    @param The amount to increase the animation tick by
+    sausage64_parse_end
+    Fills in the model data struct once every part of the
+    binary model has been built, and frees the file data
+    if the model isn't using it in place
+    @param  The parsing state
+    @return The newly allocated model
 ==============================*/
 
-void sausage64_advance_anim(s64ModelHelper* mdl, f32 tickamount)
-{    
-    sausage64_advance_animplay(mdl, &mdl->curanim, tickamount);
-    if (mdl->blendticks_left > 0)
+static s64ModelData* sausage64_parse_end(s64ParseState* ps)
+{
+    s64ModelData* mdl = ps->mdl;
+
+    // Populate the model data struct
+    *(u16*)&mdl->meshcount = ps->header.count_meshes;
+    *(u16*)&mdl->animcount = ps->header.count_anims;
+    mdl->meshes = ps->meshes;
+    mdl->anims = ps->anims;
+    mdl->_qposscale = ps->header.posscale;
+    mdl->_filedata = ps->keepdata ? ps->data : NULL;
+    mdl->_animstream = ps->stream;
+    mdl->_memsize = ps->arenasize;
+    mdl->_posecache = NULL;
+    mdl->_meshorder = NULL;
+    if (mdl->meshcount > 0)
     {
-        mdl->blendticks_left -= tickamount;
-        if (mdl->blendticks_left > 0)
-            sausage64_advance_animplay(mdl, &mdl->blendanim, tickamount);
+        sausage64_build_hierarchy(mdl, ps->meshorder);
+        mdl->_meshorder = ps->meshorder;
     }
+    #ifndef LIBDRAGON
+        mdl->_vtxcleanup = ps->verts;
+        mdl->_instancedls = NULL;
+        mdl->_matdls = (ps->mallocsize_matgfx > 0) ? ps->matgfx : NULL;
+        mdl->_matdlslots = ps->mallocsize_matgfx;
+    #else
+        mdl->_matscleanup = ps->mats;
+        mdl->_matscount = ps->header.count_materials;
+    #endif
+
+    // Finish by cleaning up memory we used temporarily and returning the model data pointer
+    // The file data is kept around if the model is using parts of it in place
+    s64free(ps->scratch);
+    if (!ps->keepdata)
+    {
+        s64free(ps->data);
+    }
+    return mdl;
 }
 
 
 /*==============================
-    sausage64_set_anim
-    Sets an animation on the model. Does not perform 
-    error checking if an invalid animation is given.
-    @param The model helper pointer
-    @param The ANIMATION_* macro to set
+    sausage64_load_need
+    Works out how much of the file has to be loaded before
+    the next step of building a model can run
+    @param  The loading state
+    @return The number of bytes from the start of the file
 ==============================*/
 
-void sausage64_set_anim(s64ModelHelper* mdl, u16 anim)
+static u32 sausage64_load_need(s64LoadState* state)
 {
-    const s64Animation* animdata = &mdl->mdldata->anims[anim];
-    s64AnimPlay* const playing = &mdl->curanim;
-    playing->animdata = animdata;
-    playing->curkeyframe = 0;
-    playing->curtick = 0;
-    mdl->blendticks_left = 0;
-    mdl->blendticks = 0;
-    if (animdata->keyframecount > 0)
-        sausage64_update_animplay(&mdl->curanim);
+    u32 end, need = 0;
+    s64ParseState* ps = state->_parse;
+    const u32 i = ps->step;
+    switch (ps->stage)
+    {
+        case LOADSTAGE_HEADER:
+            need = BINARY_HEADERSIZE;
+            break;
+        case LOADSTAGE_MESHTABLE:
+            if (i < ps->header.count_meshes)
+            {
+                // The table entry has to arrive before we know where the data it points to is
+                need = ps->header.offset_meshes + BINARY_MESHTOCSIZE*(i+1);
+                if (state->loaded >= need)
+                {
+                    const u32* toc = (u32*)&ps->data[ps->header.offset_meshes + BINARY_MESHTOCSIZE*i];
+                    end = toc[0] + toc[1];
+                    if (end > need)
+                        need = end;
+                }
+            }
+            break;
+        case LOADSTAGE_MATTABLE:
+            if (i < ps->header.count_materials)
+            {
+                need = ps->header.offset_materials + 0x10*(i+1);
+                if (state->loaded >= need)
+                {
+                    const u32* toc = (u32*)&ps->data[ps->header.offset_materials + 0x10*i];
+                    end = toc[0] + toc[1];
+                    if (end > need)
+                        need = end;
+                    end = toc[2] + toc[3];
+                    if (end > need)
+                        need = end;
+                }
+            }
+            break;
+        case LOADSTAGE_ANIMTABLE:
+            if (i < ps->header.count_anims)
+            {
+                need = ps->header.offset_anims + 0x10*(i+1);
+                if (state->loaded >= need)
+                {
+                    const u32* toc = (u32*)&ps->data[ps->header.offset_anims + 0x10*i];
+                    end = toc[0] + toc[1];
+                    if (end > need)
+                        need = end;
+                }
+            }
+            break;
+        case LOADSTAGE_MATERIALS:
+            if (i < ps->header.count_materials)
+                need = ps->toc_mats[i].material_offset + ps->toc_mats[i].material_size;
+            break;
+        case LOADSTAGE_MESHES:
+            if (i < ps->header.count_meshes)
+            {
+                need = ps->toc_meshes[i].vertdata_offset + ps->toc_meshes[i].vertdata_size;
+                end = ps->toc_meshes[i].dldata_offset + ps->toc_meshes[i].dldata_size;
+                if (end > need)
+                    need = end;
+                #ifdef LIBDRAGON
+                    end = ps->toc_meshes[i].facedata_offset + ps->toc_meshes[i].facedata_size;
+                    if (end > need)
+                        need = end;
+                #endif
+            }
+            break;
+        case LOADSTAGE_ANIMS:
+            if (i < ps->header.count_anims)
+            {
+                if (ps->stream == NULL)
+                    need = ps->toc_anims[i].kfdata_offset + ps->toc_anims[i].kfdata_size;
+            }
+            else // The file data might be freed once the model is finished, so it must be done loading
+                need = state->size;
+            break;
+        default:
+            break;
+    }
+    return need;
 }
 
 
 /*==============================
-    sausage64_set_anim_blend
-    Sets an animation on the model with blending. Does not perform 
-    error checking if an invalid animation is given.
-    @param The model helper pointer
-    @param The ANIMATION_* macro to set
-    @param The amount of ticks to blend the animation over
+    sausage64_load_read
+    Keeps reading a binary model into memory, and checks
+    whether enough of it has arrived for the next step
+    @param  The loading state
+    @param  How many bytes from the start of the file the
+            next step needs
+    @param  Whether to wait for those bytes to arrive
+    @return Whether the bytes have arrived
 ==============================*/
 
-void sausage64_set_anim_blend(s64ModelHelper* mdl, u16 anim, f32 ticks)
+static u8 sausage64_load_read(s64LoadState* state, u32 need, u8 block)
 {
-    if (mdl->curanim.animdata != NULL)
-        mdl->blendanim = mdl->curanim;
-    sausage64_set_anim(mdl, anim);
-    mdl->blendticks_left = ticks;
-    mdl->blendticks = ticks;
-}
+    // A broken file might point past its end, which would otherwise never finish loading
+    if (need > state->size)
+        need = state->size;
 
-
-#ifdef LIBDRAGON
-    /*==============================
-        sausage64_loadmaterial
-        Loads a material for libdragon rendering
-        @param The material to load
-    ==============================*/
-    
-    void sausage64_loadmaterial(s64Material* mat)
-    {
-        if (mat->type == TYPE_TEXTURE)
+    #ifndef LIBDRAGON
+        while (TRUE)
         {
-            s64Texture* tex = (s64Texture*)mat->data;
-            if (s64_lastmat == NULL || (s64_lastmat->type != TYPE_TEXTURE))
+            // Check if the last DMA finished, only waiting for it if the next step needs its data
+            if (state->pending > 0)
             {
-                const GLfloat diffuse[] = {1.0f, 1.0f, 1.0f, 1.0f};
-                glEnable(GL_TEXTURE_2D);
-                glEnable(GL_COLOR_MATERIAL);
-                glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
+                if (osRecvMesg(&state->msgq, &state->dmamsg, (block && state->loaded < need) ? OS_MESG_BLOCK : OS_MESG_NOBLOCK) == -1)
+                    break;
+                state->loaded += state->pending;
+                state->pending = 0;
             }
-            glBindTexture(GL_TEXTURE_2D, *tex->identifier);
-        }
-        else
-        {
-            s64PrimColor* col = (s64PrimColor*)mat->data;
-            if (s64_lastmat == NULL || (s64_lastmat->type != TYPE_PRIMCOL))
+
+            // Start the next one, so it runs while the CPU builds the parts that have already arrived
+            if (state->loaded < state->size)
             {
-                glDisable(GL_TEXTURE_2D);
-                glDisable(GL_COLOR_MATERIAL);
+                u32 readsize = state->size - state->loaded;
+
+                // Limit the size to prevent audio stutters, and end it on a data cache line,
+                // so the CPU never caches a line that the DMA hasn't finished writing to
+                if (readsize > 16384)
+                    readsize = 16384 - (OS_K0_TO_PHYSICAL(state->data + state->loaded) & 0xF);
+                state->pending = readsize;
+                osPiStartDma(&state->iomsg, OS_MESG_PRI_NORMAL, OS_READ, state->romstart+state->loaded, state->data+state->loaded, readsize, &state->msgq);
             }
-            const GLfloat diffuse[] = {(f32)col->r/255.0f, (f32)col->g/255.0f, (f32)col->b/255.0f, 1.0f};
-            glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
-        }
-
-        // Set other draw settings
-        if (s64_lastmat == NULL || (s64_lastmat->cullback != mat->cullback || s64_lastmat->cullfront != mat->cullfront))
-        {
-            glEnable(GL_CULL_FACE);
-            if (mat->cullfront && mat->cullback)
-                glCullFace(GL_FRONT_AND_BACK);
-            else if (mat->cullfront)
-                glCullFace(GL_FRONT);
-            else if (mat->cullback)
-                glCullFace(GL_BACK);
-            else
-                glDisable(GL_CULL_FACE);
-        }
-        if (s64_lastmat == NULL || s64_lastmat->lighting != mat->lighting)
-        {
-            if (mat->lighting)
-                glEnable(GL_LIGHTING);
-            else
-                glDisable(GL_LIGHTING);
+            if (!block || state->loaded >= need || state->pending == 0)
+                break;
         }
-        if (s64_lastmat == NULL || s64_lastmat->depthtest != mat->depthtest)
+    #else
+        // File reads don't run in the background, so only read one block at a time, and only when it's needed
+        if (state->loaded < need && !state->failed)
         {
-            if (mat->depthtest)
-                glEnable(GL_DEPTH_TEST);
+            u32 readsize = state->size - state->loaded;
+            if (readsize > 16384)
+                readsize = 16384;
+            if (fread(state->data+state->loaded, 1, readsize, state->fp) == readsize)
+                state->loaded += readsize;
             else
-                glDisable(GL_DEPTH_TEST);
+                state->failed = TRUE;
         }
-        if (s64_lastmat == NULL || s64_lastmat->smooth != mat->smooth)
+        if (state->loaded == state->size && state->fp != NULL)
         {
-            if (mat->smooth)
-                glShadeModel(GL_SMOOTH);
-            else
-                glShadeModel(GL_FLAT);
+            fclose(state->fp);
+            state->fp = NULL;
         }
-        s64_lastmat = mat;
-    }
-#endif
+    #endif
+    return (state->loaded >= need);
+}
 
 
 /*==============================
-    sausage64_calcanimlerp
-    Calculates the lerp value based on the current animation
-    @param  A pointer to the animation player to use
-    @return The lerp amount
+    sausage64_load_fail
+    Stops loading a binary model that is invalid, or that
+    there isn't enough memory for
+    @param  The loading state
 ==============================*/
 
-static f32 sausage64_calcanimlerp(const s64AnimPlay* playing)
+static void sausage64_load_fail(s64LoadState* state)
 {
-    const s64Animation* anim = playing->animdata;
-    const s64KeyFrame* ckframe = &anim->keyframes[playing->curkeyframe];
-    const s64KeyFrame* nkframe = &anim->keyframes[(playing->curkeyframe+1)%anim->keyframecount];
-
-    // Prevent division by zero when calculating the lerp amount
-    if (nkframe->framenumber - ckframe->framenumber != 0)
-        return ((f32)(playing->curtick - ckframe->framenumber))/((f32)(nkframe->framenumber - ckframe->framenumber));
-    return 0;
+    s64ParseState* ps = state->_parse;
+    #ifndef LIBDRAGON
+        // The DMA has to finish before the memory it's writing to can be freed
+        if (state->pending > 0)
+            osRecvMesg(&state->msgq, &state->dmamsg, OS_MESG_BLOCK);
+        state->pending = 0;
+    #else
+        if (state->fp != NULL)
+        {
+            fclose(state->fp);
+            state->fp = NULL;
+        }
+    #endif
+    if (ps->scratch != NULL)
+        s64free(ps->scratch);
+    s64free(state->data);
+    ps->stage = LOADSTAGE_DONE;
 }
 
 
 /*==============================
-    sausage64_calcanimtransforms
-    Calculates the transform of a mesh based on the animation
-    @param A pointer to the model helper to use
-    @param The mesh to calculate the transforms of
-    @param The lerp amount
-    @param The lerp amount for the animation blending
+    sausage64_load_advance
+    Continues loading a binary model, one step at a time:
+    reading its header and every table entry, then building
+    its materials, meshes and animations one by one. Each
+    step starts as soon as the part of the file it needs
+    has arrived, while the rest is still being read
+    @param  The loading state
+    @param  The maximum number of microseconds to spend
+    @param  Whether to wait for DMA to finish
+    @return Whether the model has finished loading
 ==============================*/
 
-static void sausage64_calcanimtransforms(s64ModelHelper* mdl, const u16 mesh, f32 l, f32 bl)
+static u8 sausage64_load_advance(s64LoadState* state, u32 budget, u8 block)
 {
-    const s64AnimPlay* playing = &mdl->curanim;
-    
-    // Prevent these calculations from being performed again
-    if (mdl->transforms[mesh].rendercount == mdl->rendercount)
-        return;
-    mdl->transforms[mesh].rendercount = mdl->rendercount;
+    s64ParseState* ps = state->_parse;
+    #ifndef LIBDRAGON
+        const OSTime start = osGetTime();
+    #else
+        const u64 start = get_ticks_us();
+    #endif
 
-    // Calculate current animation transforms
-    if (playing->animdata != NULL)
-    {    
-        const s64Animation* curanim = playing->animdata;
-        s64Transform* fdata = &mdl->transforms[mesh].data;
-        const s64Transform* cfdata = &curanim->keyframes[playing->curkeyframe].framedata[mesh];
-        
-        // Calculate animation lerp
-        if (mdl->interpolate)
+    // The budget is checked before every step, so no step is started once it has run out
+    #ifndef LIBDRAGON
+        while (ps->stage != LOADSTAGE_DONE && OS_CYCLES_TO_USEC(osGetTime() - start) < budget)
+    #else
+        while (ps->stage != LOADSTAGE_DONE && get_ticks_us() - start < budget)
+    #endif
+    {
+        // Keep the file streaming in, and make sure the part the next step needs is here
+        if (!sausage64_load_read(state, sausage64_load_need(state), block))
         {
-            const s64Transform* nfdata = &curanim->keyframes[(playing->curkeyframe+1)%curanim->keyframecount].framedata[mesh];
-            
+            #ifndef LIBDRAGON
+                return FALSE;
+            #else
+                if (state->failed)
+                    sausage64_load_fail(state);
+                continue;
+            #endif
+        }
+        switch (ps->stage)
+        {
+            case LOADSTAGE_HEADER:
+                if (!sausage64_parse_header(ps, state->data, state->textures))
+                {
+                    sausage64_load_fail(state);
+                    break;
+                }
+                ps->stage = LOADSTAGE_MESHTABLE;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_MESHTABLE:
+                if (ps->step < ps->header.count_meshes)
+                {
+                    sausage64_parse_meshtable(ps, ps->step++);
+                    break;
+                }
+                ps->stage = LOADSTAGE_MATTABLE;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_MATTABLE:
+                if (ps->step < ps->header.count_materials)
+                {
+                    sausage64_parse_mattable(ps, ps->step++);
+                    break;
+                }
+                ps->stage = LOADSTAGE_ANIMTABLE;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_ANIMTABLE:
+                if (ps->step < ps->header.count_anims)
+                {
+                    sausage64_parse_animtable(ps, ps->step++);
+                    break;
+                }
+                ps->stage = LOADSTAGE_ALLOC;
+                break;
+            case LOADSTAGE_ALLOC:
+                #ifndef LIBDRAGON
+                    if (!sausage64_parse_alloc(ps, state->romstart))
+                #else
+                    if (!sausage64_parse_alloc(ps, state->filepath))
+                #endif
+                {
+                    sausage64_load_fail(state);
+                    break;
+                }
+                ps->stage = LOADSTAGE_MATERIALS;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_MATERIALS:
+                if (ps->step < ps->header.count_materials)
+                {
+                    sausage64_parse_material(ps, ps->step++);
+                    break;
+                }
+                ps->stage = LOADSTAGE_MESHES;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_MESHES:
+                if (ps->step < ps->header.count_meshes)
+                {
+                    sausage64_parse_mesh(ps, ps->step++);
+                    break;
+                }
+                ps->stage = LOADSTAGE_ANIMS;
+                ps->step = 0;
+                break;
+            case LOADSTAGE_ANIMS:
+                if (ps->step < ps->header.count_anims)
+                {
+                    sausage64_parse_anim(ps, ps->step++);
+                    break;
+                }
+                state->model = sausage64_parse_end(ps);
+                #ifndef LIBDRAGON
+                    ps->stage = LOADSTAGE_DONE;
+                #else
+                    ps->stage = LOADSTAGE_UPLOAD;
+                    ps->step = 0;
+                #endif
+                break;
+            #ifdef LIBDRAGON
+                case LOADSTAGE_UPLOAD:
+                    if (ps->step < state->model->meshcount)
+                    {
+                        sausage64_load_staticmesh((s64Gfx*)state->model->meshes[ps->step++].dl);
+                        break;
+                    }
+                    ps->stage = LOADSTAGE_DONE;
+                    break;
+            #endif
+            default:
+                break;
+        }
+    }
+    return (ps->stage == LOADSTAGE_DONE);
+}
+
+
+/*==============================
+    sausage64_load_binarymodel_begin
+    Starts loading a binary model in the background.
+    Call sausage64_load_binarymodel_poll every frame
+    until it returns TRUE
+    @param  (Libultra) The starting address in ROM
+    @param  (Libdragon) The dfs file path of the asset.
+                        It is copied, so it doesn't need
+                        to outlive this call
+    @param  (Libultra) The size of the model
+    @param  (Libultra) The list of textures to use
+    @param  (Libdragon) The list of texture sprites
+    @return The loading state, or NULL if it failed
+==============================*/
+
+#ifndef LIBDRAGON
+s64LoadState* sausage64_load_binarymodel_begin(u32 romstart, u32 size, u32** textures)
+#else
+s64LoadState* sausage64_load_binarymodel_begin(char* filepath, sprite_t** textures)
+#endif
+{
+    u8* block;
+    s64LoadState* state;
+
+    // The loading state, the parsing state and (in Libdragon) the file path share one allocation
+    #ifndef LIBDRAGON
+        block = (u8*)s64alloc(s64align(sizeof(s64LoadState)) + sizeof(s64ParseState));
+    #else
+        block = (u8*)s64alloc(s64align(sizeof(s64LoadState)) + s64align(sizeof(s64ParseState)) + strlen(filepath)+1);
+    #endif
+    if (block == NULL)
+        return NULL;
+    state = (s64LoadState*)s64arena_take(&block, sizeof(s64LoadState));
+    state->_parse = (s64ParseState*)s64arena_take(&block, sizeof(s64ParseState));
+    state->_parse->stage = LOADSTAGE_HEADER;
+    state->_parse->step = 0;
+    state->_parse->scratch = NULL;
+    state->loaded = 0;
+    state->textures = textures;
+    state->model = NULL;
+    #ifndef LIBDRAGON
+        // Reserve some memory for the file we're about to read
+        state->romstart = romstart;
+        state->size = size;
+        state->pending = 0;
+        state->data = (u8*)s64alloc(size);
+        if (state->data == NULL)
+        {
+            s64free(state);
+            return NULL;
+        }
+
+        // Initialize the message queue and invalidate the data cache
+        osCreateMesgQueue(&state->msgq, &state->dmamsg, 1);
+        osInvalDCache((void*)state->data, size);
+    #else
+        int filesize;
+        state->failed = FALSE;
+        state->filepath = (char*)block;
+        strcpy(state->filepath, filepath);
+        state->fp = asset_fopen(filepath, &filesize);
+        if (state->fp == NULL)
+        {
+            s64free(state);
+            return NULL;
+        }
+        state->size = filesize;
+        state->data = (u8*)s64alloc(filesize);
+        if (state->data == NULL)
+        {
+            fclose(state->fp);
+            s64free(state);
+            return NULL;
+        }
+    #endif
+    return state;
+}
+
+
+/*==============================
+    sausage64_load_binarymodel_poll
+    Continues loading a binary model for, at most,
+    the given amount of time. Reading each table entry,
+    and building each material, mesh and animation, are
+    separate steps, and each one starts as soon as the
+    part of the file it needs has been read. A frame is
+    never held up by more than one of them past the budget
+    @param  The loading state
+    @param  The maximum number of microseconds to spend
+    @return Whether the model is ready to be finished
+==============================*/
+
+u8 sausage64_load_binarymodel_poll(s64LoadState* state, u32 budget)
+{
+    return sausage64_load_advance(state, budget, FALSE);
+}
+
+
+/*==============================
+    sausage64_load_binarymodel_finish
+    Finishes loading a binary model, doing whatever
+    steps are left without a time limit.
+    The loading state is freed
+    @param  The loading state
+    @return The newly allocated model, or NULL if
+            it failed
+==============================*/
+
+s64ModelData* sausage64_load_binarymodel_finish(s64LoadState* state)
+{
+    s64ModelData* mdl;
+    u32 size = state->size;
+
+    // Do whatever is left
+    while (!sausage64_load_advance(state, 0xFFFFFFFF, TRUE))
+        ;
+    mdl = state->model;
+    s64free(state);
+    if (mdl == NULL)
+        return NULL;
+
+    // Account for the file data if the model kept it around
+    if (mdl->_filedata != NULL)
+        mdl->_memsize += size;
+    S64_PROFILE_ADD(model_bytes, mdl->_memsize);
+    return mdl;
+}
+
+
+/*==============================
+    sausage64_load_binarymodel
+    Load a binary model from ROM
+    @param  (Libultra) The starting address in ROM
+    @param  (Libdragon) The dfs file path of the asset
+    @param  (Libultra) The size of the model
+    @param  (Libultra) The list of textures to use
+    @param  (Libdragon) The list of texture sprites
+    @return The newly allocated model
+==============================*/
+
+#ifndef LIBDRAGON
+s64ModelData* sausage64_load_binarymodel(u32 romstart, u32 size, u32** textures)
+#else
+s64ModelData* sausage64_load_binarymodel(char* filepath, sprite_t** textures)
+#endif
+{
+    #ifndef LIBDRAGON
+        s64LoadState* state = sausage64_load_binarymodel_begin(romstart, size, textures);
+    #else
+        s64LoadState* state = sausage64_load_binarymodel_begin(filepath, textures);
+    #endif
+    if (state == NULL)
+        return NULL;
+    return sausage64_load_binarymodel_finish(state);
+}
+
+
+/*==============================
+    sausage64_stream_read
+    Reads a block of a streamed model's file
+    @param  The animation stream
+    @param  The offset in the file to read from
+    @param  Where to read the data to
+    @param  The number of bytes to read
+==============================*/
+
+static void sausage64_stream_read(s64AnimStream* stream, u32 offset, u8* dest, u32 size)
+{
+    #ifndef LIBDRAGON
+        OSMesg   dmamsg;
+        OSIoMesg iomsg;
+        OSMesgQueue msgq;
+        u32 done = 0;
+        osCreateMesgQueue(&msgq, &dmamsg, 1);
+        osInvalDCache((void*)dest, size);
+        while (done < size)
+        {
+            u32 readsize = size - done;
+            
+            // Limit the size to prevent audio stutters
+            if (readsize > 16384)
+                readsize = 16384;
+            osPiStartDma(&iomsg, OS_MESG_PRI_NORMAL, OS_READ, stream->romstart+offset+done, dest+done, readsize, &msgq);
+            (void)osRecvMesg(&msgq, &dmamsg, OS_MESG_BLOCK);
+            done += readsize;
+        }
+    #else
+        int filesize;
+        FILE* fp = asset_fopen(stream->filepath, &filesize);
+        if (fp == NULL)
+            return;
+        fseek(fp, offset, SEEK_SET);
+        fread(dest, 1, size, fp);
+        fclose(fp);
+    #endif
+}
+
+
+/*==============================
+    sausage64_stream_pin
+    Stamps a resident streamed animation with a pin, so that
+    loading other animations with the same pin can't evict it
+    @param  The model data
+    @param  The animation to pin
+    @param  The pin value
+==============================*/
+
+static void sausage64_stream_pin(const s64ModelData* mdldata, const s64Animation* anim, u32 pin)
+{
+    u16 slot;
+    s64AnimStream* stream = mdldata->_animstream;
+    if (stream == NULL || anim->keyframecount == 0)
+        return;
+    slot = stream->animslot[anim - mdldata->anims];
+    if (slot != 0xFFFF)
+        stream->slotused[slot] = pin;
+}
+
+
+/*==============================
+    sausage64_stream_anim
+    Makes sure a streamed animation is in memory, loading
+    it over the least recently used one if it isn't.
+    Slots stamped with the given pin are never evicted
+    @param  The model data
+    @param  The animation to load
+    @param  The pin value, or 0 to take a new one
+    @return TRUE if the animation is in memory, FALSE if 
+            every slot is pinned
+==============================*/
+
+static u8 sausage64_stream_anim(const s64ModelData* mdldata, const s64Animation* anim, u32 pin)
+{
+    u32 i;
+    u16 slot;
+    s64KeyFrame* keyframes = (s64KeyFrame*)anim->keyframes;
+    s64AnimStream* stream = mdldata->_animstream;
+    const u16 animid = anim - mdldata->anims;
+    if (stream == NULL || anim->keyframecount == 0)
+        return TRUE;
+    if (pin == 0)
+        pin = ++stream->usecount;
+    
+    // If it's already loaded, just mark it as recently used
+    slot = stream->animslot[animid];
+    if (slot != 0xFFFF)
+    {
+        stream->slotused[slot] = pin;
+        return TRUE;
+    }
+    
+    // Find the least recently used slot that isn't pinned, and evict the animation in it
+    slot = 0xFFFF;
+    for (i=0; i<stream->slotcount; i++)
+        if (stream->slotused[i] < pin && (slot == 0xFFFF || stream->slotused[i] < stream->slotused[slot]))
+            slot = i;
+    if (slot == 0xFFFF)
+        return FALSE;
+    if (stream->slotanim[slot] != 0xFFFF)
+    {
+        const s64Animation* evicted = &mdldata->anims[stream->slotanim[slot]];
+        s64KeyFrame* evictedkfs = (s64KeyFrame*)evicted->keyframes;
+        for (i=0; i<evicted->keyframecount; i++)
+        {
+            evictedkfs[i].framedata = NULL;
+            evictedkfs[i].qframedata = NULL;
+        }
+        stream->animslot[stream->slotanim[slot]] = 0xFFFF;
+    }
+    
+    // Read the animation into the slot
+    sausage64_stream_read(stream, stream->kfoffsets[animid], &stream->pool[slot*stream->slotsize], stream->kfsize*anim->keyframecount*mdldata->meshcount);
+    stream->slotanim[slot] = animid;
+    stream->slotused[slot] = pin;
+    stream->animslot[animid] = slot;
+    for (i=0; i<anim->keyframecount; i++)
+    {
+        u8* kfdata = &stream->pool[slot*stream->slotsize + i*stream->kfsize*mdldata->meshcount];
+        if (stream->kfsize == sizeof(s64QTransform))
+            keyframes[i].qframedata = (s64QTransform*)kfdata;
+        else
+            keyframes[i].framedata = (s64Transform*)kfdata;
+    }
+    return TRUE;
+}
+
+
+/*==============================
+    sausage64_unload_binarymodel
+    Free the memory used by a dynamically loaded binary model
+    @param  The model to free
+==============================*/
+
+void sausage64_unload_binarymodel(s64ModelData* mdl)
+{
+    S64_PROFILE_SUB(model_bytes, mdl->_memsize);
+    
+    // Release the textures and display lists from OpenGL
+    #ifdef LIBDRAGON
+        int i;
+        for (i=0; i<mdl->_matscount; i++)
+            if (mdl->_matscleanup[i].type == TYPE_TEXTURE)
+                sausage64_unload_texture((s64Texture*)mdl->_matscleanup[i].data);
+        if (mdl->meshcount > 0)
+            sausage64_unload_staticmodel(mdl);
+    #else
+        if (mdl->_instancedls != NULL)
+            s64free(mdl->_instancedls);
+        
+        // A model loaded later could reuse this one's material display list addresses
+        sausage64_reset_rdpstate();
+    #endif
+    if (mdl->_posecache != NULL)
+        s64free(mdl->_posecache);
+    
+    // Free the file data, if the model was using it in place
+    if (mdl->_filedata != NULL)
+    {
+        s64free(mdl->_filedata);
+    }
+    
+    // Everything else was allocated in a single arena, which starts with the model data struct
+    s64free(mdl);
+}
+
+
+/*==============================
+    sausage64_get_animsavings
+    Get how many bytes of RAM were saved by loading
+    quantized animations instead of float ones
+    @param  The model to check
+    @return The number of bytes saved
+==============================*/
+
+u32 sausage64_get_animsavings(const s64ModelData* mdl)
+{
+    int i;
+    u32 count = 0;
+    if (mdl->_animstream != NULL)
+    {
+        if (mdl->_animstream->kfsize == sizeof(s64QTransform))
+            count = mdl->_animstream->slotsize*mdl->_animstream->slotcount/sizeof(s64QTransform);
+        return count*(sizeof(s64Transform) - sizeof(s64QTransform));
+    }
+    for (i=0; i<mdl->animcount; i++)
+        if (mdl->anims[i].keyframecount > 0 && mdl->anims[i].keyframes[0].qframedata != NULL)
+            count += mdl->anims[i].keyframecount*mdl->meshcount;
+    return count*(sizeof(s64Transform) - sizeof(s64QTransform));
+}
+
+
+/*==============================
+    sausage64_get_modelmemory
+    Get how many bytes of heap a binary model is holding,
+    including the file data it uses in place and the
+    instancing display lists (Libultra). OpenGL objects
+    are not counted (Libdragon)
+    @param  The model to check
+    @return The number of bytes used
+==============================*/
+
+u32 sausage64_get_modelmemory(const s64ModelData* mdl)
+{
+    return mdl->_memsize;
+}
+
+
+/*==============================
+    sausage64_set_posecache
+    Gives a model a cache of animation poses, so that helpers
+    playing the same animation at the same tick calculate it
+    only once. Only helpers which aren't blending or playing
+    layers use the cache
+    @param  The model to give the cache to
+    @param  The number of poses to remember, or 0 to remove
+            the cache
+    @param  The tick step to snap to before looking up a pose,
+            or 0 to only share exactly matching ticks
+    @return 1 if successful, 0 if the cache couldn't be allocated
+==============================*/
+
+u8 sausage64_set_posecache(s64ModelData* mdl, u16 count, f32 step)
+{
+    u16 i;
+    u8* arena;
+    u32 size;
+    s64PoseCache* cache;
+    const u16 mcount = mdl->meshcount;
+    
+    // Remove the old cache. Helpers still pointing to its entries will fail the ID check
+    if (mdl->_posecache != NULL)
+    {
+        mdl->_memsize -= mdl->_posecache->size;
+        S64_PROFILE_SUB(model_bytes, mdl->_posecache->size);
+        s64free(mdl->_posecache);
+        mdl->_posecache = NULL;
+    }
+    if (count == 0)
+        return TRUE;
+    
+    // Allocate the cache and all of its entries in one block
+    size = s64align(sizeof(s64PoseCache)) + s64align(sizeof(s64PoseEntry)*count) + s64align(sizeof(s64FrameTransform)*mcount)*count;
+    #ifndef LIBDRAGON
+        size += (s64align(sizeof(Mtx)*mcount) + s64align(sizeof(u8)*mcount))*count;
+    #endif
+    arena = (u8*)s64alloc(size);
+    if (arena == NULL)
+        return FALSE;
+    cache = (s64PoseCache*)s64arena_take(&arena, sizeof(s64PoseCache));
+    cache->count = count;
+    cache->step = step;
+    cache->usecount = 0;
+    cache->size = size;
+    cache->entries = (s64PoseEntry*)s64arena_take(&arena, sizeof(s64PoseEntry)*count);
+    for (i=0; i<count; i++)
+    {
+        s64PoseEntry* entry = &cache->entries[i];
+        entry->anim = NULL;
+        entry->tick = 0;
+        entry->interpolate = FALSE;
+        entry->id = 0;
+        entry->lastused = 0;
+        entry->transforms = (s64FrameTransform*)s64arena_take(&arena, sizeof(s64FrameTransform)*mcount);
+        #ifndef LIBDRAGON
+            entry->matrix = (Mtx*)s64arena_take(&arena, sizeof(Mtx)*mcount);
+            entry->mtxvalid = (u8*)s64arena_take(&arena, sizeof(u8)*mcount);
+        #endif
+    }
+    mdl->_posecache = cache;
+    mdl->_memsize += size;
+    S64_PROFILE_ADD(model_bytes, size);
+    return TRUE;
+}
+
+
+/*********************************
+       Sausage64 Functions
+*********************************/
+
+/*==============================
+    sausage64_inithelper
+    Allocate a new model helper struct
+    @param  The model data
+    @return A newly allocated model helper, or
+            NULL if it failed to allocate
+==============================*/
+
+s64ModelHelper* sausage64_inithelper(s64ModelData* mdldata)
+{
+    // Start by allocating a model helper struct
+    s64ModelHelper* mdl = (s64ModelHelper*)s64alloc(sizeof(s64ModelHelper));
+    if (mdl == NULL)
+        return NULL;
+
+    // Initialize the newly allocated structure
+    mdl->interpolate = TRUE;
+    mdl->loop = TRUE;
+    mdl->rendercount = 1;
+    mdl->poserendercount = 0;
+    mdl->predraw = NULL;
+    mdl->postdraw = NULL;
+    mdl->animcallback = NULL;
+    mdl->mdldata = mdldata;
+
+    // Set the the first animation if it exists, otherwise set the animation to NULL
+    if (mdldata->animcount > 0)
+        mdl->curanim.animdata = &mdldata->anims[0];
+    else
+        mdl->curanim.animdata = NULL;
+    mdl->curanim.curtick = 0;
+    mdl->curanim.curkeyframe = 0;
+    
+    // No animation to blend with at initialization
+    mdl->blendanim.animdata = NULL;
+    mdl->blendanim.curtick = 0;
+    mdl->blendanim.curkeyframe = 0;
+    mdl->blendticks = 0;
+    mdl->blendticks_left = 0;
+    mdl->layers = NULL;
+    mdl->layercount = 0;
+    mdl->_poseentry = 0;
+    mdl->_poseid = 0;
+    
+    // Culling is off until a model matrix is given
+    #ifndef LIBDRAGON
+        mdl->cull = FALSE;
+        mdl->visible = TRUE;
+        mdl->lodsize = S64_LODSIZE;
+        mdl->absolute = FALSE;
+    #endif
+
+    // Allocate space for the transform helper
+    mdl->transforms = (s64FrameTransform*)s64alloc(sizeof(s64FrameTransform)*mdldata->meshcount);
+    if (mdl->transforms == NULL && mdldata->meshcount > 0)
+    {
+        s64free(mdl);
+        return NULL;
+    }
+    if (mdl->transforms != NULL)
+        memset(mdl->transforms, 0, sizeof(s64FrameTransform)*mdldata->meshcount);
+
+    // Binary models come with their mesh hierarchy, but helpers of static models need to build their own
+    mdl->meshorder = mdldata->_meshorder;
+    mdl->subtrees = NULL;
+    if (mdl->meshorder == NULL && mdldata->meshcount > 0)
+    {
+        mdl->meshorder = (u16*)s64alloc(sizeof(u16)*mdldata->meshcount*3);
+        if (mdl->meshorder == NULL)
+        {
+            s64free(mdl->transforms);
+            s64free(mdl);
+            return NULL;
+        }
+        sausage64_build_hierarchy(mdldata, mdl->meshorder);
+    }
+    if (mdl->meshorder != NULL)
+        mdl->subtrees = (u16(*)[2])&mdl->meshorder[mdldata->meshcount];
+
+    // Allocate space for the model matrices in Libultra
+    #ifndef LIBDRAGON
+        mdl->matrixframe = 0;
+        mdl->matrixdraw = 0;
+        mdl->matrixtick = s64_frame-1;
+        mdl->matrix = (Mtx*)s64alloc(sizeof(Mtx)*mdldata->meshcount*S64_MATRIXBUFFERS*S64_MATRIXDRAWS);
+        if (mdl->matrix == NULL && mdldata->meshcount > 0)
+        {
+            if (mdl->meshorder != mdldata->_meshorder)
+                s64free(mdl->meshorder);
+            s64free(mdl->transforms);
+            s64free(mdl);
+            return NULL;
+        }
+    #endif
+    S64_PROFILE_ADD(helper_bytes, sausage64_get_helpermemory(mdl));
+    return mdl;
+}
+
+
+/*==============================
+    sausage64_set_predrawfunc
+    Set a function that gets called before any mesh is rendered
+    @param The model helper pointer
+    @param The pre draw function
+==============================*/
+
+inline void sausage64_set_predrawfunc(s64ModelHelper* mdl, u8 (*predraw)(u16))
+{
+    mdl->predraw = predraw;
+}
+
+
+/*==============================
+    sausage64_set_postdrawfunc
+    Set a function that gets called after any mesh is rendered
+    @param The model helper pointer
+    @param The post draw function
+==============================*/
+
+inline void sausage64_set_postdrawfunc(s64ModelHelper* mdl, void (*postdraw)(u16))
+{
+    mdl->postdraw = postdraw;
+}
+
+
+/*==============================
+    sausage64_set_animcallback
+    Set a function that gets called when an animation finishes
+    @param The model helper pointer
+    @param The animation end callback function
+==============================*/
+
+inline void sausage64_set_animcallback(s64ModelHelper* mdl, void (*animcallback)(u16))
+{
+    mdl->animcallback = animcallback;
+}
+
+
+#ifndef LIBDRAGON
+    
+    /*==============================
+        sausage64_set_camera
+        Sets the camera for Sausage64 to use for billboarding
+        @param The view matrix
+        @param The projection matrix
+    ==============================*/
+
+    void sausage64_set_camera(Mtx* view, Mtx* projection)
+    {
+        guMtxL2F(s64_viewmat, view);
+        guMtxL2F(s64_projmat, projection);
+    }
+    
+    
+    /*==============================
+        sausage64_set_cullmatrix
+        Sets the matrix that the model will be drawn with, so
+        that the parts of it which are outside of the camera's
+        view can be skipped. Call it after sausage64_set_camera,
+        every time the camera or the model moves
+        @param The model helper pointer
+        @param The model matrix, or NULL to disable culling
+    ==============================*/
+    
+    void sausage64_set_cullmatrix(s64ModelHelper* mdl, Mtx* model)
+    {
+        int i;
+        f32 mvp[4][4];
+        if (model == NULL)
+        {
+            mdl->cull = FALSE;
+            return;
+        }
+        
+        // Combine the matrices, so that the frustum planes end up in model space
+        guMtxL2F(mvp, model);
+        guMtxCatF(mvp, s64_viewmat, mvp);
+        mdl->lodscale = sqrtf(mvp[0][0]*mvp[0][0] + mvp[0][1]*mvp[0][1] + mvp[0][2]*mvp[0][2])*s64_projmat[1][1];
+        guMtxCatF(mvp, s64_projmat, mvp);
+        
+        // The W column gives the distance to the camera, which is needed to pick the LODs
+        for (i=0; i<4; i++)
+            mdl->lodw[i] = mvp[i][3];
+        
+        // Each plane is the W column plus or minus the X, Y, or Z column
+        for (i=0; i<6; i++)
+        {
+            int j;
+            f32 len;
+            f32 sign = (i%2 == 0) ? 1.0f : -1.0f;
+            for (j=0; j<4; j++)
+                mdl->frustum[i][j] = mvp[j][3] + sign*mvp[j][i/2];
+            len = sqrtf(mdl->frustum[i][0]*mdl->frustum[i][0] + mdl->frustum[i][1]*mdl->frustum[i][1] + mdl->frustum[i][2]*mdl->frustum[i][2]);
+            if (len > 0)
+                for (j=0; j<4; j++)
+                    mdl->frustum[i][j] /= len;
+        }
+        mdl->cull = TRUE;
+    }
+    
+    
+    /*==============================
+        sausage64_set_lodsize
+        Sets how much of the screen's height a mesh must
+        cover before it gets drawn with its first LOD
+        @param The model helper pointer
+        @param The fraction of the screen height, or 0 to
+               always draw the full detail meshes
+    ==============================*/
+    
+    void sausage64_set_lodsize(s64ModelHelper* mdl, f32 size)
+    {
+        mdl->lodsize = size;
+    }
+    
+    
+    /*==============================
+        sausage64_set_modelview
+        Makes the model get drawn with matrices that already
+        contain the given model to view matrix
+        @param The model helper pointer
+        @param The model to view matrix, or NULL to go back to
+               multiplying with the matrix stack
+    ==============================*/
+    
+    void sausage64_set_modelview(s64ModelHelper* mdl, Mtx* modelview)
+    {
+        if (modelview == NULL)
+        {
+            mdl->absolute = FALSE;
+            return;
+        }
+        guMtxL2F(mdl->modelview, modelview);
+        mdl->absolute = TRUE;
+    }
+    
+    
+    /*==============================
+        sausage64_get_cullstats
+        Gets how many models and meshes were drawn and culled
+        since the last time the statistics were reset
+        @param The struct to fill with the statistics
+    ==============================*/
+    
+    void sausage64_get_cullstats(s64CullStats* stats)
+    {
+        *stats = s64_cullstats;
+    }
+    
+    
+    /*==============================
+        sausage64_reset_cullstats
+        Resets the culling statistics back to zero
+    ==============================*/
+    
+    void sausage64_reset_cullstats()
+    {
+        memset(&s64_cullstats, 0, sizeof(s64CullStats));
+    }
+    
+    
+    /*==============================
+        sausage64_reset_rdpstate
+        Forgets the render state that the material display
+        lists left behind, so that the next material is set
+        up in full
+    ==============================*/
+    
+    void sausage64_reset_rdpstate()
+    {
+        s64_rdpstate.material = 0;
+        s64_rdpstate.geovalid = FALSE;
+        s64_rdpstate.modecount = 0;
+        s64_rdpstate.texvalid = FALSE;
+    }
+    
+    
+    /*==============================
+        sausage64_next_frame
+        Moves every model helper onto the next set of
+        matrices. Call this once at the start of every
+        frame, before drawing any models
+    ==============================*/
+    
+    void sausage64_next_frame()
+    {
+        s64_frame++;
+        s64_frameset = (s64_frameset+1)%S64_MATRIXBUFFERS;
+        s64_framestarted = TRUE;
+    }
+#else
+    
+    /*==============================
+        sausage64_set_camera
+        Sets the camera for Sausage64 to use for billboarding,
+        and calculates the rotation of the billboards
+        @param The location of the camera, relative to the model's root
+    ==============================*/
+
+    void sausage64_set_camera(f32 campos[3])
+    {
+        f32 w;
+        f32 dir[3];
+        s64Quat q = {0.525322, 0.850904, 0.0, 0.0};
+        
+        // Billboards all face the camera from the model's root, so their rotation only needs calculating once
+        w = sqrtf(campos[0]*campos[0] + campos[1]*campos[1] + campos[2]*campos[2]);
+        if (w != 0)
+            w = 1/w;
+        dir[0] = campos[0]*w;
+        dir[1] = campos[1]*w;
+        dir[2] = campos[2]*w;
+        
+        // Rotate the mesh 90 degrees to match the billboarding in Libultra
+        q = s64quat_mul(s64quat_fromdir(dir), q);
+        s64quat_to_rot(q, s64_billboard);
+    }
+#endif
+
+
+/*==============================
+    sausage64_update_animplay
+    Updates the animation keyframe based on the animation 
+    tick
+    @param The animplay pointer
+==============================*/
+
+static void sausage64_update_animplay(s64AnimPlay* playing)
+{
+    const s64Animation* anim = playing->animdata;
+    const f32 curtick = playing->curtick;
+    u32 curkf_index, nextkf_index, curkf_value;
+    
+    // Baked animations have a keyframe on every tick
+    if (anim->baked)
+    {
+        playing->curkeyframe = (u32)curtick;
+        return;
+    }
+    
+    // If the animation has a lookup table, then the tick gives us the keyframe directly
+    if (anim->kflookup != NULL)
+    {
+        playing->curkeyframe = anim->kflookup[(u32)curtick];
+        return;
+    }
+    
+    // Otherwise, we need to search for the keyframe, starting from the current one
+    curkf_index = playing->curkeyframe;
+    nextkf_index = (curkf_index+1)%(anim->keyframecount);
+    curkf_value = anim->keyframes[curkf_index].framenumber;
+    
+    // Check if we changed animation frame
+    if (curtick < curkf_value || curtick >= anim->keyframes[nextkf_index].framenumber)
+    {
+        int advance = 1;
+        if (curtick < curkf_value)
+            advance = -1;
+            
+        // Cycle through all remaining, starting at the one after the current frame
+        do
+        {
+            curkf_index += advance;
+            nextkf_index += advance;
+            if (curtick >= anim->keyframes[curkf_index].framenumber && curtick < anim->keyframes[nextkf_index].framenumber)
+            {
+                playing->curkeyframe = curkf_index;
+                return;
+            }
+        }
+        while (1);
+    }
+}
+
+
+/*==============================
+    sausage64_advance_animplay
+    Advances the animation player after a tick has occurred
+    @param The model helper pointer
+    @param The amount to increase the animation tick by
+==============================*/
+
+static void sausage64_advance_animplay(s64ModelHelper* mdl, s64AnimPlay* playing, f32 tickamount)
+{
+    int rollover = 0;
+    const int animlength = playing->animdata->keyframes[playing->animdata->keyframecount-1].framenumber;
+    playing->curtick += tickamount;
+    
+    // Check for rollover
+    if (playing->curtick >= animlength)
+        rollover = 1;
+    else if (playing->curtick <= 0)
+        rollover = -1;
+    
+    // If the animation ended, call the callback function and roll the tick value over
+    if (rollover)
+    {
+        f32 division;
+    
+        // Execute the animation end callback function
+        if (mdl->animcallback != NULL)
+            mdl->animcallback(playing->animdata - &mdl->mdldata->anims[0]);
+        
+        // If looping is disabled, then stop
+        if (!mdl->loop)
+        {
+            if (rollover > 0)
+            {
+                playing->curtick = (f32)animlength;
+                playing->curkeyframe = playing->animdata->keyframecount-1;
+            }
+            else
+            {
+                playing->curtick = 0;
+                playing->curkeyframe = 0;
+            }
+            return;
+        }
+        
+        // Calculate the correct tick
+        division = playing->curtick/((f32)animlength);
+        if (rollover > 0)
+            playing->curtick = (division - ((int)division))*((f32)animlength);
+        else
+            playing->curtick = (1+(division - ((int)division)))*((f32)animlength);
+    }
+
+    // Update the animation
+    if (playing->animdata->keyframecount > 0)
+        sausage64_update_animplay(playing);
+}
+
+
+/*==============================
+    sausage64_advance_anim
+    Advances the animation tick by the given amount
+    @param The model helper pointer
+    @param The amount to increase the animation tick by
+==============================*/
+
+void sausage64_advance_anim(s64ModelHelper* mdl, f32 tickamount)
+{    
+    u8 i;
+    sausage64_advance_animplay(mdl, &mdl->curanim, tickamount);
+    if (mdl->blendticks_left > 0)
+    {
+        mdl->blendticks_left -= tickamount;
+        if (mdl->blendticks_left > 0)
+            sausage64_advance_animplay(mdl, &mdl->blendanim, tickamount);
+    }
+    for (i=0; i<mdl->layercount; i++)
+        if (mdl->layers[i].play.animdata != NULL)
+            sausage64_advance_animplay(mdl, &mdl->layers[i].play, tickamount);
+}
+
+
+/*==============================
+    sausage64_advance_anim_batch
+    Advances the animation tick of multiple model helpers
+    by the same amount
+    @param The list of model helper pointers
+    @param The number of model helpers in the list
+    @param The amount to increase the animation tick by
+==============================*/
+
+void sausage64_advance_anim_batch(s64ModelHelper** mdls, u32 count, f32 tickamount)
+{
+    u32 i;
+    for (i=0; i<count; i++)
+    {
+        s64ModelHelper* mdl = mdls[i];
+        s64AnimPlay* playing = &mdl->curanim;
+        const s64Animation* anim = playing->animdata;
+        f32 curtick;
+        if (anim == NULL)
+            continue;
+        
+        // Most helpers won't be blending, layering, or rolling over, so handle those with just a table lookup
+        curtick = playing->curtick + tickamount;
+        if (mdl->blendticks_left <= 0 && mdl->layercount == 0 && (anim->baked || anim->kflookup != NULL) && curtick > 0 && curtick < anim->keyframes[anim->keyframecount-1].framenumber)
+        {
+            playing->curtick = curtick;
+            playing->curkeyframe = anim->baked ? (u32)curtick : anim->kflookup[(u32)curtick];
+        }
+        else
+            sausage64_advance_anim(mdl, tickamount);
+    }
+}
+
+
+/*==============================
+    sausage64_set_anim
+    Sets an animation on the model. Does not perform 
+    error checking if an invalid animation is given.
+    @param The model helper pointer
+    @param The ANIMATION_* macro to set
+==============================*/
+
+void sausage64_set_anim(s64ModelHelper* mdl, u16 anim)
+{
+    const s64Animation* animdata = &mdl->mdldata->anims[anim];
+    s64AnimPlay* const playing = &mdl->curanim;
+    sausage64_stream_anim(mdl->mdldata, animdata, 0);
+    playing->animdata = animdata;
+    playing->curkeyframe = 0;
+    playing->curtick = 0;
+    mdl->blendticks_left = 0;
+    mdl->blendticks = 0;
+    if (animdata->keyframecount > 0)
+        sausage64_update_animplay(&mdl->curanim);
+}
+
+
+/*==============================
+    sausage64_set_anim_blend
+    Sets an animation on the model with blending. Does not perform 
+    error checking if an invalid animation is given.
+    @param The model helper pointer
+    @param The ANIMATION_* macro to set
+    @param The amount of ticks to blend the animation over
+==============================*/
+
+void sausage64_set_anim_blend(s64ModelHelper* mdl, u16 anim, f32 ticks)
+{
+    if (mdl->curanim.animdata != NULL)
+        mdl->blendanim = mdl->curanim;
+    sausage64_set_anim(mdl, anim);
+    mdl->blendticks_left = ticks;
+    mdl->blendticks = ticks;
+}
+
+
+/*==============================
+    sausage64_set_layercount
+    Sets how many animation layers the model has
+    @param  The model helper pointer
+    @param  The number of layers, or 0 to remove them all
+    @return Whether the layers could be allocated
+==============================*/
+
+u8 sausage64_set_layercount(s64ModelHelper* mdl, u8 count)
+{
+    u8 i;
+    s64AnimLayer* layers;
+    if (count == 0)
+    {
+        S64_PROFILE_SUB(helper_bytes, sizeof(s64AnimLayer)*mdl->layercount);
+        if (mdl->layers != NULL)
+            s64free(mdl->layers);
+        mdl->layers = NULL;
+        mdl->layercount = 0;
+        return TRUE;
+    }
+    
+    // A streamed model must be able to keep the main animation, the blend and every layer in memory at once
+    if (mdl->mdldata->_animstream != NULL && mdl->mdldata->_animstream->slotcount < 2 + (u32)count)
+        return FALSE;
+    
+    // Resize the list of layers, keeping the ones that already exist
+    layers = (s64AnimLayer*)s64alloc(sizeof(s64AnimLayer)*count);
+    if (layers == NULL)
+        return FALSE;
+    if (mdl->layers != NULL)
+    {
+        memcpy(layers, mdl->layers, sizeof(s64AnimLayer)*((mdl->layercount < count) ? mdl->layercount : count));
+        s64free(mdl->layers);
+    }
+    for (i=mdl->layercount; i<count; i++)
+    {
+        layers[i].play.animdata = NULL;
+        layers[i].play.curtick = 0;
+        layers[i].play.curkeyframe = 0;
+        layers[i].weight = 0;
+        layers[i].mask = NULL;
+        layers[i]._lerp = 0;
+    }
+    S64_PROFILE_ADD(helper_bytes, sizeof(s64AnimLayer)*count - sizeof(s64AnimLayer)*mdl->layercount);
+    mdl->layers = layers;
+    mdl->layercount = count;
+    return TRUE;
+}
+
+
+/*==============================
+    sausage64_set_layeranim
+    Sets the animation that an animation layer plays.
+    Does not perform error checking if an invalid layer
+    or animation is given.
+    @param The model helper pointer
+    @param The layer to change
+    @param The ANIMATION_* macro to set
+==============================*/
+
+void sausage64_set_layeranim(s64ModelHelper* mdl, u8 layer, u16 anim)
+{
+    const s64Animation* animdata = &mdl->mdldata->anims[anim];
+    s64AnimPlay* const playing = &mdl->layers[layer].play;
+    sausage64_stream_anim(mdl->mdldata, animdata, 0);
+    playing->animdata = animdata;
+    playing->curkeyframe = 0;
+    playing->curtick = 0;
+    if (animdata->keyframecount > 0)
+        sausage64_update_animplay(playing);
+}
+
+
+/*==============================
+    sausage64_set_layerweight
+    Sets how much an animation layer overrides the
+    layers below it
+    @param The model helper pointer
+    @param The layer to change
+    @param The weight, from 0.0 to 1.0
+==============================*/
+
+void sausage64_set_layerweight(s64ModelHelper* mdl, u8 layer, f32 weight)
+{
+    mdl->layers[layer].weight = weight;
+}
+
+
+/*==============================
+    sausage64_set_layermask
+    Sets how much each mesh is affected by an animation
+    layer
+    @param The model helper pointer
+    @param The layer to change
+    @param An array with a weight for every mesh, or NULL
+           to affect every mesh fully
+==============================*/
+
+void sausage64_set_layermask(s64ModelHelper* mdl, u8 layer, const f32* mask)
+{
+    mdl->layers[layer].mask = mask;
+}
+
+
+/*==============================
+    sausage64_fill_layermask
+    Sets the weight of a mesh and every mesh below it in
+    the hierarchy in a layer mask
+    @param The model helper pointer
+    @param The mask to fill
+    @param The mesh at the top of the hierarchy to fill
+    @param The weight to set
+==============================*/
+
+void sausage64_fill_layermask(s64ModelHelper* mdl, f32* mask, u16 mesh, f32 weight)
+{
+    u16 i;
+    const u16 start = mdl->subtrees[mesh][0];
+    const u16 end = start + mdl->subtrees[mesh][1] + 1;
+    for (i=start; i<end; i++)
+        mask[mdl->meshorder[i]] = weight;
+}
+
+
+#ifdef LIBDRAGON
+    /*==============================
+        sausage64_loadmaterial
+        Loads a material for libdragon rendering
+        @param The material to load
+    ==============================*/
+    
+    void sausage64_loadmaterial(s64Material* mat)
+    {
+        const u8 valid = s64_glstate.valid;
+        u32 diffuse;
+        
+        // Only change the parts of the OpenGL state that are different from what's already set
+        if (mat->type == TYPE_TEXTURE)
+        {
+            s64Texture* tex = (s64Texture*)mat->data;
+            if (!valid || !s64_glstate.textured)
+            {
+                const GLfloat white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+                glEnable(GL_TEXTURE_2D);
+                glEnable(GL_COLOR_MATERIAL);
+                glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, white);
+                s64_glstate.textured = TRUE;
+            }
+            if (!valid || s64_glstate.texture != *tex->identifier)
+            {
+                glBindTexture(GL_TEXTURE_2D, *tex->identifier);
+                s64_glstate.texture = *tex->identifier;
+            }
+            
+            // The vertex colors overwrite the diffuse color while color material is enabled
+            s64_glstate.diffuse = 0xFFFFFFFF;
+        }
+        else
+        {
+            s64PrimColor* col = (s64PrimColor*)mat->data;
+            if (!valid || s64_glstate.textured)
+            {
+                glDisable(GL_TEXTURE_2D);
+                glDisable(GL_COLOR_MATERIAL);
+                s64_glstate.textured = FALSE;
+            }
+            diffuse = (col->r << 16) | (col->g << 8) | col->b;
+            if (!valid || s64_glstate.diffuse != diffuse)
+            {
+                const GLfloat color[] = {(f32)col->r/255.0f, (f32)col->g/255.0f, (f32)col->b/255.0f, 1.0f};
+                glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, color);
+                s64_glstate.diffuse = diffuse;
+            }
+        }
+
+        // Set other draw settings
+        if (!valid || s64_glstate.cullback != mat->cullback || s64_glstate.cullfront != mat->cullfront)
+        {
+            glEnable(GL_CULL_FACE);
+            if (mat->cullfront && mat->cullback)
+                glCullFace(GL_FRONT_AND_BACK);
+            else if (mat->cullfront)
+                glCullFace(GL_FRONT);
+            else if (mat->cullback)
+                glCullFace(GL_BACK);
+            else
+                glDisable(GL_CULL_FACE);
+            s64_glstate.cullfront = mat->cullfront;
+            s64_glstate.cullback = mat->cullback;
+        }
+        if (!valid || s64_glstate.lighting != mat->lighting)
+        {
+            if (mat->lighting)
+                glEnable(GL_LIGHTING);
+            else
+                glDisable(GL_LIGHTING);
+            s64_glstate.lighting = mat->lighting;
+        }
+        if (!valid || s64_glstate.depthtest != mat->depthtest)
+        {
+            if (mat->depthtest)
+                glEnable(GL_DEPTH_TEST);
+            else
+                glDisable(GL_DEPTH_TEST);
+            s64_glstate.depthtest = mat->depthtest;
+        }
+        if (!valid || s64_glstate.smooth != mat->smooth)
+        {
+            if (mat->smooth)
+                glShadeModel(GL_SMOOTH);
+            else
+                glShadeModel(GL_FLAT);
+            s64_glstate.smooth = mat->smooth;
+        }
+        s64_glstate.material = mat;
+        s64_glstate.valid = TRUE;
+    }
+    
+    
+    /*==============================
+        sausage64_reset_glstate
+        Forgets the OpenGL state that the last loaded
+        material set, so that the next material is loaded
+        in full
+    ==============================*/
+    
+    void sausage64_reset_glstate()
+    {
+        s64_glstate.valid = FALSE;
+        s64_glstate.material = NULL;
+    }
+#endif
+
+
+/*==============================
+    sausage64_get_framedata
+    Gets a mesh's transform from a keyframe, decoding it
+    first if the animation was quantized
+    @param  The model data
+    @param  The keyframe to get the transform from
+    @param  The mesh to get the transform of
+    @param  Where to decode a quantized transform to
+    @return A pointer to the mesh's transform
+==============================*/
+
+static const s64Transform* sausage64_get_framedata(const s64ModelData* mdldata, const s64KeyFrame* kf, const u16 mesh, s64Transform* decoded)
+{
+    int i, j = 2;
+    f32 sum = 0;
+    u32 packed[3], largest;
+    const s64QTransform* qdata;
+    if (kf->framedata != NULL)
+        return &kf->framedata[mesh];
+    qdata = &kf->qframedata[mesh];
+    
+    // Position and scale are just fixed point
+    for (i=0; i<3; i++)
+    {
+        decoded->pos[i] = qdata->pos[i]*mdldata->_qposscale;
+        decoded->scale[i] = qdata->scale[i]/256.0f;
+    }
+    
+    // The rotation is stored as the three smallest components (15 bits each) plus the index of the largest
+    largest = (qdata->rot[0] >> 13) & 0x03;
+    packed[2] = ((qdata->rot[0] & 0x1FFF) << 2) | (qdata->rot[1] >> 14);
+    packed[1] = ((qdata->rot[1] & 0x3FFF) << 1) | (qdata->rot[2] >> 15);
+    packed[0] = qdata->rot[2] & 0x7FFF;
+    for (i=0; i<4; i++)
+    {
+        if (i == largest)
+            continue;
+        decoded->rot[i] = ((packed[j]/32767.0f)*2.0f - 1.0f)*QUAT_SMALLEST3_RANGE;
+        sum += decoded->rot[i]*decoded->rot[i];
+        j--;
+    }
+    decoded->rot[largest] = (sum < 1.0f) ? sqrtf(1.0f - sum) : 0.0f;
+    return decoded;
+}
+
+
+/*==============================
+    sausage64_calcanimlerp
+    Calculates the lerp value based on the current animation
+    @param  A pointer to the animation player to use
+    @return The lerp amount
+==============================*/
+
+static f32 sausage64_calcanimlerp(const s64AnimPlay* playing)
+{
+    const s64Animation* anim = playing->animdata;
+    const s64KeyFrame* ckframe = &anim->keyframes[playing->curkeyframe];
+    const s64KeyFrame* nkframe = &anim->keyframes[(playing->curkeyframe+1)%anim->keyframecount];
+    
+    // Baked animations are one tick between keyframes, so the lerp is just how far into the tick we are
+    if (anim->baked)
+        return playing->curtick - ckframe->framenumber;
+
+    // Prevent division by zero when calculating the lerp amount
+    if (nkframe->framenumber - ckframe->framenumber != 0)
+        return ((f32)(playing->curtick - ckframe->framenumber))/((f32)(nkframe->framenumber - ckframe->framenumber));
+    return 0;
+}
+
+
+/*==============================
+    sausage64_blendanimplay
+    Blends a mesh's transform towards where another
+    animation player would put it
+    @param A pointer to the model helper to use
+    @param The animation player to blend towards
+    @param The mesh to blend the transforms of
+    @param The animation player's lerp amount
+    @param How much to blend, from 0.0 to 1.0
+==============================*/
+
+static void sausage64_blendanimplay(s64ModelHelper* mdl, const s64AnimPlay* playing, const u16 mesh, f32 l, f32 w)
+{
+    const s64Animation* anim = playing->animdata;
+    s64Transform* fdata = &mdl->transforms[mesh].data;
+    s64Transform cdecoded, ndecoded;
+    const s64Transform* cfdata = sausage64_get_framedata(mdl->mdldata, &anim->keyframes[playing->curkeyframe], mesh, &cdecoded);
+    const s64Transform* nfdata = cfdata;
+    
+    // Without interpolation, or if we're right on a keyframe, just use the current keyframe
+    if (mdl->interpolate && l != 0)
+        nfdata = sausage64_get_framedata(mdl->mdldata, &anim->keyframes[(playing->curkeyframe+1)%anim->keyframecount], mesh, &ndecoded);
+    else
+        l = 0;
+    
+    fdata->pos[0] = s64lerp(fdata->pos[0], s64lerp(cfdata->pos[0], nfdata->pos[0], l), w);
+    fdata->pos[1] = s64lerp(fdata->pos[1], s64lerp(cfdata->pos[1], nfdata->pos[1], l), w);
+    fdata->pos[2] = s64lerp(fdata->pos[2], s64lerp(cfdata->pos[2], nfdata->pos[2], l), w);
+    if (!mdl->mdldata->meshes[mesh].is_billboard)
+    {
+        s64Quat qf = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
+        s64Quat q =  {cfdata->rot[0], cfdata->rot[1], cfdata->rot[2], cfdata->rot[3]};
+        s64Quat qn = {nfdata->rot[0], nfdata->rot[1], nfdata->rot[2], nfdata->rot[3]};
+        q = s64slerp(qf, s64slerp(q, qn, l), w);
+        fdata->rot[0] = q.w;
+        fdata->rot[1] = q.x;
+        fdata->rot[2] = q.y;
+        fdata->rot[3] = q.z;
+    }
+    fdata->scale[0] = s64lerp(fdata->scale[0], s64lerp(cfdata->scale[0], nfdata->scale[0], l), w);
+    fdata->scale[1] = s64lerp(fdata->scale[1], s64lerp(cfdata->scale[1], nfdata->scale[1], l), w);
+    fdata->scale[2] = s64lerp(fdata->scale[2], s64lerp(cfdata->scale[2], nfdata->scale[2], l), w);
+}
+
+
+/*==============================
+    sausage64_calcanimtransforms
+    Calculates the transform of a mesh based on the animation
+    @param A pointer to the model helper to use
+    @param The mesh to calculate the transforms of
+    @param The lerp amount
+    @param The lerp amount for the animation blending
+==============================*/
+
+static void sausage64_calcanimtransforms(s64ModelHelper* mdl, const u16 mesh, f32 l, f32 bl)
+{
+    u8 i;
+    const s64AnimPlay* playing = &mdl->curanim;
+    S64_PROFILE_BEGIN(calcanim);
+
+    // Calculate current animation transforms
+    if (playing->animdata != NULL)
+    {    
+        const s64Animation* curanim = playing->animdata;
+        s64Transform* fdata = &mdl->transforms[mesh].data;
+        s64Transform cdecoded, ndecoded;
+        const s64Transform* cfdata = sausage64_get_framedata(mdl->mdldata, &curanim->keyframes[playing->curkeyframe], mesh, &cdecoded);
+        
+        // Calculate animation lerp, unless we're right on a keyframe (which baked animations played at whole ticks always are)
+        if (mdl->interpolate && l != 0)
+        {
+            const s64Transform* nfdata = sausage64_get_framedata(mdl->mdldata, &curanim->keyframes[(playing->curkeyframe+1)%curanim->keyframecount], mesh, &ndecoded);
+            
             fdata->pos[0] = s64lerp(cfdata->pos[0], nfdata->pos[0], l);
             fdata->pos[1] = s64lerp(cfdata->pos[1], nfdata->pos[1], l);
             fdata->pos[2] = s64lerp(cfdata->pos[2], nfdata->pos[2], l);
@@ -1899,140 +3666,955 @@ static void sausage64_calcanimtransforms(s64ModelHelper* mdl, const u16 mesh, f3
         }
     }
     
-    // Blend the anim transforms with another animation
-    if (mdl->blendticks_left > 0 && mdl->interpolate)
+    // Blend the anim transforms with another animation
+    if (mdl->blendticks_left > 0 && mdl->interpolate)
+        sausage64_blendanimplay(mdl, &mdl->blendanim, mesh, bl, mdl->blendticks_left/mdl->blendticks);
+    
+    // Blend the animation layers on top, in order
+    for (i=0; i<mdl->layercount; i++)
+    {
+        const s64AnimLayer* layer = &mdl->layers[i];
+        f32 w = layer->weight;
+        if (layer->mask != NULL)
+            w *= layer->mask[mesh];
+        if (w > 0 && layer->play.animdata != NULL)
+            sausage64_blendanimplay(mdl, &layer->play, mesh, layer->_lerp, (w < 1) ? w : 1);
+    }
+    S64_PROFILE_END(calcanim);
+}
+
+
+/*==============================
+    sausage64_canshare_pose
+    Checks whether a model helper's pose depends only on its
+    current animation and tick, so it can use the pose cache
+    @param  The model helper pointer
+    @return Whether the pose can be shared
+==============================*/
+
+static u8 sausage64_canshare_pose(const s64ModelHelper* mdl)
+{
+    u8 i;
+    if (mdl->mdldata->_posecache == NULL || (mdl->blendticks_left > 0 && mdl->interpolate))
+        return FALSE;
+    for (i=0; i<mdl->layercount; i++)
+        if (mdl->layers[i].play.animdata != NULL && mdl->layers[i].weight > 0)
+            return FALSE;
+    return TRUE;
+}
+
+
+/*==============================
+    sausage64_fetch_pose
+    Copies a model helper's pose from the pose cache, calculating
+    it first (over the least recently used entry) if no other
+    helper has needed it yet
+    @param The model helper pointer
+==============================*/
+
+static void sausage64_fetch_pose(s64ModelHelper* mdl)
+{
+    u16 i;
+    s64PoseCache* cache = mdl->mdldata->_posecache;
+    s64PoseEntry* entry = NULL;
+    s64PoseEntry* oldest = NULL;
+    s64AnimPlay playing = mdl->curanim;
+    const u16 mcount = mdl->mdldata->meshcount;
+    
+    // Snap the tick to the cache's step, so that helpers which are close enough share the same pose
+    if (cache->step > 0)
+    {
+        playing.curtick = ((s32)(playing.curtick/cache->step))*cache->step;
+        sausage64_update_animplay(&playing);
+    }
+    
+    // Find the pose, keeping track of the oldest entry in case it isn't there
+    for (i=0; i<cache->count; i++)
+    {
+        s64PoseEntry* cur = &cache->entries[i];
+        if (cur->id != 0 && cur->anim == playing.animdata && cur->tick == playing.curtick && cur->interpolate == mdl->interpolate)
+        {
+            entry = cur;
+            break;
+        }
+        if (oldest == NULL || cur->lastused < oldest->lastused)
+            oldest = cur;
+    }
+    
+    // Calculate the pose if it wasn't cached, otherwise just copy it
+    if (entry == NULL)
+    {
+        const s64AnimPlay current = mdl->curanim;
+        f32 l;
+        entry = oldest;
+        mdl->curanim = playing;
+        l = sausage64_calcanimlerp(&mdl->curanim);
+        for (i=0; i<mcount; i++)
+            sausage64_calcanimtransforms(mdl, i, l, 0);
+        mdl->curanim = current;
+        memcpy(entry->transforms, mdl->transforms, sizeof(s64FrameTransform)*mcount);
+        entry->anim = playing.animdata;
+        entry->tick = playing.curtick;
+        entry->interpolate = mdl->interpolate;
+        if (++s64_poseids == 0)
+            s64_poseids = 1;
+        entry->id = s64_poseids;
+        #ifndef LIBDRAGON
+            memset(entry->mtxvalid, FALSE, sizeof(u8)*mcount);
+        #endif
+    }
+    else
+        memcpy(mdl->transforms, entry->transforms, sizeof(s64FrameTransform)*mcount);
+    entry->lastused = ++cache->usecount;
+    mdl->_poseentry = entry - cache->entries;
+    mdl->_poseid = entry->id;
+}
+
+
+/*==============================
+    sausage64_stream_pose
+    Makes sure every streamed animation that affects a model
+    helper's pose is in memory. All of them are pinned before
+    any is loaded, so loading one can't evict another
+    @param  The model helper pointer
+    @return TRUE if they're all in memory, FALSE if there 
+            aren't enough stream slots
+==============================*/
+
+static u8 sausage64_stream_pose(s64ModelHelper* mdl)
+{
+    u8 i;
+    u32 pin;
+    const s64ModelData* mdldata = mdl->mdldata;
+    const u8 blending = (mdl->blendticks_left > 0 && mdl->interpolate);
+    if (mdldata->_animstream == NULL)
+        return TRUE;
+    pin = ++mdldata->_animstream->usecount;
+    
+    // Pin the animations which are already resident
+    sausage64_stream_pin(mdldata, mdl->curanim.animdata, pin);
+    if (blending)
+        sausage64_stream_pin(mdldata, mdl->blendanim.animdata, pin);
+    for (i=0; i<mdl->layercount; i++)
+        if (mdl->layers[i].play.animdata != NULL && mdl->layers[i].weight > 0)
+            sausage64_stream_pin(mdldata, mdl->layers[i].play.animdata, pin);
+    
+    // Then load the rest into the unpinned slots
+    if (!sausage64_stream_anim(mdldata, mdl->curanim.animdata, pin))
+        return FALSE;
+    if (blending && !sausage64_stream_anim(mdldata, mdl->blendanim.animdata, pin))
+        return FALSE;
+    for (i=0; i<mdl->layercount; i++)
+        if (mdl->layers[i].play.animdata != NULL && mdl->layers[i].weight > 0)
+            if (!sausage64_stream_anim(mdldata, mdl->layers[i].play.animdata, pin))
+                return FALSE;
+    return TRUE;
+}
+
+
+/*==============================
+    sausage64_evaluate_pose
+    Calculates the transforms of every mesh for the current
+    frame. Drawing, lookat and transform queries will reuse
+    them until the model is drawn again
+    @param The model helper pointer
+==============================*/
+
+void sausage64_evaluate_pose(s64ModelHelper* mdl)
+{
+    u16 i;
+    f32 l, bl = 0;
+    const u16 mcount = mdl->mdldata->meshcount;
+    mdl->poserendercount = mdl->rendercount;
+    mdl->_poseid = 0;
+    if (mdl->curanim.animdata == NULL)
+        return;
+    
+    // Make sure streamed animations are in memory, or keep the last pose if they can't all fit
+    if (!sausage64_stream_pose(mdl))
+        return;
+    
+    // Helpers playing the same animation at the same tick can share their pose
+    if (sausage64_canshare_pose(mdl))
+    {
+        sausage64_fetch_pose(mdl);
+        return;
+    }
+    
+    // Calculate the lerp values once, then do every mesh
+    l = sausage64_calcanimlerp(&mdl->curanim);
+    if (mdl->blendticks_left > 0)
+        bl = sausage64_calcanimlerp(&mdl->blendanim);
+    for (i=0; i<mdl->layercount; i++)
+    {
+        s64AnimLayer* layer = &mdl->layers[i];
+        if (layer->play.animdata == NULL)
+            continue;
+        layer->_lerp = sausage64_calcanimlerp(&layer->play);
+    }
+    for (i=0; i<mcount; i++)
+        sausage64_calcanimtransforms(mdl, i, l, bl);
+}
+
+
+/*==============================
+    sausage64_get_meshtransform
+    Get the current transform of the mesh,
+    local to the object. The helper stops sharing
+    matrices with the pose cache for the rest of
+    the frame, since the transform can be modified
+    @param  The model helper pointer
+    @param  The mesh to check
+    @return The mesh's local transform
+==============================*/
+
+s64Transform* sausage64_get_meshtransform(s64ModelHelper* mdl, const u16 mesh)
+{
+    if (mdl->poserendercount != mdl->rendercount)
+        sausage64_evaluate_pose(mdl);
+    mdl->_poseid = 0;
+    return &mdl->transforms[mesh].data;
+}
+
+
+/*==============================
+    sausage64_needs_pose
+    Checks whether a model helper's pose still needs to be
+    calculated this frame
+    @param  The model helper pointer
+    @param  Whether only helpers that are about to be drawn
+            need it
+    @return Whether the pose needs to be calculated
+==============================*/
+
+static u8 sausage64_needs_pose(const s64ModelHelper* mdl, u8 drawing)
+{
+    if (mdl->poserendercount == mdl->rendercount)
+        return FALSE;
+    if (drawing)
+    {
+        if (mdl->curanim.animdata == NULL)
+            return FALSE;
+        #ifndef LIBDRAGON
+            if (!mdl->visible)
+                return FALSE;
+        #endif
+    }
+    return TRUE;
+}
+
+
+/*==============================
+    sausage64_evaluate_batch
+    Calculates the poses of a list of model helpers. Helpers
+    with streamed animations are grouped by model and 
+    animation, so each animation is read from ROM at most
+    once per batch instead of the helpers evicting each 
+    other's animations
+    @param The list of model helper pointers
+    @param The number of model helpers in the list
+    @param Whether to skip helpers that won't be drawn
+==============================*/
+
+static void sausage64_evaluate_batch(s64ModelHelper** mdls, u32 count, u8 drawing)
+{
+    u32 i, j;
+    for (i=0; i<count; i++)
+    {
+        const s64ModelHelper* first = mdls[i];
+        if (!sausage64_needs_pose(first, drawing))
+            continue;
+        sausage64_evaluate_pose(mdls[i]);
+        if (first->mdldata->_animstream == NULL)
+            continue;
+        
+        // Evaluate the rest of the helpers playing this animation while it's still in memory
+        for (j=i+1; j<count; j++)
+        {
+            s64ModelHelper* mdl = mdls[j];
+            if (mdl->mdldata == first->mdldata && mdl->curanim.animdata == first->curanim.animdata && sausage64_needs_pose(mdl, drawing))
+                sausage64_evaluate_pose(mdl);
+        }
+    }
+}
+
+
+/*==============================
+    sausage64_calctransforms_batch
+    Calculates the transforms of every mesh for multiple
+    model helpers, so that drawing them later doesn't
+    need to. Helpers with streamed animations are grouped
+    by animation, so each one is read from ROM only once
+    @param The list of model helper pointers
+    @param The number of model helpers in the list
+==============================*/
+
+void sausage64_calctransforms_batch(s64ModelHelper** mdls, u32 count)
+{
+    sausage64_evaluate_batch(mdls, count, FALSE);
+}
+
+
+/*==============================
+    sausage64_lookat
+    Make a mesh look at another
+    @param The model helper pointer
+    @param The mesh to force the lookat
+    @param The normalized direction vector of what we want to look at
+    @param A value from 0.0 to 1.0 stating how much to look at the object
+    @param Whether the lookat should propagate to the children meshes (and their children, all the way down)
+==============================*/
+
+void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amount, u8 affectchildren)
+{
+    s64Quat q, qt;
+    f32 oldpos_parent[3];
+    s64Transform* trans;
+    S64_PROFILE_BEGIN(lookat);
+    
+    // First, ensure that the transforms for this frame have been calculated
+    if (mdl->poserendercount != mdl->rendercount)
+        sausage64_evaluate_pose(mdl);
+    
+    // Get the transform data. The pose no longer matches the cached one
+    trans = &mdl->transforms[mesh].data;
+    mdl->_poseid = 0;
+    oldpos_parent[0] = trans->pos[0];
+    oldpos_parent[1] = trans->pos[1];
+    oldpos_parent[2] = trans->pos[2];
+    q.w = trans->rot[0];
+    q.x = trans->rot[1];
+    q.y = trans->rot[2];
+    q.z = trans->rot[3];
+    
+    // Now, we can calculate the target quaternion, and lerp it
+    qt = s64quat_fromdir(dir);
+    qt = s64slerp(q, qt, amount);
+    trans->rot[0] = qt.w;
+    trans->rot[1] = qt.x;
+    trans->rot[2] = qt.y;
+    trans->rot[3] = qt.z;
+    
+    // Calculate the new transforms of everything below this mesh in the hierarchy
+    if (affectchildren)
+    {
+        int i;
+        const u16 start = mdl->subtrees[mesh][0]+1;
+        const u16 end = start + mdl->subtrees[mesh][1];
+        s64Quat rotdiff = s64quat_difference(q, qt);
+        for (i=start; i<end; i++)  
+        {
+            f32 root_offset[3];
+            f32 root_offset_new[3];
+            s64Transform* trans_child = &mdl->transforms[mdl->meshorder[i]].data;
+            s64Quat rot;
+            
+            // Get the offset of the child's root compared to the parent's
+            root_offset[0] = trans_child->pos[0] - oldpos_parent[0];
+            root_offset[1] = trans_child->pos[1] - oldpos_parent[1];
+            root_offset[2] = trans_child->pos[2] - oldpos_parent[2];
+            
+            // Rotate the root around the new rotational difference
+            s64vec_rotate(root_offset, rotdiff, root_offset_new);
+            
+            // Apply the new root
+            trans_child->pos[0] += root_offset_new[0] - root_offset[0];
+            trans_child->pos[1] += root_offset_new[1] - root_offset[1];
+            trans_child->pos[2] += root_offset_new[2] - root_offset[2];
+            
+            // Now add the rotation to the mesh itself
+            rot.w = trans_child->rot[0];
+            rot.x = trans_child->rot[1];
+            rot.y = trans_child->rot[2];
+            rot.z = trans_child->rot[3];
+            rot = s64quat_mul(rotdiff, rot);
+            trans_child->rot[0] = rot.w;
+            trans_child->rot[1] = rot.x;
+            trans_child->rot[2] = rot.y;
+            trans_child->rot[3] = rot.z;
+        }
+    }
+    S64_PROFILE_END(lookat);
+}
+
+
+#ifndef LIBDRAGON
+    /*==============================
+        sausage64_sphere_visible
+        Checks whether a sphere is inside of a model's
+        view frustum
+        @param  The model helper pointer
+        @param  The center of the sphere, in model space
+        @param  The radius of the sphere
+        @return Whether the sphere is at least partially visible
+    ==============================*/
+
+    static inline u8 sausage64_sphere_visible(s64ModelHelper* mdl, const f32 center[3], f32 radius)
+    {
+        int i;
+        for (i=0; i<6; i++)
+            if (mdl->frustum[i][0]*center[0] + mdl->frustum[i][1]*center[1] + mdl->frustum[i][2]*center[2] + mdl->frustum[i][3] < -radius)
+                return FALSE;
+        return TRUE;
+    }
+    
+    
+    /*==============================
+        s64sphere_merge
+        Grows a sphere so that it also contains another one
+        @param The sphere to grow
+        @param The sphere to contain
+    ==============================*/
+
+    static void s64sphere_merge(f32 bounds[4], const f32 other[4])
+    {
+        int i;
+        f32 dir[3], dist;
+        for (i=0; i<3; i++)
+            dir[i] = other[i] - bounds[i];
+        dist = sqrtf(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+        if (dist + other[3] > bounds[3])
+        {
+            if (dist + bounds[3] <= other[3])
+            {
+                for (i=0; i<4; i++)
+                    bounds[i] = other[i];
+            }
+            else
+            {
+                f32 radius = (dist + bounds[3] + other[3])/2;
+                for (i=0; i<3; i++)
+                    bounds[i] += dir[i]*(radius - bounds[3])/dist;
+                bounds[3] = radius;
+            }
+        }
+    }
+    
+    
+    /*==============================
+        sausage64_model_visible
+        Checks whether the bounding sphere of the model's
+        current animation is inside of the view frustum
+        @param  The model helper pointer
+        @return Whether the model is at least partially visible
+    ==============================*/
+
+    static u8 sausage64_model_visible(s64ModelHelper* mdl)
+    {
+        int i;
+        f32 bounds[4];
+        const s64Animation* anim = mdl->curanim.animdata;
+        const s64Animation* blend = mdl->blendanim.animdata;
+        if (!mdl->cull || anim == NULL || anim->bounds[3] <= 0)
+            return TRUE;
+        for (i=0; i<4; i++)
+            bounds[i] = anim->bounds[i];
+        
+        // While blending, the pose is somewhere between both animations, so use a sphere that contains both of them
+        if (mdl->blendticks_left > 0 && blend != NULL && blend != anim)
+        {
+            if (blend->bounds[3] <= 0)
+                return TRUE;
+            s64sphere_merge(bounds, blend->bounds);
+        }
+        
+        // Same with any animation layers that affect the pose
+        for (i=0; i<mdl->layercount; i++)
+        {
+            const s64Animation* layer = mdl->layers[i].play.animdata;
+            if (layer == NULL || mdl->layers[i].weight <= 0 || layer == anim)
+                continue;
+            if (layer->bounds[3] <= 0)
+                return TRUE;
+            s64sphere_merge(bounds, layer->bounds);
+        }
+        return sausage64_sphere_visible(mdl, bounds, bounds[3]);
+    }
+    
+    
+    /*==============================
+        sausage64_mesh_visible
+        Checks whether a mesh's bounding sphere, placed where
+        the current pose puts the mesh, is inside of the
+        view frustum
+        @param  The model helper pointer
+        @param  The mesh to check
+        @param  The sphere that was checked, with a radius of
+                zero if the mesh has no bounds
+        @return Whether the mesh is at least partially visible
+    ==============================*/
+
+    static u8 sausage64_mesh_visible(s64ModelHelper* mdl, u16 mesh, f32 sphere[4])
+    {
+        int i;
+        f32 scale = 0;
+        const s64Mesh* meshdata = &mdl->mdldata->meshes[mesh];
+        s64Transform* fdata = &mdl->transforms[mesh].data;
+        sphere[3] = 0;
+        if (meshdata->bounds[3] <= 0)
+            return TRUE;
+        if (mdl->curanim.animdata == NULL)
+        {
+            for (i=0; i<4; i++)
+                sphere[i] = meshdata->bounds[i];
+            return sausage64_sphere_visible(mdl, sphere, sphere[3]);
+        }
+        for (i=0; i<3; i++)
+        {
+            f32 s = (fdata->scale[i] < 0) ? -fdata->scale[i] : fdata->scale[i];
+            if (s > scale)
+                scale = s;
+        }
+        
+        // Billboards can face any direction, so use a sphere that contains every rotation around the pivot
+        if (meshdata->is_billboard)
+        {
+            const f32* b = meshdata->bounds;
+            for (i=0; i<3; i++)
+                sphere[i] = fdata->pos[i];
+            sphere[3] = scale*(sqrtf(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]) + b[3]);
+            return sausage64_sphere_visible(mdl, sphere, sphere[3]);
+        }
+        
+        // Otherwise, move the sphere the same way the mesh's matrix would (rotate, scale, then translate)
+        {
+            s64Quat q = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
+            s64vec_rotate((f32*)meshdata->bounds, q, sphere);
+        }
+        for (i=0; i<3; i++)
+            sphere[i] = sphere[i]*fdata->scale[i] + fdata->pos[i];
+        sphere[3] = scale*meshdata->bounds[3];
+        return sausage64_sphere_visible(mdl, sphere, sphere[3]);
+    }
+    
+    
+    /*==============================
+        sausage64_select_lod
+        Picks which display list to draw a mesh with, based on
+        how much of the screen its bounding sphere covers
+        @param  The model helper pointer
+        @param  The mesh to draw
+        @param  The mesh's bounding sphere, from
+                sausage64_mesh_visible
+        @return The display list to draw
+    ==============================*/
+
+    static const Gfx* sausage64_select_lod(s64ModelHelper* mdl, u16 mesh, const f32 sphere[4])
     {
-        const s64AnimPlay* blending = &mdl->blendanim;
-        const s64Animation* blendanim = blending->animdata;
-        s64Transform* fdata = &mdl->transforms[mesh].data;
-        const s64Transform* cfdata = &blendanim->keyframes[blending->curkeyframe].framedata[mesh];
-        const s64Transform* nfdata = &blendanim->keyframes[(blending->curkeyframe+1)%blendanim->keyframecount].framedata[mesh];
-        const f32 blendlerp = mdl->blendticks_left/mdl->blendticks;
+        u32 level = 0;
+        f32 w, size, threshold;
+        const s64Mesh* meshdata = &mdl->mdldata->meshes[mesh];
+        if (meshdata->lodcount == 0 || sphere[3] <= 0)
+            return meshdata->dl;
+        
+        // Skip the LODs if the camera is inside of the sphere, since the size can't be estimated
+        w = mdl->lodw[0]*sphere[0] + mdl->lodw[1]*sphere[1] + mdl->lodw[2]*sphere[2] + mdl->lodw[3];
+        if (w <= sphere[3])
+            return meshdata->dl;
         
-        fdata->pos[0] = s64lerp(fdata->pos[0], s64lerp(cfdata->pos[0], nfdata->pos[0], bl), blendlerp);
-        fdata->pos[1] = s64lerp(fdata->pos[1], s64lerp(cfdata->pos[1], nfdata->pos[1], bl), blendlerp);
-        fdata->pos[2] = s64lerp(fdata->pos[2], s64lerp(cfdata->pos[2], nfdata->pos[2], bl), blendlerp);
-        if (!mdl->mdldata->meshes[mesh].is_billboard)
+        // Every time the mesh halves in size, move onto the next LOD
+        size = sphere[3]*mdl->lodscale/w;
+        threshold = mdl->lodsize;
+        while (level < meshdata->lodcount && size < threshold)
         {
-            s64Quat qf = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
-            s64Quat q =  {cfdata->rot[0], cfdata->rot[1], cfdata->rot[2], cfdata->rot[3]};
-            s64Quat qn = {nfdata->rot[0], nfdata->rot[1], nfdata->rot[2], nfdata->rot[3]};
-            q = s64slerp(qf, s64slerp(q, qn, bl), blendlerp);
-            fdata->rot[0] = q.w;
-            fdata->rot[1] = q.x;
-            fdata->rot[2] = q.y;
-            fdata->rot[3] = q.z;
+            level++;
+            threshold /= 2;
         }
-        fdata->scale[0] = s64lerp(fdata->scale[0], s64lerp(cfdata->scale[0], nfdata->scale[0], bl), blendlerp);
-        fdata->scale[1] = s64lerp(fdata->scale[1], s64lerp(cfdata->scale[1], nfdata->scale[1], bl), blendlerp);
-        fdata->scale[2] = s64lerp(fdata->scale[2], s64lerp(cfdata->scale[2], nfdata->scale[2], bl), blendlerp);
+        if (level == 0)
+            return meshdata->dl;
+        return meshdata->lods[level-1];
     }
-}
+#endif
 
 
 /*==============================
-    sausage64_get_meshtransform
-    Get the current transform of the mesh,
-    local to the object
-    @param  The model helper pointer
-    @param  The mesh to check
-    @return The mesh's local transform
+    s64mtx_trsrows
+    Calculates the first three rows of a mesh's matrix,
+    which are its rotation with each column scaled. The
+    translation is the last row, as is
+    @param The transform to use
+    @param Whether the mesh is a billboard
+    @param The rows to fill
 ==============================*/
 
-s64Transform* sausage64_get_meshtransform(s64ModelHelper* mdl, const u16 mesh)
+static inline void s64mtx_trsrows(const s64Transform* fdata, u8 billboard, f32 r[3][3])
 {
-    f32 l = sausage64_calcanimlerp(&mdl->curanim);
-    f32 bl = 0;
-    if (mdl->blendticks_left > 0)
-        bl = sausage64_calcanimlerp(&mdl->blendanim);
-    sausage64_calcanimtransforms(mdl, mesh, l, bl);
-    return &mdl->transforms[mesh].data;
+    int i;
+    
+    // Billboards face the camera, which was calculated when the camera was set
+    if (!billboard)
+    {
+        s64Quat q = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
+        s64quat_to_rot(q, r);
+    }
+    else
+    {
+        #ifndef LIBDRAGON
+            for (i=0; i<3; i++)
+            {
+                r[i][0] = s64_viewmat[0][i];
+                r[i][1] = s64_viewmat[1][i];
+                r[i][2] = s64_viewmat[2][i];
+            }
+        #else
+            memcpy(r, s64_billboard, sizeof(s64_billboard));
+        #endif
+    }
+    
+    // Scale each column
+    for (i=0; i<3; i++)
+    {
+        r[i][0] *= fdata->scale[0];
+        r[i][1] *= fdata->scale[1];
+        r[i][2] *= fdata->scale[2];
+    }
 }
 
 
-/*==============================
-    sausage64_lookat
-    Make a mesh look at another
-    @param The model helper pointer
-    @param The mesh to force the lookat
-    @param The normalized direction vector of what we want to look at
-    @param A value from 0.0 to 1.0 stating how much to look at the object
-    @param Whether the lookat should propagate to the children meshes (up to one level)
-==============================*/
+#ifndef LIBDRAGON
+    /*==============================
+        s64mtx_packrow
+        Converts a row of floats to s15.16 fixed point and stores
+        it in the integer and fractional halves of a matrix,
+        the same way guMtxF2L does
+        @param The integer half of the row to fill
+        @param The fractional half of the row to fill
+        @param The row's first value
+        @param The row's second value
+        @param The row's third value
+        @param The row's fourth value
+    ==============================*/
 
-void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amount, u8 affectchildren)
-{
-    s64Quat q, qt;
-    s64Transform oldtrans_parent;
-    s64Transform* trans;
-    f32 l = sausage64_calcanimlerp(&mdl->curanim);
-    f32 bl = 0;
-    if (mdl->blendticks_left > 0)
-        bl = sausage64_calcanimlerp(&mdl->blendanim);
+    static inline void s64mtx_packrow(s32* mi, s32* mf, f32 x, f32 y, f32 z, f32 w)
+    {
+        s32 e1 = (s32)(x*65536.0f);
+        s32 e2 = (s32)(y*65536.0f);
+        s32 e3 = (s32)(z*65536.0f);
+        s32 e4 = (s32)(w*65536.0f);
+        mi[0] = (e1 & 0xFFFF0000) | ((e2 >> 16) & 0xFFFF);
+        mf[0] = (((u32)e1 << 16) & 0xFFFF0000) | (e2 & 0xFFFF);
+        mi[1] = (e3 & 0xFFFF0000) | ((e4 >> 16) & 0xFFFF);
+        mf[1] = (((u32)e3 << 16) & 0xFFFF0000) | (e4 & 0xFFFF);
+    }
+
+
+    /*==============================
+        s64mtx_fromtrs
+        Builds a mesh's fixed point matrix straight from its
+        rotation, scale, and translation, without building the
+        intermediate float matrices. The terms that are left are
+        added in the same order as multiplying the float matrices
+        with guMtxCatF and converting them with guMtxF2L, so with
+        floating point contraction turned off, the result matches
+        the Sample Tests stubs of those functions bit for bit
+        (Sample Tests/mtx.c checks this). If the compiler fuses
+        multiplies and adds, an element can be a float rounding
+        off instead, which is up to 128 LSBs for the translations
+        of up to 10000 units that test uses
+        @param The transform to use
+        @param Whether the mesh is a billboard
+        @param The matrix to multiply the result with, or NULL
+        @param The matrix to fill
+    ==============================*/
+
+    static inline void s64mtx_fromtrs(const s64Transform* fdata, u8 billboard, f32 (*base)[4], Mtx* matrix)
+    {
+        int i;
+        f32 r[3][3];
+        s32* mi = (s32*)&matrix->m[0][0];
+        s32* mf = (s32*)&matrix->m[2][0];
+        
+        // Get the rotated and scaled axes
+        s64mtx_trsrows(fdata, billboard, r);
+        
+        // Put the translation in the last row, and convert it all to fixed point
+        if (base == NULL)
+        {
+            for (i=0; i<3; i++)
+                s64mtx_packrow(&mi[i*2], &mf[i*2], r[i][0], r[i][1], r[i][2], 0);
+            s64mtx_packrow(&mi[6], &mf[6], fdata->pos[0], fdata->pos[1], fdata->pos[2], 1);
+            return;
+        }
+        
+        // Otherwise, multiply with the base matrix first. The mesh matrix's last column is always (0, 0, 0, 1)
+        for (i=0; i<3; i++)
+            s64mtx_packrow(&mi[i*2], &mf[i*2],
+                r[i][0]*base[0][0] + r[i][1]*base[1][0] + r[i][2]*base[2][0],
+                r[i][0]*base[0][1] + r[i][1]*base[1][1] + r[i][2]*base[2][1],
+                r[i][0]*base[0][2] + r[i][1]*base[1][2] + r[i][2]*base[2][2],
+                r[i][0]*base[0][3] + r[i][1]*base[1][3] + r[i][2]*base[2][3]
+            );
+        s64mtx_packrow(&mi[6], &mf[6],
+            fdata->pos[0]*base[0][0] + fdata->pos[1]*base[1][0] + fdata->pos[2]*base[2][0] + base[3][0],
+            fdata->pos[0]*base[0][1] + fdata->pos[1]*base[1][1] + fdata->pos[2]*base[2][1] + base[3][1],
+            fdata->pos[0]*base[0][2] + fdata->pos[1]*base[1][2] + fdata->pos[2]*base[2][2] + base[3][2],
+            fdata->pos[0]*base[0][3] + fdata->pos[1]*base[1][3] + fdata->pos[2]*base[2][3] + base[3][3]
+        );
+    }
     
-    // First, ensure that the transforms for this mesh has been calculated
-    sausage64_calcanimtransforms(mdl, mesh, l, bl);
     
-    // Get the transform data
-    trans = &mdl->transforms[mesh].data;
-    if (affectchildren)
-        oldtrans_parent = *trans;
-    q.w = trans->rot[0];
-    q.x = trans->rot[1];
-    q.y = trans->rot[2];
-    q.z = trans->rot[3];
+    /*==============================
+        sausage64_loadmaterialdl
+        Copies the commands of a material display list which
+        change the render state that the previous materials
+        left behind, and skips the rest
+        @param A pointer to a display list pointer
+        @param The material display list to load
+    ==============================*/
+
+    static void sausage64_loadmaterialdl(Gfx** glistp, const Gfx* mat)
+    {
+        int k;
+        u8 synced = FALSE;
+        u8 geopending = FALSE;
+        u32 geoclear = 0xFFFFFFFF, geoset = 0;
+        s64_rdpstate.material = OS_K0_TO_PHYSICAL(mat);
+        for (;; mat++)
+        {
+            const u32 w0 = mat->words.w0;
+            const u32 op = w0 >> 24;
+            
+            // Geometry mode commands are merged into one, which is only sent if the mode changes
+            if (geopending && op != G_GEOMODE)
+            {
+                u32 mode = (s64_rdpstate.geomode & geoclear) | geoset;
+                if (!s64_rdpstate.geovalid || mode != s64_rdpstate.geomode)
+                {
+                    (*glistp)->words.w0 = (G_GEOMODE << 24) | (geoclear & 0x00FFFFFF);
+                    (*glistp)->words.w1 = geoset;
+                    (*glistp)++;
+                }
+                s64_rdpstate.geovalid = s64_rdpstate.geovalid || (geoclear & 0x00FFFFFF) == 0;
+                s64_rdpstate.geomode = mode;
+                geopending = FALSE;
+            }
+            switch (op)
+            {
+                case G_ENDDL:
+                    return;
+                case G_SPNOOP:
+                case G_RDPPIPESYNC: // Only synced when something changes
+                    continue;
+                case G_GEOMODE:
+                    geoclear &= w0 | 0xFF000000;
+                    geoset = (geoset & (w0 | 0xFF000000)) | mat->words.w1;
+                    geopending = TRUE;
+                    continue;
+                case G_SETTIMG: // The start of a texture load, which is 7 commands long
+                    if (s64_rdpstate.texvalid && !memcmp(s64_rdpstate.texload, mat, sizeof(s64_rdpstate.texload)))
+                    {
+                        mat += 6;
+                        continue;
+                    }
+                    if (!synced)
+                        gDPPipeSync((*glistp)++);
+                    synced = TRUE;
+                    memcpy(s64_rdpstate.texload, mat, sizeof(s64_rdpstate.texload));
+                    memcpy(*glistp, mat, sizeof(s64_rdpstate.texload));
+                    s64_rdpstate.texvalid = TRUE;
+                    *glistp += 7;
+                    mat += 6;
+                    continue;
+                case G_SETOTHERMODE_H:
+                case G_SETOTHERMODE_L:
+                case G_SETCOMBINE:
+                case G_SETPRIMCOLOR:
+                    // Other modes are told apart by which bits they set, the rest by their opcode
+                    for (k=0; k<s64_rdpstate.modecount; k++)
+                        if (s64_rdpstate.modes[k].words.w0 == w0 || (op != G_SETOTHERMODE_H && op != G_SETOTHERMODE_L && (s64_rdpstate.modes[k].words.w0 >> 24) == op))
+                            break;
+                    if (k < s64_rdpstate.modecount && s64_rdpstate.modes[k].words.w0 == w0 && s64_rdpstate.modes[k].words.w1 == mat->words.w1)
+                        continue;
+                    if (k == s64_rdpstate.modecount && k < S64_RDPMODES)
+                        s64_rdpstate.modecount++;
+                    if (k < S64_RDPMODES)
+                        s64_rdpstate.modes[k] = *mat;
+                    if (!synced)
+                        gDPPipeSync((*glistp)++);
+                    synced = TRUE;
+                    *(*glistp)++ = *mat;
+                    continue;
+                default:
+                    *(*glistp)++ = *mat;
+                    continue;
+            }
+        }
+    }
     
-    // Now, we can calculate the target quaternion, and lerp it
-    qt = s64quat_fromdir(dir);
-    qt = s64slerp(q, qt, amount);
-    trans->rot[0] = qt.w;
-    trans->rot[1] = qt.x;
-    trans->rot[2] = qt.y;
-    trans->rot[3] = qt.z;
     
-    // Calculate the children's new transforms
-    if (affectchildren)
+    /*==============================
+        sausage64_drawgfx
+        Draws a mesh's display list. If the model has material
+        display lists, the calls in the mesh's display list are
+        copied over instead, and the calls to the materials are
+        replaced with the commands that change the render state
+        @param A pointer to a display list pointer
+        @param The model data the display list belongs to
+        @param The display list to draw
+    ==============================*/
+
+    static inline void sausage64_drawgfx(Gfx** glistp, const s64ModelData* mdata, const Gfx* dl)
     {
-        int i;
-        const s64ModelData* mdata = mdl->mdldata;
-        s64Quat rotdiff = s64quat_difference(q, qt);
-        for (i=0; i<mdata->meshcount; i++)  
+        u32 matstart, matend;
+        if (mdata->_matdls == NULL)
         {
-            f32 root_offset[3];
-            f32 root_offset_new[3];
-            s64Transform* trans_child;
-            s64Quat rot;
-            if (mdata->meshes[i].parent != mesh)
+            gSPDisplayList((*glistp)++, dl);
+            sausage64_reset_rdpstate();
+            return;
+        }
+        matstart = OS_K0_TO_PHYSICAL(mdata->_matdls);
+        matend = OS_K0_TO_PHYSICAL(&mdata->_matdls[mdata->_matdlslots]);
+        for (; (dl->words.w0 >> 24) != G_ENDDL; dl++)
+        {
+            u32 target = dl->words.w1;
+            if ((dl->words.w0 >> 24) == G_DL && target >= matstart && target < matend)
+            {
+                if (target != s64_rdpstate.material)
+                    sausage64_loadmaterialdl(glistp, &mdata->_matdls[(target - matstart)/sizeof(Gfx)]);
                 continue;
-            sausage64_calcanimtransforms(mdl, i, l, bl);
-            trans_child = &mdl->transforms[i].data;
-            
-            // Get the offset of the child's root compared to the parent's
-            root_offset[0] = trans_child->pos[0] - oldtrans_parent.pos[0];
-            root_offset[1] = trans_child->pos[1] - oldtrans_parent.pos[1];
-            root_offset[2] = trans_child->pos[2] - oldtrans_parent.pos[2];
-            
-            // Rotate the root around the new rotational difference
-            s64vec_rotate(root_offset, rotdiff, root_offset_new);
-            
-            // Apply the new root
-            trans_child->pos[0] += root_offset_new[0] - root_offset[0];
-            trans_child->pos[1] += root_offset_new[1] - root_offset[1];
-            trans_child->pos[2] += root_offset_new[2] - root_offset[2];
-            
-            // Now add the rotation to the mesh itself
-            rot.w = trans_child->rot[0];
-            rot.x = trans_child->rot[1];
-            rot.y = trans_child->rot[2];
-            rot.z = trans_child->rot[3];
-            rot = s64quat_mul(rotdiff, rot);
-            trans_child->rot[0] = rot.w;
-            trans_child->rot[1] = rot.x;
-            trans_child->rot[2] = rot.y;
-            trans_child->rot[3] = rot.z;
+            }
+            *(*glistp)++ = *dl;
         }
     }
-}
+#else
+    /*==============================
+        s64mtx_compose
+        Builds a mesh's matrix from its rotation, scale, and
+        translation, already multiplied with the modelview
+        matrix that the model is being drawn with
+        @param The transform to use
+        @param Whether the mesh is a billboard
+        @param The matrix to fill
+    ==============================*/
+
+    static inline void s64mtx_compose(const s64Transform* fdata, u8 billboard, f32 dest[4][4])
+    {
+        int i, j;
+        f32 r[3][3];
+        s64mtx_trsrows(fdata, billboard, r);
+        
+        // The mesh matrix's last column is always (0, 0, 0, 1), so skip multiplying with it
+        for (j=0; j<4; j++)
+        {
+            for (i=0; i<3; i++)
+                dest[i][j] = r[i][0]*s64_basemtx[0][j] + r[i][1]*s64_basemtx[1][j] + r[i][2]*s64_basemtx[2][j];
+            dest[3][j] = fdata->pos[0]*s64_basemtx[0][j] + fdata->pos[1]*s64_basemtx[1][j] + fdata->pos[2]*s64_basemtx[2][j] + s64_basemtx[3][j];
+        }
+    }
+    
+    
+    /*==============================
+        sausage64_restorebase
+        Reloads the modelview matrix that the model is being
+        drawn with, if a mesh's matrix replaced it
+    ==============================*/
+
+    static inline void sausage64_restorebase()
+    {
+        if (s64_mtxloaded)
+        {
+            glLoadMatrixf(&s64_basemtx[0][0]);
+            s64_mtxloaded = FALSE;
+        }
+    }
+    
+    
+    /*==============================
+        sausage64_scalepackeduvs
+        Scales the texture matrix so that the fixed point
+        UVs of packed vertices end up in texture space
+        @param  Whether the vertices that are going to be
+                drawn are packed
+        @return Whether the texture matrix was changed
+    ==============================*/
+
+    static inline u8 sausage64_scalepackeduvs(u8 packed)
+    {
+        if (!packed)
+            return FALSE;
+        glMatrixMode(GL_TEXTURE);
+        glPushMatrix();
+        glScalef(1/S64_PACKEDUVSCALE, 1/S64_PACKEDUVSCALE, 1);
+        glMatrixMode(GL_MODELVIEW);
+        return TRUE;
+    }
+    
+    
+    /*==============================
+        sausage64_unscalepackeduvs
+        Restores the texture matrix changed by
+        sausage64_scalepackeduvs
+    ==============================*/
+
+    static inline void sausage64_unscalepackeduvs()
+    {
+        glMatrixMode(GL_TEXTURE);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+    }
+    
+    
+    /*==============================
+        sausage64_drawgfx
+        Draws each render block of a mesh, loading its
+        material first
+        @param The mesh's display list data
+    ==============================*/
+
+    static inline void sausage64_drawgfx(const s64Gfx* dl)
+    {
+        u32 i;
+        for (i=0; i<dl->blockcount; i++)
+        {
+            if (dl->renders[i].material != NULL)
+                sausage64_loadmaterial(dl->renders[i].material);
+            glCallList(dl->guid_mdl + i);
+        }
+        S64_PROFILE_ADD(gfxcommands, dl->blockcount);
+    }
+#endif
+
+
+#ifndef LIBDRAGON
+    /*==============================
+        sausage64_select_matrices
+        Picks the set of matrices a model helper builds into
+        while it is drawn. The first draw of every frame uses
+        that frame's set, and any more draws in the same frame
+        use the extra sets after it. If a game never calls
+        sausage64_next_frame, every draw is treated as a new
+        frame instead, which is only right for helpers that are
+        drawn once per frame
+        @param  The model helper to use
+        @return Whether the helper has a free set of matrices
+                left this frame
+    ==============================*/
+
+    static inline u8 sausage64_select_matrices(s64ModelHelper* mdl)
+    {
+        // Fallback for games that don't call sausage64_next_frame
+        if (!s64_framestarted)
+        {
+            mdl->matrixframe = (mdl->matrixframe+1)%S64_MATRIXBUFFERS;
+            mdl->matrixdraw = 0;
+            return TRUE;
+        }
+        if (mdl->matrixtick != s64_frame)
+        {
+            mdl->matrixtick = s64_frame;
+            mdl->matrixframe = s64_frameset;
+            mdl->matrixdraw = 0;
+            return TRUE;
+        }
+        
+        // Reusing a set would overwrite matrices the RSP hasn't read yet, so raise S64_MATRIXDRAWS instead
+        assert(mdl->matrixdraw+1 < S64_MATRIXDRAWS);
+        if (mdl->matrixdraw+1 >= S64_MATRIXDRAWS)
+            return FALSE;
+        mdl->matrixdraw++;
+        return TRUE;
+    }
+#endif
 
 
 /*==============================
@@ -2044,56 +4626,170 @@ void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amoun
 ==============================*/
 
 #ifndef LIBDRAGON
-    static inline void sausage64_drawpart(Gfx** glistp, s64ModelHelper* helper, u16 mesh)
+    static inline void sausage64_drawpart(Gfx** glistp, const Gfx* dl, s64ModelHelper* helper, u16 mesh)
     {
-        f32 helper1[4][4];
-        f32 helper2[4][4];
         s64Transform* fdata = &helper->transforms[mesh].data;
+        Mtx* matrix = &helper->matrix[(helper->matrixframe*S64_MATRIXDRAWS + helper->matrixdraw)*helper->mdldata->meshcount + mesh];
+        S64_PROFILE_BEGIN(drawpart);
         
-        // Combine the translation and scale matrix
-        guTranslateF(helper1, fdata->pos[0], fdata->pos[1], fdata->pos[2]);
-        guScaleF(helper2, fdata->scale[0], fdata->scale[1], fdata->scale[2]);
-        guMtxCatF(helper2, helper1, helper1);
+        // If we were given a model to view matrix, load a fully composed matrix instead of using the matrix stack
+        if (helper->absolute)
+        {
+            s64mtx_fromtrs(fdata, helper->mdldata->meshes[mesh].is_billboard, helper->modelview, matrix);
+            gSPMatrix((*glistp)++, OS_K0_TO_PHYSICAL(matrix), G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH);
+            sausage64_drawgfx(glistp, helper->mdldata, dl);
+            S64_PROFILE_END(drawpart);
+            return;
+        }
         
-        // Combine the rotation matrix
-        if (!helper->mdldata->meshes[mesh].is_billboard)
+        // Build the mesh's matrix, or copy the one another helper sharing this pose already built
+        if (helper->_poseid != 0 && !helper->mdldata->meshes[mesh].is_billboard)
         {
-            s64Quat q = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
-            s64quat_to_mtx(q, helper2);
+            const s64PoseCache* cache = helper->mdldata->_posecache;
+            if (cache != NULL && helper->_poseentry < cache->count && cache->entries[helper->_poseentry].id == helper->_poseid)
+            {
+                s64PoseEntry* entry = &cache->entries[helper->_poseentry];
+                if (!entry->mtxvalid[mesh])
+                {
+                    s64mtx_fromtrs(fdata, FALSE, NULL, &entry->matrix[mesh]);
+                    entry->mtxvalid[mesh] = TRUE;
+                }
+                *matrix = entry->matrix[mesh];
+            }
+            else
+                s64mtx_fromtrs(fdata, FALSE, NULL, matrix);
+        }
+        else
+            s64mtx_fromtrs(fdata, helper->mdldata->meshes[mesh].is_billboard, NULL, matrix);
+        
+        // Draw the body part
+        gSPMatrix((*glistp)++, OS_K0_TO_PHYSICAL(matrix), G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
+        sausage64_drawgfx(glistp, helper->mdldata, dl);
+        gSPPopMatrix((*glistp)++, G_MTX_MODELVIEW);
+        S64_PROFILE_END(drawpart);
+    }
+#else
+    static inline void sausage64_drawpart(const s64Gfx* dl, s64ModelHelper* mdl, u16 mesh)
+    {
+        f32 matrix[4][4];
+        S64_PROFILE_BEGIN(drawpart);
+        
+        // Load the mesh's fully composed matrix, instead of pushing and multiplying the matrix stack
+        s64mtx_compose(&mdl->transforms[mesh].data, mdl->mdldata->meshes[mesh].is_billboard, matrix);
+        glLoadMatrixf(&matrix[0][0]);
+        s64_mtxloaded = TRUE;
+
+        // Draw the body part
+        sausage64_drawgfx(dl);
+        S64_PROFILE_END(drawpart);
+    }
+#endif
+
+
+#ifndef LIBDRAGON
+    /*==============================
+        sausage64_build_instancedls
+        Builds the display lists that restore the render state
+        each mesh expects to start with (which it might have
+        inherited from the previous mesh) before running the
+        whole mesh display list. These are used when the
+        previous mesh was culled, and to draw every instance of
+        a mesh after the first one. For instances, meshes that
+        only use one material skip straight to the geometry
+        @param The model data to build the display lists for
+    ==============================*/
+
+    static void sausage64_build_instancedls(s64ModelData* mdldata)
+    {
+        u16 i;
+        int j, k;
+        const Gfx* othermodes[4] = {NULL, NULL, NULL, NULL};
+        const Gfx* geomodes[2] = {NULL, NULL};
+        const Gfx* combine = NULL;
+        const Gfx* primcolor = NULL;
+        const Gfx* texload = NULL;
+        Gfx* instancedls = (Gfx*)s64alloc(sizeof(Gfx)*S64_INSTANCEDL_SIZE*mdldata->meshcount);
+        if (instancedls == NULL)
+            return;
+        for (i=0; i<mdldata->meshcount; i++)
+        {
+            const Gfx* dl = mdldata->meshes[i].dl;
+            Gfx* cmd = &instancedls[i*S64_INSTANCEDL_SIZE];
+            int geomstart = -1;
+            u8 multimat = FALSE;
+            
+            // Restore the render state that was set when the previous mesh finished, and then run the whole mesh
+            gDPPipeSync(cmd++);
+            for (k=0; k<4; k++)
+                if (othermodes[k] != NULL)
+                    *cmd++ = *othermodes[k];
+            if (combine != NULL)
+                *cmd++ = *combine;
+            for (k=0; k<2; k++)
+                if (geomodes[k] != NULL)
+                    *cmd++ = *geomodes[k];
+            if (primcolor != NULL)
+                *cmd++ = *primcolor;
+            if (texload != NULL)
+                for (k=0; k<7; k++)
+                    *cmd++ = texload[k];
+            gSPBranchList(cmd, dl);
+            
+            // Go through the mesh's display list, keeping track of the last command to set each part of the render state
+            for (j=0; (dl[j].words.w0 >> 24) != G_ENDDL; j++)
+            {
+                u32 w0 = dl[j].words.w0;
+                switch (w0 >> 24)
+                {
+                    case G_VTX:
+                    case G_TRI1:
+                    case G_TRI2:
+                        if (geomstart == -1)
+                            geomstart = j;
+                        continue;
+                    case G_SETOTHERMODE_H:
+                    case G_SETOTHERMODE_L:
+                        for (k=0; k<4 && othermodes[k] != NULL && othermodes[k]->words.w0 != w0; k++)
+                            ;
+                        if (k < 4)
+                            othermodes[k] = &dl[j];
+                        break;
+                    case G_GEOMODE:
+                        geomodes[0] = geomodes[1];
+                        geomodes[1] = &dl[j];
+                        break;
+                    case G_SETCOMBINE:
+                        combine = &dl[j];
+                        break;
+                    case G_SETPRIMCOLOR:
+                        primcolor = &dl[j];
+                        break;
+                    case G_SETTIMG:
+                        texload = &dl[j];
+                        j += 6;
+                        break;
+                    default:
+                        continue;
+                }
+                
+                // If the render state changes after the geometry started, then the mesh uses more than one material
+                if (geomstart != -1)
+                    multimat = TRUE;
+            }
+            
+            // Single material meshes can skip straight to the geometry, since the render state won't change between instances
+            if (!multimat && geomstart != -1)
+            {
+                gSPBranchList(&instancedls[(i+1)*S64_INSTANCEDL_SIZE-1], &dl[geomstart]);
+            }
+            else
+            {
+                gSPBranchList(&instancedls[(i+1)*S64_INSTANCEDL_SIZE-1], &instancedls[i*S64_INSTANCEDL_SIZE]);
+            }
         }
-        else
-            s64calc_billboard(helper2);
-        guMtxCatF(helper2, helper1, helper1);
-        
-        // Draw the body part
-        guMtxF2L(helper1, &helper->matrix[mesh]);
-        gSPMatrix((*glistp)++, OS_K0_TO_PHYSICAL(&helper->matrix[mesh]), G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
-        gSPDisplayList((*glistp)++, helper->mdldata->meshes[mesh].dl);
-        gSPPopMatrix((*glistp)++, G_MTX_MODELVIEW);
-    }
-#else
-    static inline void sausage64_drawpart(const s64Gfx* dl, s64ModelHelper* mdl, u16 mesh)
-    {
-        f32 helper1[4][4];
-        s64Transform* fdata = &mdl->transforms[mesh].data;
-    
-        // Push a new matrix
-        glPushMatrix();
-        
-        // Combine the translation and scale matrix
-        glTranslatef(fdata->pos[0], fdata->pos[1], fdata->pos[2]);
-        glScalef(fdata->scale[0], fdata->scale[1], fdata->scale[2]);
-
-        // Combine the rotation matrix
-        if (mdl->mdldata->meshes[mesh].is_billboard)
-            s64calc_billboard(helper1, mdl, mesh);
-        s64Quat q = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
-        s64quat_to_mtx(q, helper1);
-        glMultMatrixf(&helper1[0][0]);
-
-        // Draw the body part
-        glCallList(dl->guid_mdl);
-        glPopMatrix();
+        mdldata->_instancedls = instancedls;
+        mdldata->_memsize += sizeof(Gfx)*S64_INSTANCEDL_SIZE*mdldata->meshcount;
+        S64_PROFILE_ADD(model_bytes, sizeof(Gfx)*S64_INSTANCEDL_SIZE*mdldata->meshcount);
     }
 #endif
 
@@ -2110,49 +4806,104 @@ void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amoun
     void sausage64_drawmodel(Gfx** glistp, s64ModelHelper* mdl)
     {
         u16 i;
-        f32 l = 0, bl = 0;
-        const s64ModelData* mdata = mdl->mdldata;
+        u8 restore = FALSE;
+        s64ModelData* mdata = (s64ModelData*)mdl->mdldata;
         const u16 mcount = mdata->meshcount;
         const s64Animation* anim = mdl->curanim.animdata;
-    
-        // If we have a valid animation, get the lerp value
-        if (anim != NULL)
+        S64_PROFILE_GFXBEGIN(glistp);
+        
+        // Skip the whole model if it's outside of the camera's view
+        if (!sausage64_model_visible(mdl))
+        {
+            s64_cullstats.models_culled++;
+            mdl->rendercount++;
+            return;
+        }
+        
+        // Skip it if it's been drawn more times this frame than it has matrices for
+        if (!sausage64_select_matrices(mdl))
         {
-            l = sausage64_calcanimlerp(&mdl->curanim);
-            if (mdl->blendticks_left > 0)
-                bl = sausage64_calcanimlerp(&mdl->blendanim);
+            mdl->rendercount++;
+            return;
         }
+        s64_cullstats.models_drawn++;
+    
+        // If we have a valid animation, make sure the pose has been calculated
+        if (anim != NULL && mdl->poserendercount != mdl->rendercount)
+            sausage64_evaluate_pose(mdl);
+        
+        // Culled meshes might have set up render state that the next mesh relies on, so we need the display lists which restore it
+        // Meshes which call material display lists set up all of their own render state, so they don't need them
+        if (mdl->cull && mdata->_instancedls == NULL && mdata->_matdls == NULL)
+            sausage64_build_instancedls(mdata);
         
         // Iterate through each mesh
         for (i=0; i<mcount; i++)
         {
-            // Call the pre draw function
+            const Gfx* dl = mdata->meshes[i].dl;
+            const Gfx* lod = dl;
+            
+            // Skip meshes that are outside of the camera's view, and pick the LOD for the rest
+            if (mdl->cull && (mdata->_instancedls != NULL || mdata->_matdls != NULL))
+            {
+                f32 sphere[4];
+                if (!sausage64_mesh_visible(mdl, i, sphere))
+                {
+                    s64_cullstats.meshes_culled++;
+                    restore = TRUE;
+                    continue;
+                }
+                lod = sausage64_select_lod(mdl, i, sphere);
+            }
+            
+            // Call the pre draw function. If it added to the display list, then it might have changed the render state
             if (mdl->predraw != NULL)
-                if (!mdl->predraw(i))
+            {
+                Gfx* prevglistp = *glistp;
+                u8 draw = mdl->predraw(i);
+                if (*glistp != prevglistp)
+                    sausage64_reset_rdpstate();
+                if (!draw)
                     continue;
+            }
             
-            // Draw this part of the model
-            if (anim != NULL)
+            // Draw this part of the model. LODs set up all of their own render state, but might leave it different to the full mesh
+            if (lod != dl)
+            {
+                dl = lod;
+                restore = TRUE;
+            }
+            else if (restore)
             {
-                sausage64_calcanimtransforms(mdl, i, l, bl);
-                sausage64_drawpart(glistp, mdl, i);
+                if (mdata->_matdls == NULL)
+                    dl = &mdata->_instancedls[i*S64_INSTANCEDL_SIZE];
+                restore = FALSE;
             }
+            if (anim != NULL)
+                sausage64_drawpart(glistp, dl, mdl, i);
             else
-                gSPDisplayList((*glistp)++, mdata->meshes[i].dl);
+                sausage64_drawgfx(glistp, mdata, dl);
+            s64_cullstats.meshes_drawn++;
         
             // Call the post draw function
             if (mdl->postdraw != NULL)
+            {
+                Gfx* prevglistp = *glistp;
                 mdl->postdraw(i);
+                if (*glistp != prevglistp)
+                    sausage64_reset_rdpstate();
+            }
         }
 
         // Increment the render count for transform calculations
         mdl->rendercount++;
+        S64_PROFILE_GFXEND(glistp);
     }
 #else
     void sausage64_drawmodel(s64ModelHelper* mdl)
     {
         u16 i;
-        f32 l = 0, bl = 0;
+        u8 scaleduvs;
         const s64ModelData* mdata = mdl->mdldata;
         const u16 mcount = mdata->meshcount;
         const s64Animation* anim = mdl->curanim.animdata;
@@ -2163,13 +4914,14 @@ void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amoun
         glEnableClientState(GL_NORMAL_ARRAY);
         glEnableClientState(GL_COLOR_ARRAY);
     
-        // If we have a valid animation, get the lerp value
+        // If we have a valid animation, make sure the pose has been calculated
+        if (anim != NULL && mdl->poserendercount != mdl->rendercount)
+            sausage64_evaluate_pose(mdl);
+        
+        // Meshes load their own matrices, so remember the one the model is being drawn with
         if (anim != NULL)
-        {
-            l = sausage64_calcanimlerp(&mdl->curanim);
-            if (mdl->blendticks_left > 0)
-                bl = sausage64_calcanimlerp(&mdl->blendanim);
-        }
+            glGetFloatv(GL_MODELVIEW_MATRIX, &s64_basemtx[0][0]);
+        scaleduvs = sausage64_scalepackeduvs(mdata->meshcount > 0 && mdata->meshes[0].dl->packed);
         
         // Iterate through each mesh
         for (i=0; i<mcount; i++)
@@ -2178,28 +4930,492 @@ void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amoun
             
             // Call the pre draw function
             if (mdl->predraw != NULL)
+            {
+                sausage64_restorebase();
                 if (!mdl->predraw(i))
                     continue;
+            }
             
             // Draw this part of the model
             if (anim != NULL)
-            {
-                sausage64_calcanimtransforms(mdl, i, l, bl);
                 sausage64_drawpart(dl, mdl, i);
-            }
             else
-                glCallList(dl->guid_mdl);
+                sausage64_drawgfx(dl);
         
             // Call the post draw function
             if (mdl->postdraw != NULL)
+            {
+                sausage64_restorebase();
                 mdl->postdraw(i);
+            }
+        }
+        sausage64_restorebase();
+        if (scaleduvs)
+            sausage64_unscalepackeduvs();
+
+        // Increment the render count for transform calculations
+        mdl->rendercount++;
+    }
+#endif
+
+
+#ifndef LIBDRAGON
+    /*==============================
+        sausage64_drawinstances
+        Renders many instances of the same Sausage64 model,
+        going mesh by mesh so that the render state of each
+        mesh is only set up once for all the instances
+        @param A pointer to a display list pointer
+        @param The list of model helpers, which must all use
+               the same model data
+        @param The number of model helpers
+    ==============================*/
+
+    void sausage64_drawinstances(Gfx** glistp, s64ModelHelper** helpers, u32 count)
+    {
+        u16 i;
+        u32 j;
+        u8 restore;
+        s64ModelData* mdata;
+        S64_PROFILE_GFXBEGIN(glistp);
+        if (count == 0)
+            return;
+        mdata = (s64ModelData*)helpers[0]->mdldata;
+        
+        // Build the instancing display lists if they haven't been yet. Meshes which call material display lists don't need them
+        if (mdata->_instancedls == NULL && mdata->_matdls == NULL)
+            sausage64_build_instancedls(mdata);
+        if (mdata->_instancedls == NULL && mdata->_matdls == NULL)
+        {
+            for (j=0; j<count; j++)
+                sausage64_drawmodel(glistp, helpers[j]);
+            return;
+        }
+        
+        // Skip the instances that are outside of the camera's view, and make sure the poses of the rest have been calculated
+        for (j=0; j<count; j++)
+        {
+            s64ModelHelper* mdl = helpers[j];
+            mdl->visible = sausage64_model_visible(mdl);
+            if (!mdl->visible)
+            {
+                s64_cullstats.models_culled++;
+                continue;
+            }
+            mdl->visible = sausage64_select_matrices(mdl);
+            if (mdl->visible)
+                s64_cullstats.models_drawn++;
+        }
+        sausage64_evaluate_batch(helpers, count, TRUE);
+        
+        // Draw each mesh of every instance
+        restore = FALSE;
+        for (i=0; i<mdata->meshcount; i++)
+        {
+            const Gfx* dl = mdata->meshes[i].dl;
+            
+            // The first instance of every mesh after the first restores the render state the previous mesh's display list leaves behind.
+            // This is always done, since the previous mesh could have been culled in every instance, or its state changed by a predraw or postdraw
+            if (restore && mdata->_matdls == NULL)
+                dl = &mdata->_instancedls[i*S64_INSTANCEDL_SIZE];
+            restore = TRUE;
+            for (j=0; j<count; j++)
+            {
+                s64ModelHelper* mdl = helpers[j];
+                const Gfx* lod = NULL;
+                
+                // Skip meshes that are outside of the camera's view, and pick the LOD for the rest
+                if (!mdl->visible)
+                    continue;
+                if (mdl->cull)
+                {
+                    f32 sphere[4];
+                    if (!sausage64_mesh_visible(mdl, i, sphere))
+                    {
+                        s64_cullstats.meshes_culled++;
+                        continue;
+                    }
+                    lod = sausage64_select_lod(mdl, i, sphere);
+                    if (lod == mdata->meshes[i].dl)
+                        lod = NULL;
+                }
+                
+                // Call the pre draw function. If it added to the display list, then it might have changed the render state
+                if (mdl->predraw != NULL)
+                {
+                    Gfx* prevglistp = *glistp;
+                    u8 draw = mdl->predraw(i);
+                    if (*glistp != prevglistp)
+                        sausage64_reset_rdpstate();
+                    if (!draw)
+                        continue;
+                }
+                
+                // Draw this part of the model. After the first instance, the render state is already set up
+                if (lod == NULL)
+                    lod = dl;
+                if (mdl->curanim.animdata != NULL)
+                    sausage64_drawpart(glistp, lod, mdl, i);
+                else
+                    sausage64_drawgfx(glistp, mdata, lod);
+                if (mdata->_matdls == NULL)
+                    dl = &mdata->_instancedls[(i+1)*S64_INSTANCEDL_SIZE-1];
+                s64_cullstats.meshes_drawn++;
+            
+                // Call the post draw function
+                if (mdl->postdraw != NULL)
+                {
+                    Gfx* prevglistp = *glistp;
+                    mdl->postdraw(i);
+                    if (*glistp != prevglistp)
+                        sausage64_reset_rdpstate();
+                }
+            }
+        }
+        
+        // Increment the render counts for transform calculations
+        for (j=0; j<count; j++)
+            helpers[j]->rendercount++;
+        S64_PROFILE_GFXEND(glistp);
+    }
+#else
+    /*==============================
+        sausage64_drawinstances
+        Renders many instances of the same Sausage64 model,
+        going mesh by mesh so that the render state of each
+        mesh is only set up once for all the instances
+        @param The list of model helpers, which must all use
+               the same model data
+        @param The number of model helpers
+    ==============================*/
+
+    void sausage64_drawinstances(s64ModelHelper** helpers, u32 count)
+    {
+        u16 i;
+        u32 j;
+        u8 scaleduvs;
+        const s64ModelData* mdata;
+        if (count == 0)
+            return;
+        mdata = helpers[0]->mdldata;
+        
+        // Initialize OpenGL state
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        
+        // Make sure all the poses have been calculated
+        sausage64_evaluate_batch(helpers, count, TRUE);
+        
+        // Meshes load their own matrices, so remember the one the models are being drawn with
+        glGetFloatv(GL_MODELVIEW_MATRIX, &s64_basemtx[0][0]);
+        scaleduvs = sausage64_scalepackeduvs(mdata->meshcount > 0 && mdata->meshes[0].dl->packed);
+        
+        // Draw each mesh of every instance
+        for (i=0; i<mdata->meshcount; i++)
+        {
+            const s64Gfx* dl = mdata->meshes[i].dl;
+            for (j=0; j<count; j++)
+            {
+                s64ModelHelper* mdl = helpers[j];
+                
+                // Call the pre draw function
+                if (mdl->predraw != NULL)
+                {
+                    sausage64_restorebase();
+                    if (!mdl->predraw(i))
+                        continue;
+                }
+                
+                // Draw this part of the model
+                if (mdl->curanim.animdata != NULL)
+                    sausage64_drawpart(dl, mdl, i);
+                else
+                {
+                    sausage64_restorebase();
+                    sausage64_drawgfx(dl);
+                }
+            
+                // Call the post draw function
+                if (mdl->postdraw != NULL)
+                {
+                    sausage64_restorebase();
+                    mdl->postdraw(i);
+                }
+            }
+        }
+        sausage64_restorebase();
+        if (scaleduvs)
+            sausage64_unscalepackeduvs();
+        
+        // Increment the render counts for transform calculations
+        for (j=0; j<count; j++)
+            helpers[j]->rendercount++;
+    }
+#endif
+
+
+#ifdef LIBDRAGON
+    /*==============================
+        sausage64_queue_reserve
+        Makes sure the draw queue has space for more
+        render blocks and matrices
+        @param  The number of render blocks to add
+        @param  The number of matrices to add
+        @return Whether the space could be allocated
+    ==============================*/
+
+    static u8 sausage64_queue_reserve(u32 entries, u32 matrices)
+    {
+        if (s64_queuecount + entries > s64_queuesize)
+        {
+            u32 size = s64_queuesize*2;
+            s64QueueEntry* queue;
+            if (size < s64_queuecount + entries)
+                size = s64_queuecount + entries;
+            queue = (s64QueueEntry*)s64alloc(sizeof(s64QueueEntry)*size);
+            if (queue == NULL)
+                return FALSE;
+            if (s64_queue != NULL)
+            {
+                memcpy(queue, s64_queue, sizeof(s64QueueEntry)*s64_queuecount);
+                s64free(s64_queue);
+            }
+            s64_queue = queue;
+            s64_queuesize = size;
+        }
+        if (s64_queuemtxcount + matrices > s64_queuemtxsize)
+        {
+            u32 size = s64_queuemtxsize*2;
+            f32 (*queuemtx)[4][4];
+            if (size < s64_queuemtxcount + matrices)
+                size = s64_queuemtxcount + matrices;
+            queuemtx = (f32(*)[4][4])s64alloc(sizeof(f32)*16*size);
+            if (queuemtx == NULL)
+                return FALSE;
+            if (s64_queuemtx != NULL)
+            {
+                memcpy(queuemtx, s64_queuemtx, sizeof(f32)*16*s64_queuemtxcount);
+                s64free(s64_queuemtx);
+            }
+            s64_queuemtx = queuemtx;
+            s64_queuemtxsize = size;
+        }
+        return TRUE;
+    }
+    
+    
+    /*==============================
+        sausage64_queue_compare
+        Orders two queued render blocks so that the ones
+        which share OpenGL state end up next to each other
+        @param  The first queued render block
+        @param  The second queued render block
+        @return Negative if the first one goes first,
+                positive if the second one does
+    ==============================*/
+
+    static int sausage64_queue_compare(const void* a, const void* b)
+    {
+        const s64QueueEntry* e1 = (const s64QueueEntry*)a;
+        const s64QueueEntry* e2 = (const s64QueueEntry*)b;
+        const s64Material* m1 = e1->material;
+        const s64Material* m2 = e2->material;
+        
+        // Packed vertices need the texture matrix scaled, so keep them together
+        if (e1->packed != e2->packed)
+            return e1->packed - e2->packed;
+        
+        // Blocks without a material use whatever is loaded, so draw them first
+        if (m1 != m2)
+        {
+            if (m1 == NULL || m2 == NULL)
+                return (m1 == NULL) ? -1 : 1;
+            if (m1->type != m2->type)
+                return m1->type - m2->type;
+            if (m1->type == TYPE_TEXTURE)
+            {
+                const GLuint t1 = *((s64Texture*)m1->data)->identifier;
+                const GLuint t2 = *((s64Texture*)m2->data)->identifier;
+                if (t1 != t2)
+                    return (t1 < t2) ? -1 : 1;
+            }
+            if (m1->lighting != m2->lighting)
+                return m1->lighting - m2->lighting;
+            if (m1->cullfront != m2->cullfront)
+                return m1->cullfront - m2->cullfront;
+            if (m1->cullback != m2->cullback)
+                return m1->cullback - m2->cullback;
+            if (m1->depthtest != m2->depthtest)
+                return m1->depthtest - m2->depthtest;
+            if (m1->smooth != m2->smooth)
+                return m1->smooth - m2->smooth;
+            return (m1 < m2) ? -1 : 1;
         }
+        
+        // Keep blocks that share a matrix together, in the order they were queued
+        if (e1->matrix != e2->matrix)
+            return (e1->matrix < e2->matrix) ? -1 : 1;
+        return (e1->list < e2->list) ? -1 : (e1->list > e2->list);
+    }
+
+
+    /*==============================
+        sausage64_queue_model
+        Adds a Sausage64 model to the draw queue, using the
+        current modelview matrix. Nothing is drawn until
+        sausage64_draw_queue is called. The predraw function
+        is called right away and can still skip meshes or
+        load a material, but the postdraw function is not
+        called for queued models
+        @param  The model helper data
+        @return Whether the model could be queued
+    ==============================*/
 
+    u8 sausage64_queue_model(s64ModelHelper* mdl)
+    {
+        u16 i;
+        u32 j, entries = 0, basematrix = 0;
+        const s64ModelData* mdata = mdl->mdldata;
+        const u16 mcount = mdata->meshcount;
+        const s64Animation* anim = mdl->curanim.animdata;
+        s64Material* curmat = s64_glstate.material;
+        
+        // Make sure there's space for every render block and matrix of the model
+        for (i=0; i<mcount; i++)
+            entries += mdata->meshes[i].dl->blockcount;
+        if (!sausage64_queue_reserve(entries, (anim != NULL) ? mcount : 1))
+            return FALSE;
+        
+        // If we have a valid animation, make sure the pose has been calculated
+        if (anim != NULL && mdl->poserendercount != mdl->rendercount)
+            sausage64_evaluate_pose(mdl);
+        
+        // Meshes are drawn later, so store their matrices now
+        glGetFloatv(GL_MODELVIEW_MATRIX, &s64_basemtx[0][0]);
+        if (anim == NULL)
+        {
+            basematrix = s64_queuemtxcount++;
+            memcpy(s64_queuemtx[basematrix], s64_basemtx, sizeof(s64_basemtx));
+        }
+        
+        // Queue the render blocks of each mesh
+        for (i=0; i<mcount; i++)
+        {
+            const s64Gfx* dl = mdata->meshes[i].dl;
+            u32 matrix = basematrix;
+            
+            // Call the pre draw function, and keep track of any material it loads
+            if (mdl->predraw != NULL)
+            {
+                s64Material* prevmat = s64_glstate.material;
+                s64_glstate.material = NULL;
+                if (!mdl->predraw(i))
+                {
+                    s64_glstate.material = prevmat;
+                    continue;
+                }
+                if (s64_glstate.material != NULL)
+                    curmat = s64_glstate.material;
+                else
+                    s64_glstate.material = prevmat;
+            }
+            
+            // Build the mesh's matrix
+            if (anim != NULL)
+            {
+                matrix = s64_queuemtxcount++;
+                s64mtx_compose(&mdl->transforms[i].data, mdata->meshes[i].is_billboard, s64_queuemtx[matrix]);
+            }
+            
+            // Blocks without a material are drawn with the one that would've been loaded before them
+            for (j=0; j<dl->blockcount; j++)
+            {
+                s64QueueEntry* entry = &s64_queue[s64_queuecount++];
+                if (dl->renders[j].material != NULL)
+                    curmat = dl->renders[j].material;
+                entry->material = curmat;
+                entry->list = dl->guid_mdl + j;
+                entry->matrix = matrix;
+                entry->packed = dl->packed;
+            }
+        }
+        
         // Increment the render count for transform calculations
         mdl->rendercount++;
+        return TRUE;
+    }
+
+
+    /*==============================
+        sausage64_draw_queue
+        Draws everything in the draw queue, sorted by
+        material, and then empties it
+    ==============================*/
+
+    void sausage64_draw_queue()
+    {
+        u32 i, lastmatrix = 0xFFFFFFFF;
+        u8 scaleduvs = FALSE;
+        if (s64_queuecount == 0)
+        {
+            s64_queuemtxcount = 0;
+            return;
+        }
+        
+        // Initialize OpenGL state
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glGetFloatv(GL_MODELVIEW_MATRIX, &s64_basemtx[0][0]);
+        
+        // Sort the render blocks so that each material is loaded as few times as possible
+        qsort(s64_queue, s64_queuecount, sizeof(s64QueueEntry), sausage64_queue_compare);
+        for (i=0; i<s64_queuecount; i++)
+        {
+            const s64QueueEntry* entry = &s64_queue[i];
+            if (entry->packed && !scaleduvs)
+                scaleduvs = sausage64_scalepackeduvs(TRUE);
+            if (entry->material != NULL)
+                sausage64_loadmaterial(entry->material);
+            if (entry->matrix != lastmatrix)
+            {
+                glLoadMatrixf(&s64_queuemtx[entry->matrix][0][0]);
+                lastmatrix = entry->matrix;
+                s64_mtxloaded = TRUE;
+            }
+            glCallList(entry->list);
+        }
+        S64_PROFILE_ADD(gfxcommands, s64_queuecount);
+        sausage64_restorebase();
+        if (scaleduvs)
+            sausage64_unscalepackeduvs();
+        
+        // Empty the queue, but keep its memory around for the next frame
+        s64_queuecount = 0;
+        s64_queuemtxcount = 0;
+    }
+
 
-        // Remove the last material to prevent the material state from getting stuck
-        s64_lastmat = NULL;
+    /*==============================
+        sausage64_free_queue
+        Frees the memory used up by the draw queue
+    ==============================*/
+
+    void sausage64_free_queue()
+    {
+        if (s64_queue != NULL)
+            s64free(s64_queue);
+        if (s64_queuemtx != NULL)
+            s64free(s64_queuemtx);
+        s64_queue = NULL;
+        s64_queuemtx = NULL;
+        s64_queuecount = 0;
+        s64_queuesize = 0;
+        s64_queuemtxcount = 0;
+        s64_queuemtxsize = 0;
     }
 #endif
 
@@ -2211,9 +5427,74 @@ void sausage64_lookat(s64ModelHelper* mdl, const u16 mesh, f32 dir[3], f32 amoun
 
 void sausage64_freehelper(s64ModelHelper* helper)
 {
-    free(helper->transforms);
+    S64_PROFILE_SUB(helper_bytes, sausage64_get_helpermemory(helper));
+    if (helper->transforms != NULL)
+        s64free(helper->transforms);
+    if (helper->layers != NULL)
+        s64free(helper->layers);
+    if (helper->meshorder != NULL && helper->meshorder != helper->mdldata->_meshorder)
+        s64free(helper->meshorder);
+    #ifndef LIBDRAGON
+        if (helper->matrix != NULL)
+            s64free(helper->matrix);
+    #endif
+    s64free(helper);
+}
+
+
+/*==============================
+    sausage64_get_helpermemory
+    Get how many bytes of heap a model helper is holding
+    @param  The model helper pointer
+    @return The number of bytes used
+==============================*/
+
+u32 sausage64_get_helpermemory(const s64ModelHelper* helper)
+{
+    const u16 mcount = helper->mdldata->meshcount;
+    u32 size = sizeof(s64ModelHelper) + sizeof(s64FrameTransform)*mcount + sizeof(s64AnimLayer)*helper->layercount;
+    if (helper->meshorder != NULL && helper->meshorder != helper->mdldata->_meshorder)
+        size += sizeof(u16)*mcount*3;
     #ifndef LIBDRAGON
-        free(helper->matrix);
+        size += sizeof(Mtx)*mcount*S64_MATRIXBUFFERS*S64_MATRIXDRAWS;
+    #endif
+    return size;
+}
+
+
+/*==============================
+    sausage64_get_stats
+    Gets the profiling counters collected since the last
+    time they were reset, along with how much heap the
+    loaded binary models and the model helpers are holding.
+    The counters stay at zero unless S64_PROFILE is defined
+    @param The struct to fill with the statistics
+==============================*/
+
+void sausage64_get_stats(s64Stats* stats)
+{
+    #ifdef S64_PROFILE
+        *stats = s64_stats;
+    #else
+        memset(stats, 0, sizeof(s64Stats));
+    #endif
+}
+
+
+/*==============================
+    sausage64_reset_stats
+    Resets the profiling cycle, call, and display list
+    command counters back to zero. The heap usage is
+    left alone
+==============================*/
+
+void sausage64_reset_stats()
+{
+    #ifdef S64_PROFILE
+        const u32 model_bytes = s64_stats.model_bytes;
+        const u32 helper_bytes = s64_stats.helper_bytes;
+        memset(&s64_stats, 0, sizeof(s64Stats));
+        s64_stats.model_bytes = model_bytes;
+        s64_stats.helper_bytes = helper_bytes;
     #endif
-    free(helper);
-}
\ No newline at end of file
+}
@@ -369,7 +369,9 @@ void stage00_draw(void)
     if (lookat)
         catherine_lookat();
     
-    // Draw catherine
+    // Draw catherine. The render state was set up by hand above, so Sausage64 can't rely on what it drew last frame
+    sausage64_next_frame();
+    sausage64_reset_rdpstate();
     sausage64_drawmodel(&glistp, catherine);
     
     // Synchronize the RCP and CPU and specify that our display list has ended
@@ -0,0 +1,121 @@
+/***************************************************************
+                            batch.c
+
+Compares the CPU time of animating and drawing helpers one at a
+time against the batched functions, for different numbers of
+helpers playing the sample model's animations:
+ - single:    sausage64_advance_anim and sausage64_drawmodel
+ - batched:   the batched advance and transform calculation,
+              followed by sausage64_drawmodel
+ - instanced: the batched advance, then sausage64_drawinstances
+The single and batched helpers have to end up with the same
+transforms on every frame.
+Usage: batch [frames]
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Macros
+*********************************/
+
+#define MAXHELPERS 128
+#define MODES      3
+
+
+/*********************************
+             Globals
+*********************************/
+
+static const u32 helpercounts[] = {1, 8, 32, MAXHELPERS};
+static const char* modenames[MODES] = {"single", "batched", "instanced"};
+static Gfx glist[262144];
+
+
+/*==============================
+    main
+    Runs the benchmark
+==============================*/
+
+int main(int argc, char** argv)
+{
+    u32 i, j, mode;
+    int frame;
+    const int frames = (argc > 1) ? atoi(argv[1]) : 200;
+    s64ModelData* mdl = test_loadmodel(TEST_MODELPATH);
+    static s64ModelHelper* helpers[MODES][MAXHELPERS];
+
+    printf("%-8s %12s %12s %12s\n", "helpers", modenames[0], modenames[1], modenames[2]);
+    for (i=0; i<sizeof(helpercounts)/sizeof(helpercounts[0]); i++)
+    {
+        const u32 count = helpercounts[i];
+        u64 times[MODES] = {0};
+
+        // Every mode gets its own helpers, all starting from the same state
+        for (mode=0; mode<MODES; mode++)
+        {
+            for (j=0; j<count; j++)
+            {
+                helpers[mode][j] = sausage64_inithelper(mdl);
+                sausage64_set_anim(helpers[mode][j], j%mdl->animcount);
+                sausage64_advance_anim(helpers[mode][j], j*0.37f);
+            }
+        }
+
+        for (frame=0; frame<frames; frame++)
+        {
+            sausage64_next_frame();
+            for (mode=0; mode<MODES; mode++)
+            {
+                Gfx* glistp = glist;
+                s64ModelHelper** list = helpers[mode];
+                u64 start;
+                sausage64_reset_rdpstate();
+                start = test_time();
+                switch (mode)
+                {
+                    case 0:
+                        for (j=0; j<count; j++)
+                        {
+                            sausage64_advance_anim(list[j], 0.5f);
+                            sausage64_drawmodel(&glistp, list[j]);
+                        }
+                        break;
+                    case 1:
+                        sausage64_advance_anim_batch(list, count, 0.5f);
+                        sausage64_calctransforms_batch(list, count);
+                        for (j=0; j<count; j++)
+                            sausage64_drawmodel(&glistp, list[j]);
+                        break;
+                    case 2:
+                        sausage64_advance_anim_batch(list, count, 0.5f);
+                        sausage64_drawinstances(&glistp, list, count);
+                        break;
+                }
+                times[mode] += test_time() - start;
+            }
+
+            // Batching must not change the result
+            for (j=0; j<count; j++)
+            {
+                if (memcmp(helpers[0][j]->transforms, helpers[1][j]->transforms, sizeof(s64FrameTransform)*mdl->meshcount) != 0)
+                {
+                    printf("Helper %d's transforms differ on frame %d with %d helpers\n", j, frame, count);
+                    return 1;
+                }
+            }
+        }
+
+        // Report the time per helper per frame
+        printf("%-8d", count);
+        for (mode=0; mode<MODES; mode++)
+            printf(" %9.1f us", times[mode]/((f64)count*frames*1000));
+        printf("\n");
+        for (mode=0; mode<MODES; mode++)
+            for (j=0; j<count; j++)
+                sausage64_freehelper(helpers[mode][j]);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/***************************************************************
+                          benchmark.c
+
+Times the library's per frame work on the sample model. N helpers
+play different animations for M frames, and the time spent on
+each stage is reported per mesh drawn:
+ - anim eval:    advancing the animations and calculating poses
+ - matrix build: turning each mesh's transform into an Mtx
+ - DL emission:  the rest of drawing the model
+Usage: benchmark [helpers] [frames]
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Globals
+*********************************/
+
+static Gfx glist[65536];
+
+
+/*==============================
+    main
+    Runs the benchmark
+==============================*/
+
+int main(int argc, char** argv)
+{
+    int i, m, frame;
+    u64 t_eval = 0, t_mtx = 0, t_draw = 0;
+    f64 meshes;
+    const int count = (argc > 1) ? atoi(argv[1]) : 32;
+    const int frames = (argc > 2) ? atoi(argv[2]) : 300;
+    s64ModelData* mdl = test_loadmodel(TEST_MODELPATH);
+    s64ModelHelper** helpers = (s64ModelHelper**)malloc(sizeof(s64ModelHelper*)*count);
+    Mtx* scratch = (Mtx*)test_alloc(sizeof(Mtx)*mdl->meshcount);
+
+    // Give every helper a different animation and starting point, so none of them share a pose
+    for (i=0; i<count; i++)
+    {
+        helpers[i] = sausage64_inithelper(mdl);
+        sausage64_set_anim(helpers[i], i%mdl->animcount);
+        sausage64_advance_anim(helpers[i], i*0.37f);
+    }
+
+    for (frame=0; frame<frames; frame++)
+    {
+        Gfx* glistp = glist;
+        u64 t0, t1, t2, t3;
+        sausage64_next_frame();
+        sausage64_reset_rdpstate();
+
+        // Animation
+        t0 = test_time();
+        sausage64_advance_anim_batch(helpers, count, 0.5f);
+        sausage64_calctransforms_batch(helpers, count);
+
+        // Matrices on their own, the same way drawing builds them
+        t1 = test_time();
+        for (i=0; i<count; i++)
+            for (m=0; m<mdl->meshcount; m++)
+                s64mtx_fromtrs(&helpers[i]->transforms[m].data, mdl->meshes[m].is_billboard, NULL, &scratch[m]);
+
+        // Drawing, which builds the matrices again
+        t2 = test_time();
+        for (i=0; i<count; i++)
+            sausage64_drawmodel(&glistp, helpers[i]);
+        t3 = test_time();
+
+        t_eval += t1 - t0;
+        t_mtx += t2 - t1;
+        t_draw += t3 - t2;
+    }
+
+    // Report the time per mesh
+    meshes = (f64)count*frames*mdl->meshcount;
+    printf("%d meshes, %d helpers, %d frames\n", mdl->meshcount, count, frames);
+    printf("anim eval:    %8.1f ns/mesh\n", t_eval/meshes);
+    printf("matrix build: %8.1f ns/mesh\n", t_mtx/meshes);
+    printf("DL emission:  %8.1f ns/mesh\n", (t_draw > t_mtx ? t_draw - t_mtx : 0)/meshes);
+    free(helpers);
+    return 0;
+}
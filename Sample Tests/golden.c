@@ -0,0 +1,108 @@
+/***************************************************************
+                            golden.c
+
+Draws the sample model with a couple of animated helpers and
+prints every display list command and matrix the library makes.
+It also loads the model again in the background, a few steps
+per poll, which has to build the same display lists.
+The Makefile compares the output with golden/catherine.txt, so
+any change to what the library emits shows up as a diff.
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Macros
+*********************************/
+
+#define FRAMES 6
+
+
+/*********************************
+             Globals
+*********************************/
+
+static Gfx glist[8192];
+
+
+/*==============================
+    dump_meshes
+    Prints the display list of every mesh in a model
+    @param The file to print to
+    @param The model to print
+==============================*/
+
+static void dump_meshes(FILE* fp, s64ModelData* mdl)
+{
+    int i;
+    for (i=0; i<mdl->meshcount; i++)
+    {
+        const Gfx* end = mdl->meshes[i].dl;
+        while ((end->words.w0 >> 24) != G_ENDDL)
+            end++;
+        fprintf(fp, "# mesh %d %s\n", i, mdl->meshes[i].name);
+        test_dumpgfx(fp, mdl, mdl->meshes[i].dl, end+1);
+    }
+}
+
+
+/*==============================
+    main
+    Prints the golden output
+==============================*/
+
+int main(int argc, char** argv)
+{
+    int i, frame;
+    s64ModelData* mdl = test_loadmodel(argc > 1 ? argv[1] : TEST_MODELPATH);
+    s64ModelHelper* helpers[2];
+    s64ModelData* polled;
+    s64LoadState* state;
+    u32 polls;
+    FILE* fp[2];
+    char* dump[2];
+    size_t dumpsize;
+
+    // The meshes' own display lists
+    dump_meshes(stdout, mdl);
+
+    // Load it again without ever blocking on DMA, and compare the display lists
+    state = sausage64_load_binarymodel_begin((u32)(uintptr_t)test_rom, test_romsize, test_textures);
+    polls = 1;
+    while (!sausage64_load_binarymodel_poll(state, 1))
+        polls++;
+    polled = sausage64_load_binarymodel_finish(state);
+    fp[0] = open_memstream(&dump[0], &dumpsize);
+    fp[1] = open_memstream(&dump[1], &dumpsize);
+    dump_meshes(fp[0], mdl);
+    dump_meshes(fp[1], polled);
+    fclose(fp[0]);
+    fclose(fp[1]);
+    printf("# background load %s\n", (polls > 1 && !strcmp(dump[0], dump[1])) ? "matches" : "differs");
+    free(dump[0]);
+    free(dump[1]);
+
+    // One helper interpolates a looping animation, the other blends between two
+    helpers[0] = sausage64_inithelper(mdl);
+    helpers[1] = sausage64_inithelper(mdl);
+    sausage64_set_anim(helpers[0], 0);
+    sausage64_set_anim(helpers[1], 1);
+    for (frame=0; frame<FRAMES; frame++)
+    {
+        if (frame == FRAMES/2)
+            sausage64_set_anim_blend(helpers[1], 2, 4);
+        sausage64_next_frame();
+        sausage64_reset_rdpstate();
+        for (i=0; i<2; i++)
+        {
+            Gfx* glistp = glist;
+            sausage64_advance_anim(helpers[i], 0.75f);
+            sausage64_drawmodel(&glistp, helpers[i]);
+            printf("# frame %d helper %d\n", frame, i);
+            test_dumpgfx(stdout, mdl, glist, glistp);
+        }
+    }
+    return 0;
+}
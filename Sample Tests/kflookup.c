@@ -0,0 +1,140 @@
+/***************************************************************
+                           kflookup.c
+
+Compares finding the current keyframe with an animation's tick
+to keyframe lookup table against walking the keyframe list, for
+animations of different lengths played with different seek
+distances. Both have to agree on every keyframe.
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Macros
+*********************************/
+
+#define SEEKS 200000
+
+
+/*********************************
+             Globals
+*********************************/
+
+static const u32 kfcounts[] = {8, 64, 512, 4096};
+static const f32 seekdists[] = {0.5f, 4.0f, 64.0f, 997.0f};
+
+
+/*==============================
+    make_anim
+    Creates an animation with unevenly spaced keyframes,
+    and optionally its lookup table
+    @param  The animation to fill
+    @param  The number of keyframes
+    @param  Whether to build a lookup table
+    @return The animation's length in ticks
+==============================*/
+
+static u32 make_anim(s64Animation* anim, u32 kfcount, u8 lookup)
+{
+    u32 i, tick = 0, last = 0;
+    s64KeyFrame* keyframes = (s64KeyFrame*)calloc(kfcount, sizeof(s64KeyFrame));
+    u16* ticks = (u16*)malloc(sizeof(u16)*kfcount);
+    for (i=0; i<kfcount; i++)
+    {
+        ticks[i] = tick;
+        *(u32*)&keyframes[i].framenumber = tick;
+        last = tick;
+        tick += 1 + (i*7)%3;
+    }
+    *(u32*)&anim->keyframecount = kfcount;
+    *(const s64KeyFrame**)&anim->keyframes = keyframes;
+    if (lookup)
+    {
+        u16* table = (u16*)malloc(sizeof(u16)*(last+1));
+        sausage64_build_kflookup(table, ticks, kfcount);
+        *(const u16**)&anim->kflookup = table;
+    }
+    free(ticks);
+    return last;
+}
+
+
+/*==============================
+    seek
+    Finds the keyframe at each tick of a seek sequence
+    @param  The animation to seek through
+    @param  The animation's length in ticks
+    @param  The distance between each seek
+    @param  An array to store each keyframe in, or NULL
+    @return The time it took in nanoseconds
+==============================*/
+
+static u64 seek(const s64Animation* anim, u32 length, f32 dist, u32* found)
+{
+    u32 i;
+    u64 start;
+    s64AnimPlay play;
+    play.animdata = anim;
+    play.curtick = 0;
+    play.curkeyframe = 0;
+    start = test_time();
+    for (i=0; i<SEEKS; i++)
+    {
+        play.curtick += dist;
+        if (play.curtick >= length)
+            play.curtick -= length*(u32)(play.curtick/length);
+        sausage64_update_animplay(&play);
+        if (found != NULL)
+            found[i] = play.curkeyframe;
+    }
+    return test_time() - start;
+}
+
+
+/*==============================
+    main
+    Runs the benchmark
+==============================*/
+
+int main(int argc, char** argv)
+{
+    u32 i, j, k;
+    static u32 found_lookup[SEEKS], found_walk[SEEKS];
+    printf("%-10s %-10s %12s %12s\n", "keyframes", "seek", "lookup", "walk");
+    for (i=0; i<sizeof(kfcounts)/sizeof(kfcounts[0]); i++)
+    {
+        s64Animation lookup, walk;
+        u32 length;
+        memset(&lookup, 0, sizeof(lookup));
+        memset(&walk, 0, sizeof(walk));
+        length = make_anim(&lookup, kfcounts[i], TRUE);
+        make_anim(&walk, kfcounts[i], FALSE);
+        for (j=0; j<sizeof(seekdists)/sizeof(seekdists[0]); j++)
+        {
+            u64 t_lookup, t_walk;
+
+            // Both ways of finding the keyframe must agree
+            seek(&lookup, length, seekdists[j], found_lookup);
+            seek(&walk, length, seekdists[j], found_walk);
+            for (k=0; k<SEEKS; k++)
+            {
+                if (found_lookup[k] != found_walk[k])
+                {
+                    printf("Keyframe mismatch with %d keyframes at seek %d: lookup %d, walk %d\n", kfcounts[i], k, found_lookup[k], found_walk[k]);
+                    return 1;
+                }
+            }
+
+            // Time them
+            t_lookup = seek(&lookup, length, seekdists[j], NULL);
+            t_walk = seek(&walk, length, seekdists[j], NULL);
+            printf("%-10d %-10.1f %9.1f ns %9.1f ns\n", kfcounts[i], seekdists[j], (f64)t_lookup/SEEKS, (f64)t_walk/SEEKS);
+        }
+        free((void*)lookup.keyframes);
+        free((void*)lookup.kflookup);
+        free((void*)walk.keyframes);
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+/***************************************************************
+                             mtx.c
+
+Checks that s64mtx_fromtrs builds the same fixed point matrices
+as the float path it replaced, which built translation, scale,
+and rotation matrices, multiplied them with guMtxCatF, and
+converted the result with guMtxF2L. Every bit has to match, for
+random transforms, billboards, and base matrices. This only holds
+with -ffp-contract=off, which the Makefile uses, as fused
+multiply-adds round differently.
+Usage: mtx [-b]
+ -b also times both paths
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Macros
+*********************************/
+
+#define TRANSFORMS 200000
+#define BENCHLOOPS 10
+
+
+/*********************************
+             Globals
+*********************************/
+
+static u32 seed = 0x5A05A6E;
+static s64Transform transforms[TRANSFORMS];
+static u8 billboards[TRANSFORMS];
+static Mtx results[2][TRANSFORMS];
+
+
+/*==============================
+    randf
+    Generates a random number
+    @param  The smallest value
+    @param  The largest value
+    @return A number between the two
+==============================*/
+
+static f32 randf(f32 min, f32 max)
+{
+    seed = seed*1664525 + 1013904223;
+    return min + (seed >> 8)*(max - min)/16777216.0f;
+}
+
+
+/*==============================
+    ref_fromtrs
+    Builds a mesh's matrix the way sausage64_drawpart used
+    to, with float matrices
+    @param The transform to use
+    @param Whether the mesh is a billboard
+    @param The matrix to multiply the result with, or NULL
+    @param The matrix to fill
+==============================*/
+
+static void ref_fromtrs(const s64Transform* fdata, u8 billboard, f32 (*base)[4], Mtx* matrix)
+{
+    int i;
+    f32 helper1[4][4];
+    f32 helper2[4][4];
+
+    // Combine the translation and scale matrix
+    guTranslateF(helper1, fdata->pos[0], fdata->pos[1], fdata->pos[2]);
+    guScaleF(helper2, fdata->scale[0], fdata->scale[1], fdata->scale[2]);
+    guMtxCatF(helper2, helper1, helper1);
+
+    // Combine the rotation matrix
+    guMtxIdentF(helper2);
+    if (!billboard)
+    {
+        f32 xx, yy, zz, xy, yz, xz, wx, wy, wz, norm, s = 0;
+        s64Quat q = {fdata->rot[0], fdata->rot[1], fdata->rot[2], fdata->rot[3]};
+        norm = s64quat_normalize(q);
+        if (norm > 0)
+            s = 2/norm;
+        xx = q.x*q.x*s;
+        xy = q.x*q.y*s;
+        xz = q.x*q.z*s;
+        yy = q.y*q.y*s;
+        yz = q.y*q.z*s;
+        zz = q.z*q.z*s;
+        wx = q.w*q.x*s;
+        wy = q.w*q.y*s;
+        wz = q.w*q.z*s;
+        helper2[0][1] = xy + wz;
+        helper2[1][2] = yz + wx;
+        helper2[2][0] = xz + wy;
+        helper2[1][0] = xy - wz;
+        helper2[2][1] = yz - wx;
+        helper2[0][2] = xz - wy;
+        helper2[0][0] = 1 - yy - zz;
+        helper2[1][1] = 1 - xx - zz;
+        helper2[2][2] = 1 - xx - yy;
+    }
+    else
+    {
+        for (i=0; i<3; i++)
+        {
+            helper2[i][0] = s64_viewmat[0][i];
+            helper2[i][1] = s64_viewmat[1][i];
+            helper2[i][2] = s64_viewmat[2][i];
+        }
+    }
+    guMtxCatF(helper2, helper1, helper1);
+    if (base != NULL)
+        guMtxCatF(helper1, base, helper1);
+    guMtxF2L(helper1, matrix);
+}
+
+
+/*==============================
+    compare
+    Builds every matrix with both paths, and checks that
+    they match
+    @param  The matrix to multiply the results with, or NULL
+    @return Whether every matrix matched
+==============================*/
+
+static u8 compare(f32 (*base)[4])
+{
+    u32 i;
+    for (i=0; i<TRANSFORMS; i++)
+    {
+        ref_fromtrs(&transforms[i], billboards[i], base, &results[0][i]);
+        s64mtx_fromtrs(&transforms[i], billboards[i], base, &results[1][i]);
+        if (memcmp(&results[0][i], &results[1][i], sizeof(Mtx)) != 0)
+        {
+            const s64Transform* t = &transforms[i];
+            printf("Transform %d doesn't match%s%s\n", i, billboards[i] ? " (billboard)" : "", base != NULL ? " (with a base matrix)" : "");
+            printf("  pos   %f %f %f\n", t->pos[0], t->pos[1], t->pos[2]);
+            printf("  rot   %f %f %f %f\n", t->rot[0], t->rot[1], t->rot[2], t->rot[3]);
+            printf("  scale %f %f %f\n", t->scale[0], t->scale[1], t->scale[2]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+/*==============================
+    main
+    Runs the test
+==============================*/
+
+int main(int argc, char** argv)
+{
+    u32 i, j, k;
+    f32 base[4][4];
+    f32 axis[3], angle;
+
+    // A camera that's been turned and moved, for the billboards and the base matrix
+    for (i=0; i<4; i++)
+        for (j=0; j<4; j++)
+            base[i][j] = randf(-2, 2);
+    for (i=0; i<4; i++)
+        for (j=0; j<4; j++)
+            s64_viewmat[i][j] = randf(-1, 1);
+
+    // Random transforms, with some of the edge cases meshes can have
+    for (i=0; i<TRANSFORMS; i++)
+    {
+        s64Transform* t = &transforms[i];
+        for (k=0; k<3; k++)
+        {
+            axis[k] = randf(-1, 1);
+            t->pos[k] = randf(-10000, 10000);
+            t->scale[k] = randf(-3, 3);
+        }
+        angle = randf(-M_PI, M_PI);
+        t->rot[0] = cosf(angle/2);
+        t->rot[1] = axis[0]*sinf(angle/2);
+        t->rot[2] = axis[1]*sinf(angle/2);
+        t->rot[3] = axis[2]*sinf(angle/2);
+        billboards[i] = (i%7 == 0);
+        switch (i%11)
+        {
+            case 0: // Unit scale and no rotation, like most meshes in a rest pose
+                t->rot[0] = 1;
+                t->rot[1] = t->rot[2] = t->rot[3] = 0;
+                t->scale[0] = t->scale[1] = t->scale[2] = 1;
+                break;
+            case 1: // A quaternion that was never set
+                t->rot[0] = t->rot[1] = t->rot[2] = t->rot[3] = 0;
+                break;
+            case 2: // A mesh that's been hidden by scaling it to nothing
+                t->scale[0] = t->scale[1] = t->scale[2] = 0;
+                break;
+            case 3: // Small values that only fill the fractional half
+                for (k=0; k<3; k++)
+                    t->pos[k] = randf(-1, 1);
+                break;
+        }
+    }
+
+    // Both paths have to agree on every bit
+    if (!compare(NULL) || !compare(base))
+        return 1;
+    printf("%d matrices match, with and without a base matrix\n", TRANSFORMS);
+
+    // Time them
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+    {
+        u64 t_ref, t_new, start;
+        start = test_time();
+        for (j=0; j<BENCHLOOPS; j++)
+            for (i=0; i<TRANSFORMS; i++)
+                ref_fromtrs(&transforms[i], billboards[i], NULL, &results[0][i]);
+        t_ref = test_time() - start;
+        start = test_time();
+        for (j=0; j<BENCHLOOPS; j++)
+            for (i=0; i<TRANSFORMS; i++)
+                s64mtx_fromtrs(&transforms[i], billboards[i], NULL, &results[1][i]);
+        t_new = test_time() - start;
+        printf("guMtxCatF and guMtxF2L: %6.1f ns/matrix\n", (f64)t_ref/(TRANSFORMS*BENCHLOOPS));
+        printf("s64mtx_fromtrs:         %6.1f ns/matrix\n", (f64)t_new/(TRANSFORMS*BENCHLOOPS));
+    }
+    return 0;
+}
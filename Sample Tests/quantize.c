@@ -0,0 +1,114 @@
+/***************************************************************
+                           quantize.c
+
+Checks the precision of quantized animations. The sample model
+is exported by Arabiki64 twice, with and without -k, and every
+keyframe the library decodes from the quantized export has to be
+within the quantization's error bounds of the float one.
+Usage: quantize <Float model> <Quantized model>
+***************************************************************/
+
+#include "sausage64.c"
+#include "s64test.h"
+
+
+/*********************************
+             Macros
+*********************************/
+
+// Smallest three rotations have 15 bits per component, which gives under 0.009 degrees of error
+#define MAXERROR_ROT   0.01
+
+// Scales are 8.8 fixed point, so they're off by half a step at most
+#define MAXERROR_SCALE (0.5/256.0)
+
+// Quaternions are rebuilt with a square root, which should still give a unit quaternion
+#define MAXERROR_NORM  0.0001
+
+
+/*==============================
+    main
+    Runs the test
+==============================*/
+
+int main(int argc, char** argv)
+{
+    u32 i, j, k;
+    u16 mesh;
+    f64 err_pos = 0, err_rot = 0, err_scale = 0, maxerr_pos;
+    s64ModelData* mdl;
+    s64ModelData* qmdl;
+    if (argc < 3)
+    {
+        printf("Usage: quantize <Float model> <Quantized model>\n");
+        return 1;
+    }
+    mdl = test_loadmodel(argv[1]);
+    qmdl = test_loadmodel(argv[2]);
+    if (qmdl->anims[0].keyframes[0].qframedata == NULL)
+    {
+        printf("'%s' isn't quantized\n", argv[2]);
+        return 1;
+    }
+    if (mdl->meshcount != qmdl->meshcount || mdl->animcount != qmdl->animcount)
+    {
+        printf("The models don't match\n");
+        return 1;
+    }
+
+    // Translations are rounded to the nearest multiple of the position scale
+    maxerr_pos = qmdl->_qposscale*0.5*1.001;
+
+    // Compare every transform of every keyframe
+    for (i=0; i<mdl->animcount; i++)
+    {
+        const s64Animation* anim = &mdl->anims[i];
+        const s64Animation* qanim = &qmdl->anims[i];
+        if (anim->keyframecount != qanim->keyframecount)
+        {
+            printf("Animation '%s' doesn't have the same keyframes\n", anim->name);
+            return 1;
+        }
+        for (j=0; j<anim->keyframecount; j++)
+        {
+            for (mesh=0; mesh<mdl->meshcount; mesh++)
+            {
+                s64Transform decoded;
+                f64 dot = 0, norm = 0, tnorm = 0, angle;
+                const s64Transform* t = sausage64_get_framedata(mdl, &anim->keyframes[j], mesh, NULL);
+                const s64Transform* q = sausage64_get_framedata(qmdl, &qanim->keyframes[j], mesh, &decoded);
+                for (k=0; k<3; k++)
+                {
+                    err_pos = fmax(err_pos, fabs(q->pos[k] - t->pos[k]));
+                    err_scale = fmax(err_scale, fabs(q->scale[k] - t->scale[k]));
+                }
+
+                // The quantized quaternion might have been negated, which is the same rotation
+                for (k=0; k<4; k++)
+                {
+                    dot += (f64)q->rot[k]*t->rot[k];
+                    norm += (f64)q->rot[k]*q->rot[k];
+                    tnorm += (f64)t->rot[k]*t->rot[k];
+                }
+                if (fabs(sqrt(norm) - 1.0) > MAXERROR_NORM)
+                {
+                    printf("Keyframe %d of '%s' decoded a quaternion with length %f for mesh %d\n", j, anim->name, sqrt(norm), mesh);
+                    return 1;
+                }
+                angle = 2.0*acos(fmin(fabs(dot)/sqrt(norm*tnorm), 1.0))*180.0/M_PI;
+                err_rot = fmax(err_rot, angle);
+            }
+        }
+    }
+
+    // Check the bounds
+    printf("Max translation error: %f (limit %f)\n", err_pos, maxerr_pos);
+    printf("Max rotation error:    %f degrees (limit %f)\n", err_rot, MAXERROR_ROT);
+    printf("Max scale error:       %f (limit %f)\n", err_scale, MAXERROR_SCALE);
+    if (err_pos > maxerr_pos || err_rot > MAXERROR_ROT || err_scale > MAXERROR_SCALE)
+    {
+        printf("Quantization error is out of bounds\n");
+        return 1;
+    }
+    return 0;
+}
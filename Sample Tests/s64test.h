@@ -0,0 +1,396 @@
+/***************************************************************
+                           s64test.h
+
+Helpers shared by the host tests. Every test includes
+sausage64.c directly, so it can reach the library's static
+functions, and then this file. The helpers are static inline,
+as not every test uses all of them.
+***************************************************************/
+
+#ifndef S64TEST_H
+#define S64TEST_H
+
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <time.h>
+
+
+    /*********************************
+                 Macros
+    *********************************/
+
+    // The sample model, as the libultra ROM uses it
+    #define TEST_MODELPATH "../Sample ROM/libultra/models/binary/catherineMdl.bin"
+
+    // Size of the memory the library allocates from. It's static so that it sits below 4GB, like pointers in display lists need
+    #define TEST_POOLSIZE (16*1024*1024)
+
+    // Biggest binary model that can be loaded
+    #define TEST_ROMSIZE (1024*1024)
+
+    // Number of dummy textures handed to the library
+    #define TEST_TEXCOUNT 16
+
+
+    /*********************************
+                 Globals
+    *********************************/
+
+    extern u32 stub_dmacount;
+
+    static u8  test_pool[TEST_POOLSIZE] __attribute__((aligned(16)));
+    static u32 test_poolused = 0;
+    static u8  test_rom[TEST_ROMSIZE] __attribute__((aligned(16)));
+    static u32 test_romsize = 0;
+    static u32 test_texdata[TEST_TEXCOUNT][64] __attribute__((aligned(16)));
+    static u32* test_textures[TEST_TEXCOUNT];
+
+
+    /*********************************
+             Memory and time
+    *********************************/
+
+    /*==============================
+        test_alloc
+        Bump allocator for the library. Memory is only
+        given back with test_resetpool, which also makes
+        every run lay memory out the same way
+        @param  The number of bytes to allocate
+        @return The allocated memory, or NULL
+    ==============================*/
+
+    static inline void* test_alloc(u32 size)
+    {
+        void* block;
+        if (test_poolused + s64align(size) > TEST_POOLSIZE)
+            return NULL;
+        block = &test_pool[test_poolused];
+        test_poolused += s64align(size);
+        return block;
+    }
+
+    static inline void test_free(void* ptr) {}
+
+
+    /*==============================
+        test_resetpool
+        Throws away everything the library allocated
+    ==============================*/
+
+    static inline void test_resetpool()
+    {
+        test_poolused = 0;
+    }
+
+
+    /*==============================
+        test_time
+        Reads the host's monotonic clock
+        @return The time in nanoseconds
+    ==============================*/
+
+    static inline u64 test_time()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (u64)ts.tv_sec*1000000000 + ts.tv_nsec;
+    }
+
+
+    /*********************************
+              Model loading
+    *********************************/
+
+    /*==============================
+        test_swap16
+        test_swap32
+        Byteswap a run of values in place
+        @param The first value
+        @param The number of values
+    ==============================*/
+
+    static inline void test_swap16(void* data, u32 count)
+    {
+        u8* b = (u8*)data;
+        while (count--)
+        {
+            u8 t = b[0];
+            b[0] = b[1];
+            b[1] = t;
+            b += 2;
+        }
+    }
+
+    static inline void test_swap32(void* data, u32 count)
+    {
+        u8* b = (u8*)data;
+        while (count--)
+        {
+            u8 t0 = b[0], t1 = b[1];
+            b[0] = b[3];
+            b[1] = b[2];
+            b[2] = t1;
+            b[3] = t0;
+            b += 4;
+        }
+    }
+
+
+    /*==============================
+        test_swapcommands
+        Byteswaps a display list command stream, which is
+        all words except for the combiner's bytes
+        @param The start of the command stream
+    ==============================*/
+
+    static inline void test_swapcommands(u32* data)
+    {
+        while (1)
+        {
+            test_swap32(data, 1);
+            switch (*data++)
+            {
+                case SPClearGeometryMode:
+                case SPSetGeometryMode:
+                case SPVertex:
+                case SP1Triangle:
+                case DPSetCycleType:
+                case DPSetTextureFilter:
+                    test_swap32(data, 1);
+                    data += 1;
+                    break;
+                case SP2Triangles:
+                case DPSetPrimColor:
+                case DPSetRenderMode:
+                    test_swap32(data, 2);
+                    data += 2;
+                    break;
+                case DPLoadTextureBlock:
+                case DPLoadTextureBlock_4b:
+                    test_swap32(data, 4);
+                    data += 4;
+                    break;
+                case DPSetCombineLERP:
+                    data += 4;
+                    break;
+                case SPEndDisplayList:
+                    return;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*==============================
+        test_swapmodel
+        Converts a big endian binary model, as Arabiki64
+        writes them for the N64, to the host's byte order
+        @param The binary model data
+    ==============================*/
+
+    static inline void test_swapmodel(u8* data)
+    {
+        int i;
+        u32 flags = 0, count_meshes, count_mats, count_anims, offset_meshes, offset_mats, offset_anims;
+        test_swap16(&data[4], 4);
+        test_swap32(&data[12], 2);
+        count_meshes = ((u16*)data)[2];
+        count_mats = ((u16*)data)[3];
+        count_anims = ((u16*)data)[4];
+        offset_meshes = ((u16*)data)[5];
+        offset_mats = ((u32*)data)[3];
+        offset_anims = ((u32*)data)[4];
+        if (data[3] >= 1)
+        {
+            test_swap32(&data[20], 2);
+            flags = ((u32*)data)[5];
+        }
+
+        // Meshes
+        for (i=0; i<count_meshes; i++)
+        {
+            u32* toc = (u32*)&data[offset_meshes + 0x1C*i];
+            u8* meshdata;
+            char* name;
+            test_swap32(toc, 7);
+            meshdata = &data[toc[0]];
+            name = (char*)&meshdata[3];
+            test_swap16(meshdata, 1);
+            if (flags & BINFLAG_BOUNDS)
+                test_swap32(name+strlen(name)+1, 4);
+            if ((flags & BINFLAG_LODS) && (flags & BINFLAG_GFXDLISTS))
+            {
+                u8* lodtable = (u8*)name+strlen(name)+1+4*sizeof(f32);
+                test_swap32(lodtable+1, lodtable[0]);
+            }
+
+            // Vertices are six halfwords and four bytes each
+            {
+                u32 v;
+                for (v=0; v<toc[3]/16; v++)
+                    test_swap16(&data[toc[2] + v*16], 6);
+            }
+
+            // Display lists are either assembled words with relocations after them, or a command stream
+            if (flags & BINFLAG_GFXDLISTS)
+                test_swap32(&data[toc[4]], toc[5]/4);
+            else
+                test_swapcommands((u32*)&data[toc[4]]);
+        }
+
+        // Materials only have words in them when they're assembled display lists
+        for (i=0; i<count_mats; i++)
+        {
+            u32* toc = (u32*)&data[offset_mats + 0x10*i];
+            test_swap32(toc, 4);
+            if (flags & BINFLAG_MATDLISTS)
+                test_swap32(&data[toc[2]], toc[3]/4);
+        }
+
+        // Animations
+        for (i=0; i<count_anims; i++)
+        {
+            u32* toc = (u32*)&data[offset_anims + 0x10*i];
+            u8* animdata;
+            u32 kfcount;
+            char* name;
+            test_swap32(toc, 4);
+            animdata = &data[toc[0]];
+            test_swap32(animdata, 1);
+            kfcount = (*(u32*)animdata) & ~BINARY_ANIMBAKED;
+            test_swap16(animdata+4, kfcount);
+            name = (char*)(animdata + 4 + kfcount*sizeof(u16));
+            if (flags & BINFLAG_BOUNDS)
+                test_swap32(name+strlen(name)+1, 4);
+            if (flags & BINFLAG_QUANTIZEDANIMS)
+                test_swap16(&data[toc[2]], toc[3]/2);
+            else
+                test_swap32(&data[toc[2]], toc[3]/4);
+        }
+    }
+
+
+    /*==============================
+        test_loadmodel
+        Loads a binary model from a file, as if it were in ROM.
+        The library allocates from the test pool from now on,
+        and the file stays in test_rom until the next call
+        @param  The path to the binary model
+        @return The loaded model
+    ==============================*/
+
+    static inline s64ModelData* test_loadmodel(const char* path)
+    {
+        int i;
+        u32 size;
+        const u16 endian = 1;
+        s64ModelData* mdl;
+        FILE* fp = fopen(path, "rb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Unable to open '%s'\n", path);
+            exit(1);
+        }
+        size = fread(test_rom, 1, TEST_ROMSIZE, fp);
+        fclose(fp);
+        test_romsize = size;
+        if (*(u8*)&endian == 1)
+            test_swapmodel(test_rom);
+        for (i=0; i<TEST_TEXCOUNT; i++)
+            test_textures[i] = test_texdata[i];
+        sausage64_set_allocator(test_alloc, test_free);
+        mdl = sausage64_load_binarymodel((u32)(uintptr_t)test_rom, size, test_textures);
+        if (mdl == NULL)
+        {
+            fprintf(stderr, "Unable to parse '%s'\n", path);
+            exit(1);
+        }
+        return mdl;
+    }
+
+
+    /*********************************
+                 Output
+    *********************************/
+
+    /*==============================
+        test_hash
+        Hashes a block of memory with FNV-1a
+        @param  The memory to hash
+        @param  The number of bytes
+        @return The hash
+    ==============================*/
+
+    static inline u32 test_hash(const void* data, u32 size)
+    {
+        u32 hash = 2166136261u;
+        const u8* b = (const u8*)data;
+        while (size--)
+            hash = (hash ^ *b++)*16777619u;
+        return hash;
+    }
+
+
+    /*==============================
+        test_dumpgfx
+        Prints display list commands, with their pointers
+        named after what they point to, so the output only
+        changes when the commands do. Vertex loads are
+        printed as a hash of the vertices they load, so
+        moving the vertices around in memory doesn't change
+        the output either
+        @param The file to print to
+        @param The model the commands came from
+        @param The first command
+        @param The command after the last one
+    ==============================*/
+
+    static inline void test_dumpgfx(FILE* fp, const s64ModelData* mdl, const Gfx* start, const Gfx* end)
+    {
+        int i;
+        const Gfx* cmd;
+        for (cmd=start; cmd<end; cmd++)
+        {
+            const u32 w0 = cmd->words.w0;
+            const u32 w1 = cmd->words.w1;
+            switch (w0 >> 24)
+            {
+                case G_VTX:
+                    fprintf(fp, "%08x V:%08x\n", w0, test_hash((const void*)(uintptr_t)w1, ((w0 >> 8) & 0xFFFF)*sizeof(Vtx)));
+                    break;
+                case G_SETTIMG:
+                    for (i=0; i<TEST_TEXCOUNT; i++)
+                        if (w1 == (u32)(uintptr_t)test_textures[i])
+                            break;
+                    fprintf(fp, "%08x T%d\n", w0, i);
+                    break;
+                case G_MTX:
+                    {
+                        const Mtx* m = (const Mtx*)(uintptr_t)w1;
+                        fprintf(fp, "%08x M", w0);
+                        for (i=0; i<16; i++)
+                            fprintf(fp, " %08x", (u32)m->m[i/4][i%4]);
+                        fprintf(fp, "\n");
+                    }
+                    break;
+                case G_DL:
+                    for (i=0; i<mdl->meshcount; i++)
+                        if (w1 == (u32)(uintptr_t)mdl->meshes[i].dl)
+                            break;
+                    if (i < mdl->meshcount)
+                        fprintf(fp, "%08x DL%d\n", w0, i);
+                    else if (mdl->_instancedls != NULL && w1 >= (u32)(uintptr_t)mdl->_instancedls)
+                        fprintf(fp, "%08x I+%x\n", w0, (u32)(w1 - (u32)(uintptr_t)mdl->_instancedls)/(u32)sizeof(Gfx));
+                    else
+                        fprintf(fp, "%08x ?\n", w0);
+                    break;
+                default:
+                    fprintf(fp, "%08x %08x\n", w0, w1);
+                    break;
+            }
+        }
+    }
+
+#endif
@@ -0,0 +1,196 @@
+/***************************************************************
+                            stubs.c
+
+Stand-ins for the Libultra functions the Sausage64 library
+calls. ROM addresses are plain pointers to memory, so DMA is a
+memcpy, and the matrix functions do what the real ones do.
+A DMA's data only arrives once its message is received, and
+checks that don't block find it still running for a while, as
+the PI is slow compared to the CPU. Reading its memory too
+early gives garbage, like it would on the console.
+***************************************************************/
+
+#include <ultra64.h>
+#include <string.h>
+#include <time.h>
+
+
+/*********************************
+             Globals
+*********************************/
+
+// How many DMAs were started, so the tests can check how much streaming reads from ROM
+u32 stub_dmacount = 0;
+
+// The DMA that's running. The library only ever has one going at a time
+static void* stub_dmadest = NULL;
+static void* stub_dmasrc;
+static u32   stub_dmasize;
+static u32   stub_dmapolls;
+
+
+/*==============================
+    osPiStartDma
+    Starts copying memory from "ROM", which is just a
+    pointer. The destination is filled with garbage until
+    the DMA finishes
+==============================*/
+
+s32 osPiStartDma(OSIoMesg* mb, s32 priority, s32 direction, u32 devaddr, void* vaddr, u32 nbytes, OSMesgQueue* mq)
+{
+    memset(vaddr, 0xA5, nbytes);
+    stub_dmadest = vaddr;
+    stub_dmasrc = (void*)(uintptr_t)devaddr;
+    stub_dmasize = nbytes;
+    stub_dmapolls = nbytes/1024;
+    stub_dmacount++;
+    return 0;
+}
+
+
+/*==============================
+    osRecvMesg
+    Finishes the running DMA, unless it's being checked
+    without blocking and it's still running. That takes
+    one check per kilobyte
+==============================*/
+
+s32 osRecvMesg(OSMesgQueue* mq, OSMesg* msg, s32 flag)
+{
+    if (stub_dmadest == NULL)
+        return (flag == OS_MESG_BLOCK) ? 0 : -1;
+    if (flag == OS_MESG_NOBLOCK && stub_dmapolls > 0)
+    {
+        stub_dmapolls--;
+        return -1;
+    }
+    memcpy(stub_dmadest, stub_dmasrc, stub_dmasize);
+    stub_dmadest = NULL;
+    return 0;
+}
+
+void osCreateMesgQueue(OSMesgQueue* mq, OSMesg* msg, s32 count) {}
+void osInvalDCache(void* vaddr, s32 nbytes) {}
+void osWritebackDCache(void* vaddr, s32 nbytes) {}
+
+
+/*==============================
+    osGetTime
+    Returns the time in N64 CPU cycles, from the host's
+    monotonic clock
+==============================*/
+
+OSTime osGetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return OS_USEC_TO_CYCLES((u64)ts.tv_sec*1000000 + ts.tv_nsec/1000);
+}
+
+u32 osGetCount(void)
+{
+    return (u32)osGetTime();
+}
+
+
+/*==============================
+    guMtxF2L
+    Converts a float matrix to the N64's split 16.16 fixed
+    point format, the same way Libultra does
+==============================*/
+
+#define FTOFIX32(x) (long)((x) * (float)0x00010000)
+
+void guMtxF2L(float mf[4][4], Mtx* m)
+{
+    int i, j;
+    s32 e1, e2;
+    s32* ai = (s32*)&m->m[0][0];
+    s32* af = (s32*)&m->m[2][0];
+    for (i=0; i<4; i++)
+    {
+        for (j=0; j<2; j++)
+        {
+            e1 = FTOFIX32(mf[i][j*2]);
+            e2 = FTOFIX32(mf[i][j*2+1]);
+            *(ai++) = (e1 & 0xffff0000) | ((e2 >> 16) & 0xffff);
+            *(af++) = (((u32)e1 << 16) & 0xffff0000) | (e2 & 0xffff);
+        }
+    }
+}
+
+
+/*==============================
+    guMtxL2F
+    Converts an N64 fixed point matrix back to floats
+==============================*/
+
+void guMtxL2F(float mf[4][4], Mtx* m)
+{
+    int i, j;
+    u32 e1, e2;
+    s32 q1, q2;
+    s32* ai = (s32*)&m->m[0][0];
+    s32* af = (s32*)&m->m[2][0];
+    for (i=0; i<4; i++)
+    {
+        for (j=0; j<2; j++)
+        {
+            e1 = (*ai & 0xffff0000) | ((*af >> 16) & 0xffff);
+            e2 = (((u32)*(ai++) << 16) & 0xffff0000) | (*(af++) & 0xffff);
+            q1 = *((s32*)&e1);
+            q2 = *((s32*)&e2);
+            mf[i][j*2] = q1/65536.0f;
+            mf[i][j*2+1] = q2/65536.0f;
+        }
+    }
+}
+
+
+/*==============================
+    guMtxIdentF
+    guTranslateF
+    guScaleF
+    guMtxCatF
+    Float matrix helpers
+==============================*/
+
+void guMtxIdentF(float mf[4][4])
+{
+    int i, j;
+    for (i=0; i<4; i++)
+        for (j=0; j<4; j++)
+            mf[i][j] = (i == j) ? 1.0f : 0.0f;
+}
+
+void guTranslateF(float mf[4][4], float x, float y, float z)
+{
+    guMtxIdentF(mf);
+    mf[3][0] = x;
+    mf[3][1] = y;
+    mf[3][2] = z;
+}
+
+void guScaleF(float mf[4][4], float x, float y, float z)
+{
+    guMtxIdentF(mf);
+    mf[0][0] = x;
+    mf[1][1] = y;
+    mf[2][2] = z;
+}
+
+void guMtxCatF(float m[4][4], float n[4][4], float r[4][4])
+{
+    int i, j, k;
+    float temp[4][4];
+    for (i=0; i<4; i++)
+    {
+        for (j=0; j<4; j++)
+        {
+            temp[i][j] = 0;
+            for (k=0; k<4; k++)
+                temp[i][j] += m[i][k]*n[k][j];
+        }
+    }
+    memcpy(r, temp, sizeof(temp));
+}
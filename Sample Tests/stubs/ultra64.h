@@ -0,0 +1,192 @@
+/***************************************************************
+                           ultra64.h
+
+A stand-in for Libultra's header, with just enough of the types,
+OS functions and GBI macros for the Sausage64 library to build
+and run on a PC. The GBI macros don't match the real encodings,
+they only need to be consistent so the golden outputs can be
+compared.
+***************************************************************/
+
+#ifndef _ULTRA64_H_
+#define _ULTRA64_H_
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <math.h>
+
+
+    /*********************************
+                 Types
+    *********************************/
+
+    typedef uint8_t  u8;
+    typedef uint16_t u16;
+    typedef uint32_t u32;
+    typedef uint64_t u64;
+
+    typedef int8_t  s8;
+    typedef int16_t s16;
+    typedef int32_t s32;
+    typedef int64_t s64;
+
+    typedef volatile u32 vu32;
+    typedef float  f32;
+    typedef double f64;
+
+    #ifndef TRUE
+        #define TRUE  1
+        #define FALSE 0
+    #endif
+
+    typedef struct {
+        u32 w0;
+        u32 w1;
+    } Gwords;
+
+    typedef union {
+        Gwords words;
+        long long force_align;
+    } Gfx;
+
+    typedef s32 Mtx_t[4][4];
+    typedef union {
+        Mtx_t m;
+        long long force_align;
+    } Mtx;
+
+    typedef struct {
+        short ob[3];
+        unsigned short flag;
+        short tc[2];
+        unsigned char cn[4];
+    } Vtx_t;
+
+    typedef union {
+        Vtx_t v;
+        long long force_align;
+    } Vtx;
+
+    typedef void* OSMesg;
+    typedef struct {int unused;} OSMesgQueue;
+    typedef struct {int unused;} OSIoMesg;
+    typedef u64 OSTime;
+
+
+    /*********************************
+              OS functions
+    *********************************/
+
+    #define OS_MESG_PRI_NORMAL 0
+    #define OS_READ            0
+    #define OS_MESG_NOBLOCK    0
+    #define OS_MESG_BLOCK      1
+
+    // The library stores pointers in 32-bit display list words, so the tests must keep everything below 4GB
+    #define OS_K0_TO_PHYSICAL(x) ((u32)(uintptr_t)(x))
+
+    // osGetTime counts at the N64's 46.875MHz
+    #define OS_CYCLES_TO_USEC(c) (((u64)(c)*64)/3000)
+    #define OS_USEC_TO_CYCLES(n) (((u64)(n)*3000)/64)
+
+    extern void   osCreateMesgQueue(OSMesgQueue* mq, OSMesg* msg, s32 count);
+    extern void   osInvalDCache(void* vaddr, s32 nbytes);
+    extern void   osWritebackDCache(void* vaddr, s32 nbytes);
+    extern s32    osPiStartDma(OSIoMesg* mb, s32 priority, s32 direction, u32 devaddr, void* vaddr, u32 nbytes, OSMesgQueue* mq);
+    extern s32    osRecvMesg(OSMesgQueue* mq, OSMesg* msg, s32 flag);
+    extern u32    osGetCount(void);
+    extern OSTime osGetTime(void);
+
+    extern void guMtxF2L(float mf[4][4], Mtx* m);
+    extern void guMtxL2F(float mf[4][4], Mtx* m);
+    extern void guMtxIdentF(float mf[4][4]);
+    extern void guTranslateF(float mf[4][4], float x, float y, float z);
+    extern void guScaleF(float mf[4][4], float x, float y, float z);
+    extern void guMtxCatF(float m[4][4], float n[4][4], float r[4][4]);
+
+
+    /*********************************
+                  GBI
+    *********************************/
+
+    #define _SHIFTL(v, s, w) ((u32)(((u32)(v) & ((0x01 << (w)) - 1)) << (s)))
+
+    #define GCCc0w0(saRGB0, mRGB0, saA0, mA0)           (_SHIFTL((saRGB0), 20, 4) | _SHIFTL((mRGB0), 15, 5) | _SHIFTL((saA0), 12, 3) | _SHIFTL((mA0), 9, 3))
+    #define GCCc1w0(saRGB1, mRGB1)                      (_SHIFTL((saRGB1), 5, 4) | _SHIFTL((mRGB1), 0, 5))
+    #define GCCc0w1(sbRGB0, aRGB0, sbA0, aA0)           (_SHIFTL((sbRGB0), 28, 4) | _SHIFTL((aRGB0), 15, 3) | _SHIFTL((sbA0), 12, 3) | _SHIFTL((aA0), 9, 3))
+    #define GCCc1w1(sbRGB1, saA1, mA1, aRGB1, sbA1, aA1) (_SHIFTL((sbRGB1), 24, 4) | _SHIFTL((saA1), 21, 3) | _SHIFTL((mA1), 18, 3) | _SHIFTL((aRGB1), 6, 3) | _SHIFTL((sbA1), 3, 3) | _SHIFTL((aA1), 0, 3))
+
+    #define G_SPNOOP          0x00
+    #define G_VTX             0x01
+    #define G_TRI1            0x05
+    #define G_TRI2            0x06
+    #define G_POPMTX          0xD8
+    #define G_GEOMODE         0xD9
+    #define G_MTX             0xDA
+    #define G_DL              0xDE
+    #define G_ENDDL           0xDF
+    #define G_SETOTHERMODE_L  0xE2
+    #define G_SETOTHERMODE_H  0xE3
+    #define G_RDPLOADSYNC     0xE6
+    #define G_RDPPIPESYNC     0xE7
+    #define G_RDPTILESYNC     0xE8
+    #define G_SETTILESIZE     0xF2
+    #define G_LOADBLOCK       0xF3
+    #define G_SETTILE         0xF5
+    #define G_SETPRIMCOLOR    0xFA
+    #define G_SETCOMBINE      0xFC
+    #define G_SETTIMG         0xFD
+
+    #define G_MTX_MODELVIEW  0x00
+    #define G_MTX_PROJECTION 0x04
+    #define G_MTX_MUL        0x00
+    #define G_MTX_LOAD       0x02
+    #define G_MTX_NOPUSH     0x00
+    #define G_MTX_PUSH       0x01
+
+    #define G_IM_SIZ_4b  0
+    #define G_IM_SIZ_8b  1
+    #define G_IM_SIZ_16b 2
+    #define G_IM_SIZ_32b 3
+
+    #define G_ON  1
+    #define G_OFF 0
+
+    // Every command is the opcode and 24 bits of arguments in the first word, and a value or pointer in the second
+    #define gStub(pkt, op, a, b) \
+    { \
+        Gfx* _g = (Gfx*)(pkt); \
+        _g->words.w0 = _SHIFTL(op, 24, 8) | ((u32)(a) & 0xFFFFFF); \
+        _g->words.w1 = (u32)(uintptr_t)(b); \
+    }
+
+    #define gSPNoOp(pkt)                          gStub(pkt, G_SPNOOP, 0, 0)
+    #define gSPMatrix(pkt, m, p)                  gStub(pkt, G_MTX, p, m)
+    #define gSPPopMatrix(pkt, n)                  gStub(pkt, G_POPMTX, n, 0)
+    #define gSPDisplayList(pkt, dl)               gStub(pkt, G_DL, 0, dl)
+    #define gSPBranchList(pkt, dl)                gStub(pkt, G_DL, 1, dl)
+    #define gSPEndDisplayList(pkt)                gStub(pkt, G_ENDDL, 0, 0)
+    #define gSPVertex(pkt, v, n, v0)              gStub(pkt, G_VTX, ((n)<<8)|(v0), v)
+    #define gSP1Triangle(pkt, a, b, c, f)         gStub(pkt, G_TRI1, ((a)<<16)|((b)<<8)|(c), f)
+    #define gSP2Triangles(pkt, a, b, c, f, d, e, g, h) gStub(pkt, G_TRI2, ((a)<<16)|((b)<<8)|(c), ((d)<<16)|((e)<<8)|(g))
+    #define gSPClearGeometryMode(pkt, w)          gStub(pkt, G_GEOMODE, 0, w)
+    #define gSPSetGeometryMode(pkt, w)            gStub(pkt, G_GEOMODE, 1, w)
+    #define gDPPipeSync(pkt)                      gStub(pkt, G_RDPPIPESYNC, 0, 0)
+    #define gDPSetPrimColor(pkt, m, l, r, g, b, a) gStub(pkt, G_SETPRIMCOLOR, ((m)<<8)|(l), ((r)<<24)|((g)<<16)|((b)<<8)|(a))
+    #define gDPSetCycleType(pkt, t)               gStub(pkt, G_SETOTHERMODE_H, 1, t)
+    #define gDPSetTextureFilter(pkt, t)           gStub(pkt, G_SETOTHERMODE_H, 2, t)
+    #define gDPSetRenderMode(pkt, a, b)           gStub(pkt, G_SETOTHERMODE_L, 0, (a)|(b))
+
+    // Texture loads are seven commands long, like the real macro
+    #define gDPLoadTextureBlock(pkt, timg, fmt, siz, w, h, pal, cms, cmt, ms, mt, ss, st) \
+    { \
+        int _k; \
+        for (_k=0; _k<7; _k++) \
+            gStub(pkt, G_SETTIMG, ((fmt)<<8)|(siz), timg); \
+    }
+    #define gDPLoadTextureBlock_4b(pkt, timg, fmt, w, h, pal, cms, cmt, ms, mt, ss, st) \
+        gDPLoadTextureBlock(pkt, timg, fmt, G_IM_SIZ_4b, w, h, pal, cms, cmt, ms, mt, ss, st)
+
+    #define gsSPEndDisplayList() {{_SHIFTL(G_ENDDL, 24, 8), 0}}
+
+#endif